@@ -7,12 +7,23 @@ var Vector = require('Vector');
 // This file contains entity effects.  Effects are run once per frame and
 // should set intent (send messages, adjust deltas) but not actually change
 // values on the entity
+//
+// Effects that are added to an entity after it is created must be wrapped
+// with snapshottable, so they can be rebuilt when restoring a snapshot.
+var snapshottable = function (maker, params, effect) {
+  effect.snapshot = {
+    maker: maker,
+    params: params,
+  };
+  return effect;
+};
+
 module.exports = {
   makeProductionEffect: function (params) {
     var cooldown_name = params.cooldown_name;
     var prod_name = params.prod_name;
 
-    return function (entity) {
+    return snapshottable('makeProductionEffect', params, function (entity) {
       if (entity.hasCooldown(cooldown_name)) {
         return true;
       }
@@ -38,7 +49,7 @@ module.exports = {
       });
 
       return false;
-    };
+    });
   },
 
   makeHealingAura: function (radius, amount) {
@@ -63,10 +74,10 @@ module.exports = {
   },
 
   makeDamageFactorEffect: function (params) {
-    return function (entity) {
+    return snapshottable('makeDamageFactorEffect', params, function (entity) {
       entity.deltas.damage_factor *= params.factor;
       return entity.hasCooldown(params.cooldown_name);
-    };
+    });
   },
 
   makeDamageBuffAura: function (params) {
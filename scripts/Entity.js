@@ -9,13 +9,18 @@ var EntityProperties = require('constants').EntityProperties;
 var EntityStatus = require('constants').EntityStatus;
 var IDConst = require('constants').IDConst;
 var MessageTypes = require('constants').MessageTypes;
+var PropertyBits = require('constants').PropertyBits;
 var TargetingTypes = require('constants').TargetingTypes;
+var propertyMask = require('constants').propertyMask;
 
 var Collision = require('Collision');
+var Effects = require('Effects');
 var EntityDefs = require('EntityDefs');
 var EntityStates = require('EntityStates');
 var MessageHub = require('MessageHub');
 var Game = require('game');
+var Random = require('Random');
+var Snapshot = require('Snapshot');
 var Vector = require('Vector');
 var Weapons = require('Weapons');
 
@@ -31,6 +36,7 @@ var Entity = function (id, name, params) {
   entity.retreat_ = false;
   entity.pid_ = params.pid || IDConst.NO_PLAYER;
   entity.properties_ = def.properties || [];
+  entity.propertyMask_ = propertyMask(entity.properties_);
   entity.maxSpeed_ = def.speed || 0;
   entity.sight_ = def.sight || 0;
   entity.size_ = def.size || [0, 0];
@@ -97,13 +103,8 @@ var Entity = function (id, name, params) {
     return this.def_;
   };
   entity.hasProperty = function (property) {
-    // TODO(zack): optimize this...
-    for (var i = 0; i < this.properties_.length; i++) {
-      if (this.properties_[i] === property) {
-        return true;
-      }
-    }
-    return false;
+    // Unknown properties have no bit, and are never set
+    return (this.propertyMask_ & PropertyBits[property]) !== 0;
   };
   entity.getProperties = function () {
     return this.properties_;
@@ -333,7 +334,7 @@ var Entity = function (id, name, params) {
         }
       });
       if (candidate_parts.length) {
-        var part_idx = Math.floor(Math.random() * candidate_parts.length);
+        var part_idx = Random.randomInt(candidate_parts.length);
         var part = candidate_parts[part_idx];
         part.addHealth(amount);
         modified_parts.push(part_idx);
@@ -725,6 +726,69 @@ Entity.prototype.handleAction = function (action_name, args) {
   }
 }
 
+// Fields that are rebuilt from the definition or snapshotted separately.
+var SNAPSHOT_SKIP_FIELDS = {
+  def_: true,
+  defaultState_: true,
+  actions_: true,
+  weapons_: true,
+  effects_: true,
+  state_: true,
+};
+
+// Returns a data only description of this entity, see Entity.fromSnapshot.
+Entity.prototype.getSnapshot = function () {
+  var data = {};
+  for (var key in this) {
+    if (this.hasOwnProperty(key) &&
+        !(key in SNAPSHOT_SKIP_FIELDS) &&
+        typeof this[key] !== 'function') {
+      data[key] = Snapshot.serialize(this[key]);
+    }
+  }
+
+  // Effects from the definition are recreated by the constructor, others
+  // need to carry enough information to be rebuilt.
+  var effects = {};
+  for (var name in this.effects_) {
+    var effect = this.effects_[name];
+    effects[name] = effect.snapshot ? Snapshot.serialize(effect.snapshot) : null;
+  }
+
+  return {
+    id: this.id_,
+    name: this.name_,
+    data: data,
+    effects: effects,
+    state: EntityStates.serializeState(this.state_, this),
+  };
+};
+
+Entity.fromSnapshot = function (snapshot) {
+  var entity = new Entity(snapshot.id, snapshot.name, {});
+  Snapshot.copyInto(entity, snapshot.data, SNAPSHOT_SKIP_FIELDS);
+
+  for (var name in entity.effects_) {
+    if (!(name in snapshot.effects)) {
+      delete entity.effects_[name];
+    }
+  }
+  for (var name in snapshot.effects) {
+    if (name in entity.effects_) {
+      continue;
+    }
+    var effect = snapshot.effects[name];
+    if (!effect) {
+      Log('Unable to restore effect', name, 'on', snapshot.id);
+      continue;
+    }
+    entity.effects_[name] = Effects[effect.maker](effect.params);
+  }
+
+  entity.state_ = EntityStates.deserializeState(snapshot.state, entity);
+  return entity;
+};
+
 
 // Accessors
 
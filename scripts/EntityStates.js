@@ -7,12 +7,14 @@
 // state update(entity)
 // it should return a new state if the state is to transition, and null
 // otherwise
+var _ = require('underscore');
 var invariant = require('invariant').invariant;
 var EntityConst = require('EntityConst');
 var EntityProperties = require('constants').EntityProperties;
 var Game = require('game');
 var MessageHub = require('MessageHub');
 var MessageTypes = require('constants').MessageTypes;
+var Snapshot = require('Snapshot');
 
 function NullState(params) {
   this.update = function (entity) {
@@ -236,3 +238,70 @@ function ProjectileState(params) {
   };
 };
 exports.ProjectileState = ProjectileState;
+
+// Snapshot support.  States hold closures, so only their constructor name and
+// data are saved.  Ability states reference an action from the entity
+// definition, which is saved by name.
+var state_names = [
+  'NullState',
+  'UnitIdleState',
+  'UnitMoveState',
+  'UnitCaptureState',
+  'UnitAttackState',
+  'UnitAttackMoveState',
+  'HoldPositionState',
+  'UntargetedAbilityState',
+  'LocationAbilityState',
+  'TargetedAbilityState',
+  'RetreatState',
+  'ProjectileState',
+];
+
+exports.serializeState = function (state, entity) {
+  var name = null;
+  for (var i = 0; i < state_names.length; i++) {
+    if (state instanceof exports[state_names[i]]) {
+      name = state_names[i];
+      break;
+    }
+  }
+  invariant(name, 'unable to snapshot unknown entity state');
+
+  var data = Snapshot.serialize(state);
+  if (state.action) {
+    var action_name = null;
+    for (var key in entity.actions_) {
+      if (entity.actions_[key] === state.action) {
+        action_name = key;
+      }
+    }
+    invariant(action_name, 'state action not found on entity');
+    data.action = action_name;
+  }
+  if (state.next_state) {
+    data.next_state = exports.serializeState(state.next_state, entity);
+  }
+  return {
+    name: name,
+    data: data,
+  };
+};
+
+exports.deserializeState = function (snapshot, entity) {
+  var data = snapshot.data;
+  var params = {};
+  if (data.action) {
+    params.action = entity.actions_[data.action];
+    invariant(params.action, 'snapshot references unknown action');
+  }
+  if (data.next_state) {
+    params.state = exports.deserializeState(data.next_state, entity);
+  }
+  var state = new exports[snapshot.name](params);
+
+  var rest = _.omit(data, 'action', 'next_state');
+  for (var key in rest) {
+    state[key] = Snapshot.serialize(rest[key]);
+  }
+  return state;
+};
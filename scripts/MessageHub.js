@@ -18,3 +18,11 @@ exports.getMessagesForEntity = function (id) {
 exports.clearMessages = function () {
   message_queue = {};
 }
+
+exports.getSnapshot = function () {
+  return message_queue;
+};
+
+exports.restore = function (snapshot) {
+  message_queue = snapshot;
+};
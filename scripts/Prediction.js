@@ -0,0 +1,145 @@
+var _ = require('underscore');
+var Collision = require('Collision');
+var Pathing = require('Pathing');
+var Vector = require('Vector');
+
+var EntityProperties = require('constants').EntityProperties;
+
+// Seconds to predict an order the server never confirms
+var MAX_PREDICTION_TIME = 1.0;
+// Once confirmed, the gap between the prediction and the server's position
+// closes exponentially over about this many seconds
+var RECONCILE_TIME = 0.15;
+// Gaps smaller than this are dropped
+var RECONCILE_EPSILON = 0.01;
+// The server has taken a move order when its path ends this close to the
+// target
+var TARGET_EPSILON = 0.01;
+
+// Moves the local player's units as soon as they are ordered to, instead of
+// waiting for the server to report it.  A move order steps the unit with
+// the same movement as the server, Pathing.stepAllForward, until the
+// server's renders show the order was taken.  From then on the unit follows
+// the server, offset by however far ahead the prediction was, and that
+// offset decays away.
+//
+// Entities passed to step are the local player's units, by game id:
+// {pos, size, angle, speed, mobile, path_end}, all as the server last put
+// them.  path_end is where the server's path for the unit ends, if it has
+// one.
+var Prediction = function () {
+  // game id => {target, pos, angle, age, error}
+  this.predictions_ = {};
+};
+
+Prediction.prototype.addOrder = function (order) {
+  var eids = order.entity || [];
+  var target = order.type === 'MOVE' && order.target
+    ? [order.target[0], order.target[1]]
+    : null;
+  for (var i = 0; i < eids.length; i++) {
+    var eid = eids[i];
+    var prev = this.predictions_[eid];
+    if (target) {
+      this.predictions_[eid] = {
+        target: target,
+        // Start from what is shown, so a new order doesn't jump
+        pos: prev ? prev.pos : null,
+        angle: prev ? prev.angle : null,
+        age: 0,
+        error: null,
+      };
+    } else if (prev && !prev.error) {
+      // Other orders aren't predicted, hand the unit back to the server
+      prev.age = MAX_PREDICTION_TIME;
+    }
+  }
+};
+
+var isConfirmed = function (prediction, entity) {
+  return entity.path_end &&
+    Vector.length(Vector.sub(entity.path_end, prediction.target))
+      < TARGET_EPSILON;
+};
+
+var makeBody = function (entity, prediction) {
+  var pos = prediction && prediction.pos ? prediction.pos : entity.pos;
+  var angle = prediction && prediction.angle !== null
+    ? prediction.angle
+    : entity.angle;
+  var intent = null;
+  if (prediction && !prediction.error && entity.mobile
+      && !Collision.pointInOBB2(prediction.target, pos, entity.size, angle)) {
+    intent = { move_towards: prediction.target };
+  }
+  return {
+    getPosition2: function () { return pos; },
+    getSize: function () { return entity.size; },
+    getAngle: function () { return angle; },
+    getSpeed: function () { return entity.speed; },
+    getMovementIntent: function () { return intent; },
+    // All bodies are the local player's
+    getPlayerID: function () { return 0; },
+    hasProperty: function (prop) {
+      return prop === EntityProperties.P_MOBILE && entity.mobile;
+    },
+  };
+};
+
+// Steps predictions forward dt seconds.  Returns game id => {pos, angle} to
+// show for the units being predicted.
+Prediction.prototype.step = function (entities, dt) {
+  var predictions = this.predictions_;
+  _.each(_.keys(predictions), function (eid) {
+    if (!entities[eid] || !entities[eid].mobile) {
+      delete predictions[eid];
+    }
+  });
+  if (_.isEmpty(predictions)) {
+    return {};
+  }
+
+  var new_bodies = {};
+  if (dt > 0) {
+    var bodies = _.object(_.map(entities, function (entity, eid) {
+      return [eid, makeBody(entity, predictions[eid])];
+    }));
+    new_bodies = Pathing.stepAllForward(bodies, dt);
+  }
+
+  var ret = {};
+  _.each(predictions, function (prediction, eid) {
+    var entity = entities[eid];
+    prediction.age += dt;
+    if (!prediction.error) {
+      if (new_bodies[eid]) {
+        prediction.pos = new_bodies[eid].pos;
+        prediction.angle = new_bodies[eid].angle;
+      } else if (!prediction.pos) {
+        prediction.pos = entity.pos;
+        prediction.angle = entity.angle;
+      }
+      if (!isConfirmed(prediction, entity)
+          && prediction.age < MAX_PREDICTION_TIME) {
+        ret[eid] = { pos: prediction.pos, angle: prediction.angle };
+        return;
+      }
+      prediction.error = Vector.sub(prediction.pos, entity.pos);
+    } else {
+      prediction.error = Vector.mul(
+        prediction.error,
+        Math.exp(-dt / RECONCILE_TIME));
+    }
+
+    if (Vector.length(prediction.error) < RECONCILE_EPSILON) {
+      delete predictions[eid];
+      return;
+    }
+    prediction.pos = Vector.add(entity.pos, prediction.error);
+    prediction.angle = entity.angle;
+    ret[eid] = { pos: prediction.pos, angle: prediction.angle };
+  });
+  return ret;
+};
+
+module.exports = Prediction;
@@ -0,0 +1,33 @@
+var invariant = require('invariant').invariant;
+
+// Seeded random numbers for the simulation, so replays and restored
+// snapshots play out the same.  The simulation must use this instead of
+// Math.random.  Xorshift32, which only needs 32 bit integer operations.
+var state = 1;
+
+exports.seed = function (seed) {
+  invariant(typeof seed === 'number', 'seed must be a number');
+  // Xorshift is stuck at zero
+  state = (seed >>> 0) || 1;
+};
+
+// Returns a number in [0, 1)
+exports.random = function () {
+  state ^= state << 13;
+  state ^= state >>> 17;
+  state ^= state << 5;
+  return (state >>> 0) / 4294967296;
+};
+
+// Returns an integer in [0, n)
+exports.randomInt = function (n) {
+  return Math.floor(exports.random() * n);
+};
+
+exports.getState = function () {
+  return state >>> 0;
+};
+
+exports.setState = function (new_state) {
+  exports.seed(new_state);
+};
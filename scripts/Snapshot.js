@@ -0,0 +1,67 @@
+// Helpers for snapshotting simulation state.
+//
+// Simulation objects mix plain data with closures, so snapshots only contain
+// the data.  To restore, the owning module rebuilds the object normally (so
+// its functions exist again) and then copies the saved data back over it.
+
+// Returns a deep copy of value with all functions removed.  The result is
+// safe to JSON.stringify.
+var serialize = function (value) {
+  if (typeof value === 'function') {
+    return undefined;
+  }
+  if (value === null || typeof value !== 'object') {
+    return value;
+  }
+  if (Array.isArray(value)) {
+    var arr = [];
+    for (var i = 0; i < value.length; i++) {
+      var v = serialize(value[i]);
+      arr.push(v === undefined ? null : v);
+    }
+    return arr;
+  }
+  var ret = {};
+  for (var key in value) {
+    if (!value.hasOwnProperty(key) || typeof value[key] === 'function') {
+      continue;
+    }
+    ret[key] = serialize(value[key]);
+  }
+  return ret;
+};
+exports.serialize = serialize;
+
+// Copies serialized data back into target.  Nested objects that already exist
+// on target are updated in place, so their functions are preserved.  Data
+// keys missing from the snapshot are removed from target, unless they are
+// listed in the optional preserve object.
+var copyInto = function (target, data, preserve) {
+  preserve = preserve || {};
+  if (Array.isArray(data)) {
+    target.length = data.length;
+  } else {
+    for (var key in target) {
+      if (target.hasOwnProperty(key) &&
+          typeof target[key] !== 'function' &&
+          !(key in data) &&
+          !(key in preserve)) {
+        delete target[key];
+      }
+    }
+  }
+
+  for (var key in data) {
+    var value = data[key];
+    var existing = target[key];
+    if (value !== null && typeof value === 'object' &&
+        existing !== null && typeof existing === 'object' &&
+        Array.isArray(value) === Array.isArray(existing)) {
+      copyInto(existing, value);
+    } else {
+      target[key] = serialize(value);
+    }
+  }
+  return target;
+};
+exports.copyInto = copyInto;
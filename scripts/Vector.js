@@ -1,5 +1,6 @@
 var _ = require('underscore');
 var invariant = require('invariant').invariant;
+var Random = require('Random');
 
 module.exports = {
   add: function (v1, v2) {
@@ -119,8 +120,8 @@ module.exports = {
 
   randDir2: function () {
     var vec = [
-      (Math.random() - 0.5) * 2,
-      (Math.random() - 0.5) * 2,
+      (Random.random() - 0.5) * 2,
+      (Random.random() - 0.5) * 2,
     ];
     return this.normalize(vec);
   },
@@ -1,4 +1,5 @@
 // This file is for constants and global utility functions
+// Mirrored in src/rts/PropertyIDs.h, PropertyIDsTest checks they match
 exports.EntityProperties = {
   P_CAPPABLE: 815586235,
   P_TARGETABLE: 463132888,
@@ -8,6 +9,26 @@ exports.EntityProperties = {
   P_UNIT: 118468328,
 };
 
+// Bit of each property in an entity's property mask, by hashed id.  JS
+// bitwise operators are 32 bit, so there can be at most 32 properties.
+exports.PropertyBits = (function () {
+  var bits = {};
+  var bit = 0;
+  for (var name in exports.EntityProperties) {
+    bits[exports.EntityProperties[name]] = 1 << bit++;
+  }
+  return bits;
+})();
+
+// Returns the mask of an array of hashed property ids
+exports.propertyMask = function (properties) {
+  var mask = 0;
+  for (var i = 0; i < properties.length; i++) {
+    mask |= exports.PropertyBits[properties[i]];
+  }
+  return mask;
+};
+
 exports.IDConst = {
   NO_PLAYER: 0,
   NO_ENTITY: 0,
@@ -15,9 +15,14 @@ var Entity = require('Entity');
 var MessageHub = require('MessageHub');
 var Pathing = require('Pathing');
 var Player = require('Player');
+var Random = require('Random');
+var Snapshot = require('Snapshot');
 var Team = require('Team');
 var Visibility = require('Visibility');
 
+// Native chrome trace spans, a no-op unless tracing is enabled
+var trace = runtime.trace;
+
 var vps_to_win = null;
 
 var elapsed_time = 0;
@@ -117,7 +122,8 @@ exports.getNearbyEntities = function (pos2, range, callback) {
   });
 };
 
-exports.init = function (game_def) {
+exports.init = function (game_def, seed) {
+  Random.seed(seed);
   vps_to_win = must_have_idx(game_def, 'vps_to_win');
   var map_def = must_have_idx(game_def, 'map_def');
   // Spawn map entities
@@ -162,6 +168,71 @@ exports.init = function (game_def) {
   running = true;
 };
 
+// Returns the encoded simulation state.  Should be called between ticks, after
+// render.
+exports.getSnapshot = function () {
+  invariant(
+    dead_entities.length === 0,
+    'cannot snapshot with unrendered dead entities'
+  );
+  return JSON.stringify({
+    elapsed_time: elapsed_time,
+    running: running,
+    last_id: last_id,
+    last_update_dt: last_update_dt,
+    random: Random.getState(),
+    entities: _.map(entities, function (entity) {
+      return entity.getSnapshot();
+    }),
+    players: Snapshot.serialize(players),
+    teams: Snapshot.serialize(teams),
+    messages: Snapshot.serialize(MessageHub.getSnapshot()),
+    chats: chats,
+    extra_renders: extra_renders,
+  });
+};
+
+// Alternative to init, resumes a game from a snapshot returned by getSnapshot.
+// The next render is a full baseline.
+exports.restore = function (game_def, encoded_snapshot) {
+  var snapshot = JSON.parse(encoded_snapshot);
+  vps_to_win = must_have_idx(game_def, 'vps_to_win');
+  var map_def = must_have_idx(game_def, 'map_def');
+  var player_defs = must_have_idx(game_def, 'player_defs');
+
+  elapsed_time = must_have_idx(snapshot, 'elapsed_time');
+  running = must_have_idx(snapshot, 'running');
+  last_id = must_have_idx(snapshot, 'last_id');
+  last_update_dt = must_have_idx(snapshot, 'last_update_dt');
+  Random.setState(must_have_idx(snapshot, 'random'));
+
+  players = {};
+  _.each(must_have_idx(snapshot, 'players'), function (data, pid) {
+    players[pid] = Snapshot.copyInto(Object.create(Player.prototype), data);
+  });
+  teams = {};
+  _.each(must_have_idx(snapshot, 'teams'), function (data, tid) {
+    teams[tid] = Snapshot.copyInto(Object.create(Team.prototype), data);
+  });
+  entities = {};
+  _.each(must_have_idx(snapshot, 'entities'), function (entity_snapshot) {
+    var entity = Entity.fromSnapshot(entity_snapshot);
+    entities[entity.getID()] = entity;
+  });
+  MessageHub.restore(must_have_idx(snapshot, 'messages'));
+  dead_entities = [];
+  chats = must_have_idx(snapshot, 'chats');
+  extra_renders = must_have_idx(snapshot, 'extra_renders');
+
+  visibility_map = Visibility.VisibilityMap(map_def, player_defs.length);
+  visibility_map.updateMap(entities);
+  visibility_map.updateEntityVisibilities(entities);
+
+  extra_renders.push({
+    type: 'start',
+  });
+};
+
 var handle_player_input = function (input) {
   var type = must_have_idx(input, 'type');
   var from_pid = must_have_idx(input, 'from_pid');
@@ -212,17 +283,22 @@ exports.update = function (player_inputs, dt) {
   MessageHub.clearMessages();
 
   // issue player input
+  trace.begin('input');
   _.each(player_inputs, handle_player_input);
+  trace.end();
 
   // update entities
+  trace.begin('Entity.update');
   for (var eid in entities) {
     entities[eid].update(dt);
   }
+  trace.end();
 
 
   // TODO(zack): remove this, and replace with 'state creation'
   // when the time comes
   // 'resolve' entities
+  trace.begin('Entity.resolve');
   var eids_by_player = {};
   _.each(_.keys(players), function (pid) {
     eids_by_player[pid] = {};
@@ -241,7 +317,9 @@ exports.update = function (player_inputs, dt) {
       eids_by_player[pid][entity.getName()] = eid;
     }
   }
+  trace.end();
 
+  trace.begin('Pathing.stepAllForward');
   var new_bodies = Pathing.stepAllForward(entities, dt);
   for (var key in new_bodies) {
     var entity = must_have_idx(entities, key);
@@ -251,16 +329,21 @@ exports.update = function (player_inputs, dt) {
     entity.angle_ = body.angle;
     entity.path_ = body.path;
   }
+  trace.end();
 
   for (var pid in players) {
     players[pid].units = must_have_idx(eids_by_player, pid);
   }
 
   // spawn entities, handle resources, etc
+  trace.begin('handleMessages');
   handleMessages();
+  trace.end();
 
+  trace.begin('visibility');
   visibility_map.updateMap(entities);
   visibility_map.updateEntityVisibilities(entities);
+  trace.end();
 
   // check win condition
   _.some(teams, function (team) {
@@ -282,39 +365,8 @@ exports.update = function (player_inputs, dt) {
   return running;
 };
 
-var name_to_diff_func = {
-  __default: function (t, prev, next) {
-    if (prev === next) {
-      return null;
-    }
-    return [[t, next]];
-  },
-};
-var simplify_entity_renders = function (t, previous_renders, current_renders) {
-  var simple_renders = {};
-  _.each(current_renders, function (entity, id) {
-    var previous_render = previous_renders[id];
-    var simple_render = {};
-    _.each(entity, function (value, name) {
-      var differ = name_to_diff_func[name] || must_have_idx(name_to_diff_func, '__default');
-      var diff = differ(
-        t,
-        previous_render ? previous_render[name] : null,
-        value
-      );
-      // skip if value has no diff
-      if (diff) {
-        simple_render[name] = diff;
-      }
-    });
-    simple_renders[id] = simple_render;
-  });
-
-  return simple_renders;
-}
-
-var previous_entity_renders = {};
 exports.render = function () {
+  trace.begin('render');
   var t = elapsed_time;
   var entity_renders = {};
   var events = [];
@@ -344,6 +396,7 @@ exports.render = function () {
     render.size = size3;
 
     render.sight = game_entity.getSight();
+    render.speed = game_entity.getSpeed();
 
     render.pos = game_entity.getPosition2();
     render.angle = game_entity.getAngle();
@@ -357,7 +410,7 @@ exports.render = function () {
     game_entity.clearEvents();
     for (var i = 0; i < entity_events.length; i++) {
       var event = entity_events[i];
-      event.params.eid = eid;
+      event.params.eid = game_entity.getID();
       events.push(event);
     }
   }
@@ -376,18 +429,12 @@ exports.render = function () {
     };
   });
 
-  var final_entity_renders = simplify_entity_renders(
-    t,
-    previous_entity_renders,
-    entity_renders
-  );
-  previous_entity_renders = entity_renders;
-
   var full_render = {
     type: 'render',
     t: t,
     dt: last_update_dt,
-    entities: final_entity_renders,
+    // Full entity states, the server sends only what changed
+    entities: entity_renders,
     events: events,
     players: player_render,
     teams: vps,
@@ -398,5 +445,9 @@ exports.render = function () {
   var renders = extra_renders;
   extra_renders = [];
   renders.push(full_render);
-  return JSON.stringify(renders);
+  trace.begin('JSON.stringify');
+  var encoded = JSON.stringify(renders);
+  trace.end();
+  trace.end();
+  return encoded;
 };
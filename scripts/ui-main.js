@@ -1,5 +1,6 @@
 var must_have_idx = require('must_have_idx');
 var invariant = require('invariant').invariant;
+var Prediction = require('Prediction');
 var VisibilityMap = require('Visibility').VisibilityMap;
 
 var NativeUI = runtime.binding('nativeui');
@@ -7,6 +8,7 @@ var NativeUI = runtime.binding('nativeui');
 var UI = function () {
   this.initialized = false;
   this.visibilityMap = null;
+  this.prediction = new Prediction();
 
   this.init = function (params) {
     invariant(this.initialized === false, 'ui already initialized');
@@ -23,8 +25,19 @@ var UI = function () {
     );
   };
 
-  this.update = function (entities) {
+  this.order = function (order) {
+    this.prediction.addOrder(order);
+  };
+
+  // entities are the local player's, dt is the game time since the last
+  // update.  Returns the predicted units, see Prediction.step.
+  this.update = function (entities, dt) {
     this.visibilityMap.updateMap_UI(entities);
+    var units = {};
+    for (var i = 0; i < entities.length; i++) {
+      units[entities[i].id] = entities[i];
+    }
+    return this.prediction.step(units, dt);
   };
 };
 
@@ -0,0 +1,43 @@
+#include "common/ClockSync.h"
+#include <algorithm>
+
+const size_t ClockSync::kWindow;
+
+ClockSync::ClockSync() {
+  reset();
+}
+
+void ClockSync::reset() {
+  next_ = 0;
+  count_ = 0;
+  offset_ = 0.0;
+  rtt_ = 0.0;
+  jitter_ = 0.0;
+}
+
+void ClockSync::addSample(
+    double sent,
+    double received,
+    double replied,
+    double now) {
+  sample &s = samples_[next_];
+  // The time the peer held the ping isn't network delay
+  s.rtt = std::max((now - sent) - (replied - received), 0.0);
+  s.offset = ((received - sent) + (replied - now)) / 2.0;
+  next_ = (next_ + 1) % kWindow;
+  count_ = std::min(count_ + 1, kWindow);
+
+  const sample *best = &samples_[0];
+  for (size_t i = 1; i < count_; i++) {
+    if (samples_[i].rtt < best->rtt) {
+      best = &samples_[i];
+    }
+  }
+  offset_ = best->offset;
+  rtt_ = best->rtt;
+  double excess = 0.0;
+  for (size_t i = 0; i < count_; i++) {
+    excess += samples_[i].rtt - rtt_;
+  }
+  jitter_ = excess / count_;
+}
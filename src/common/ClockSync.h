@@ -0,0 +1,54 @@
+#ifndef SRC_COMMON_CLOCKSYNC_H_
+#define SRC_COMMON_CLOCKSYNC_H_
+
+#include <cstddef>
+
+// Estimates the offset of a peer's clock from NTP style exchanges: a ping
+// carries the local send time, the peer stamps when it received the ping
+// and when it replied, and the pong's arrival closes the loop.
+//
+// Queueing only ever adds delay, so of the recent exchanges the one with the
+// shortest round trip gives the best offset.
+class ClockSync {
+ public:
+  ClockSync();
+
+  // A ping sent at local time sent was received at remote time received,
+  // answered at remote time replied, and the answer arrived at local time
+  // now.
+  void addSample(double sent, double received, double replied, double now);
+  // Forgets all samples, e.g. when the peer's clock is replaced.
+  void reset();
+
+  bool hasEstimate() const {
+    return count_ > 0;
+  }
+  // Remote time is about local time plus the offset.
+  double getOffset() const {
+    return offset_;
+  }
+  // Shortest recent round trip, in seconds.
+  double getRTT() const {
+    return rtt_;
+  }
+  // Average amount recent round trips took over the shortest.
+  double getJitter() const {
+    return jitter_;
+  }
+
+ private:
+  struct sample {
+    double offset;
+    double rtt;
+  };
+  static const size_t kWindow = 8;
+
+  sample samples_[kWindow];
+  size_t next_;
+  size_t count_;
+  double offset_;
+  double rtt_;
+  double jitter_;
+};
+
+#endif  // SRC_COMMON_CLOCKSYNC_H_
@@ -285,3 +285,119 @@ float boxBoxCollision(
     return minT;
   }
 }
+
+Frustum::Frustum() : unbounded(true) {
+  for (auto &plane : planes) {
+    plane = glm::vec4(0.f);
+  }
+  for (auto &corner : corners) {
+    corner = glm::vec3(0.f);
+  }
+}
+
+Frustum::Frustum(const glm::mat4 &view_proj) : unbounded(false) {
+  // Gribb and Hartmann, each plane is the w row plus or minus another row
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(
+        view_proj[0][i],
+        view_proj[1][i],
+        view_proj[2][i],
+        view_proj[3][i]);
+  }
+  for (int i = 0; i < 3; i++) {
+    planes[2 * i] = rows[3] + rows[i];
+    planes[2 * i + 1] = rows[3] - rows[i];
+  }
+
+  const glm::mat4 inverse = glm::inverse(view_proj);
+  for (int i = 0; i < 8; i++) {
+    const glm::vec4 ndc(
+        i & 1 ? 1.f : -1.f,
+        i & 2 ? 1.f : -1.f,
+        i & 4 ? 1.f : -1.f,
+        1.f);
+    const glm::vec4 corner = inverse * ndc;
+    corners[i] = glm::vec3(corner) / corner.w;
+  }
+}
+
+bool Frustum::intersectsAABB(
+    const glm::vec3 &center,
+    const glm::vec3 &size) const {
+  const glm::vec3 half = size / 2.f;
+  for (const auto &plane : planes) {
+    const glm::vec3 normal(plane);
+    // The corner furthest along the normal
+    const glm::vec3 corner = center + glm::vec3(
+        normal.x >= 0.f ? half.x : -half.x,
+        normal.y >= 0.f ? half.y : -half.y,
+        normal.z >= 0.f ? half.z : -half.z);
+    if (glm::dot(normal, corner) + plane.w < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const {
+  for (const auto &plane : planes) {
+    const glm::vec3 normal(plane);
+    if (glm::dot(normal, center) + plane.w < -radius * glm::length(normal)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::groundBounds(
+    float zmin,
+    float zmax,
+    glm::vec2 &min,
+    glm::vec2 &max) const {
+  if (unbounded) {
+    min = glm::vec2(-HUGE_VAL);
+    max = glm::vec2(HUGE_VAL);
+    return true;
+  }
+  // The frustum cut to the slab is convex, and its corners are the ends of
+  // the frustum's edges cut to the slab
+  bool found = false;
+  auto add_point = [&](const glm::vec3 &p) {
+    if (!found) {
+      min = max = glm::vec2(p);
+      found = true;
+    } else {
+      min = glm::min(min, glm::vec2(p));
+      max = glm::max(max, glm::vec2(p));
+    }
+  };
+  for (int i = 0; i < 8; i++) {
+    for (int bit = 1; bit < 8; bit <<= 1) {
+      if (i & bit) {
+        continue;
+      }
+      const glm::vec3 &a = corners[i];
+      const glm::vec3 &b = corners[i | bit];
+      float t0 = 0.f;
+      float t1 = 1.f;
+      const float dz = b.z - a.z;
+      if (dz == 0.f) {
+        if (a.z < zmin || a.z > zmax) {
+          continue;
+        }
+      } else {
+        const float tmin = (zmin - a.z) / dz;
+        const float tmax = (zmax - a.z) / dz;
+        t0 = std::max(t0, std::min(tmin, tmax));
+        t1 = std::min(t1, std::max(tmin, tmax));
+        if (t0 > t1) {
+          continue;
+        }
+      }
+      add_point(a + t0 * (b - a));
+      add_point(a + t1 * (b - a));
+    }
+  }
+  return found;
+}
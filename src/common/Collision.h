@@ -64,6 +64,31 @@ float rayAABBIntersection(
     const glm::vec3 &center,
     const glm::vec3 &size);
 
+// What a camera can see, for culling
+struct Frustum {
+  // Sees everything
+  Frustum();
+  // Of a projection * view matrix
+  explicit Frustum(const glm::mat4 &view_proj);
+
+  // Conservative, boxes just outside a corner can count as inside
+  bool intersectsAABB(const glm::vec3 &center, const glm::vec3 &size) const;
+  bool intersectsSphere(const glm::vec3 &center, float radius) const;
+  // Sets min and max to bound on the ground the part of the frustum
+  // between heights zmin and zmax.  Returns false if no part is.
+  bool groundBounds(
+      float zmin,
+      float zmax,
+      glm::vec2 &min,
+      glm::vec2 &max) const;
+
+  bool unbounded;
+  // Facing inward, (normal, distance)
+  glm::vec4 planes[6];
+  // Corner i is at ndc x, y, z = -1 or 1 by bits 0, 1 and 2 of i
+  glm::vec3 corners[8];
+};
+
 // Returns the time of intersection in [0, dt] or NO_INTERESECTION
 float boxBoxCollision(
     const Rect &r1,
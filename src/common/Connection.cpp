@@ -0,0 +1,113 @@
+#include "common/Connection.h"
+#include <limits>
+
+Connection::Connection()
+  : start_(Clock::now()),
+    epoch_(0),
+    remoteEpoch_(-1),
+    pingInterval_(0.0),
+    lastPing_(-std::numeric_limits<double>::infinity()),
+    rawBatches_(false) {
+}
+
+bool Connection::isRawBatch(const std::string &payload) const {
+  if (!rawBatches_) {
+    return false;
+  }
+  size_t i = payload.find_first_not_of(" \t\r\n");
+  return i != std::string::npos && payload[i] == '[';
+}
+
+double Connection::localTime() const {
+  if (clock_) {
+    return clock_();
+  }
+  return std::chrono::duration<double>(Clock::now() - start_).count();
+}
+
+void Connection::setClock(std::function<double()> clock) {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  clock_ = clock;
+  epoch_++;
+  lastPing_ = -std::numeric_limits<double>::infinity();
+  // Our own pings in flight are stamped with the old clock
+  clockSync_.reset();
+}
+
+double Connection::getLocalTime() {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  return localTime();
+}
+
+void Connection::setPingInterval(double interval) {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  pingInterval_ = interval;
+}
+
+bool Connection::getRemoteTime(double &t) {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  if (!clockSync_.hasEstimate()) {
+    return false;
+  }
+  t = localTime() + clockSync_.getOffset();
+  return true;
+}
+
+ClockSync Connection::getClockSync() {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  return clockSync_;
+}
+
+bool Connection::handleTimeMessage(
+    const Json::Value &msg,
+    Json::Value &reply) {
+  if (!msg.isObject()) {
+    return false;
+  }
+  const Json::Value &type = msg["type"];
+  if (type == "ping") {
+    std::unique_lock<std::mutex> lock(timeMutex_);
+    const double received = localTime();
+    reply = Json::Value();
+    reply["type"] = "pong";
+    reply["sent"] = msg["sent"];
+    reply["sent_epoch"] = msg["epoch"];
+    reply["received"] = received;
+    reply["epoch"] = epoch_;
+    reply["replied"] = localTime();
+    return true;
+  }
+  if (type == "pong") {
+    std::unique_lock<std::mutex> lock(timeMutex_);
+    reply = Json::Value();
+    if (msg["sent_epoch"].asInt() != epoch_) {
+      return true;
+    }
+    const int remote_epoch = msg["epoch"].asInt();
+    if (remote_epoch != remoteEpoch_) {
+      clockSync_.reset();
+      remoteEpoch_ = remote_epoch;
+    }
+    clockSync_.addSample(
+        msg["sent"].asDouble(),
+        msg["received"].asDouble(),
+        msg["replied"].asDouble(),
+        localTime());
+    return true;
+  }
+  return false;
+}
+
+bool Connection::nextPing(Json::Value &ping) {
+  std::unique_lock<std::mutex> lock(timeMutex_);
+  const double now = localTime();
+  if (pingInterval_ <= 0.0 || now - lastPing_ < pingInterval_) {
+    return false;
+  }
+  lastPing_ = now;
+  ping = Json::Value();
+  ping["type"] = "ping";
+  ping["sent"] = now;
+  ping["epoch"] = epoch_;
+  return true;
+}
@@ -0,0 +1,107 @@
+#ifndef SRC_COMMON_CONNECTION_H_
+#define SRC_COMMON_CONNECTION_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <json/json.h>
+#include "common/Clock.h"
+#include "common/ClockSync.h"
+
+enum NetChannel {
+  // Every message is delivered once, in order.  Orders, chat, game events.
+  NET_CHANNEL_RELIABLE = 0,
+  // Messages may be lost, and only ones newer than the last delivered are
+  // delivered.  Snapshots, which are superseded by the next one anyway.
+  NET_CHANNEL_SEQUENCED = 1,
+  // Messages may be lost or arrive out of order, and are delivered as they
+  // arrive.  Clock sync pings, which are useless once late.
+  NET_CHANNEL_UNRELIABLE = 2,
+
+  NET_CHANNEL_COUNT,
+};
+
+// A message connection to one peer, see NetConnection (TCP) and
+// UDPConnection.
+//
+// Connections also keep time: each end answers the other's pings from its
+// network thread, so either end can estimate the other's clock.  Ping and
+// pong messages never reach the queue.
+class Connection {
+ public:
+  Connection();
+  virtual ~Connection() { }
+
+  // Reliable transports ignore the channel.
+  virtual void sendPacket(const Json::Value &msg, NetChannel channel) = 0;
+  void sendPacket(const Json::Value &msg) {
+    sendPacket(msg, NET_CHANNEL_RELIABLE);
+  }
+
+  // Returns all received messages, without blocking.
+  virtual std::vector<Json::Value> drainQueue() = 0;
+  // Blocks until next message becomes available.
+  // throws an exception if the connection is closed unexpectedly
+  // throws an exception on timeout (arg version)
+  virtual Json::Value readNext() = 0;
+  virtual Json::Value readNext(size_t millis) = 0;
+
+  // With raw batches on, payloads that are JSON arrays, the batches of game
+  // messages, are queued as text for readNextBatch instead of being parsed.
+  // Pings and pongs are handled as always.
+  void setRawBatches(bool raw_batches) {
+    rawBatches_ = raw_batches;
+  }
+  // Blocks at most millis for the next raw batch.  Throws like readNext.
+  virtual std::string readNextBatch(size_t millis) = 0;
+
+  virtual size_t getBytesSent() = 0;
+  virtual size_t getBytesReceived() = 0;
+
+  virtual bool running() const = 0;
+  virtual void stop() = 0;
+
+  // The clock, in seconds, that this end's pongs report.  Defaults to
+  // seconds since the connection was created.  The peer's estimate starts
+  // over when it changes.
+  void setClock(std::function<double()> clock);
+  double getLocalTime();
+  // Pings the peer every interval seconds, 0 to stop.
+  void setPingInterval(double interval);
+  // Sets t to the peer's clock now, as estimated from pongs.  Returns false
+  // before the first pong.
+  bool getRemoteTime(double &t);
+  ClockSync getClockSync();
+
+ protected:
+  // Call from the network thread with every message as it arrives.  Returns
+  // true if msg was a ping or pong, filling reply if there is an answer to
+  // send on the unreliable channel.
+  bool handleTimeMessage(const Json::Value &msg, Json::Value &reply);
+  // Call from the network thread periodically.  Returns true and fills ping
+  // if one is due, to send on the unreliable channel.
+  bool nextPing(Json::Value &ping);
+  // True if payload goes to the raw batch queue
+  bool isRawBatch(const std::string &payload) const;
+
+ private:
+  // Requires timeMutex_
+  double localTime() const;
+
+  std::mutex timeMutex_;
+  const Clock::time_point start_;
+  std::function<double()> clock_;
+  // Bumped when clock_ changes, so stale samples can be told apart
+  int epoch_;
+  int remoteEpoch_;
+  double pingInterval_;
+  double lastPing_;
+  ClockSync clockSync_;
+  std::atomic<bool> rawBatches_;
+};
+
+typedef std::shared_ptr<Connection> ConnectionPtr;
+
+#endif  // SRC_COMMON_CONNECTION_H_
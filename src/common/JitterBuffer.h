@@ -0,0 +1,87 @@
+#ifndef SRC_COMMON_JITTERBUFFER_H_
+#define SRC_COMMON_JITTERBUFFER_H_
+
+#include <map>
+#include <utility>
+#include "common/RenderClock.h"
+
+// Holds snapshots from the server until the render clock reaches them, so
+// they are played out evenly however unevenly they arrive.  The playout
+// delay comes from a RenderClock fed with each snapshot's arrival, so it
+// follows the measured lateness and its variation.
+//
+// A snapshot of game time t is due once the render time passes t - dt: from
+// then on the renderer interpolates toward it, and its events happened.
+template<typename T>
+class JitterBuffer {
+ public:
+  JitterBuffer()
+    : lastPlayed_(-1.0),
+      dropped_(0) {
+  }
+
+  // Holds value, the snapshot of game time t that arrived when the server's
+  // clock read server_time.  dt is the time between snapshots.  Snapshots
+  // older than the last one played out are dropped.
+  void push(double t, double dt, double server_time, T value) {
+    clock_.addSnapshot(t, dt, server_time);
+    if (t <= lastPlayed_ || snapshots_.count(t)) {
+      dropped_++;
+      return;
+    }
+    snapshots_[t] = std::make_pair(dt, std::move(value));
+  }
+
+  // Pops the oldest held snapshot if it is due at render time render_t.
+  bool pop(double render_t, T &value) {
+    if (snapshots_.empty()) {
+      return false;
+    }
+    auto it = snapshots_.begin();
+    if (render_t < getDueTime(it)) {
+      return false;
+    }
+    lastPlayed_ = it->first;
+    value = std::move(it->second.second);
+    snapshots_.erase(it);
+    return true;
+  }
+
+  bool empty() const {
+    return snapshots_.empty();
+  }
+  size_t size() const {
+    return snapshots_.size();
+  }
+  // Render time the oldest held snapshot is due.  Requires !empty().
+  double getNextDueTime() const {
+    return getDueTime(snapshots_.begin());
+  }
+  // Game time of the newest snapshot played out, or -1.
+  double getLastPlayed() const {
+    return lastPlayed_;
+  }
+  // Snapshots that arrived too late, or twice
+  size_t getDropped() const {
+    return dropped_;
+  }
+
+  const RenderClock &getClock() const {
+    return clock_;
+  }
+
+ private:
+  typedef std::map<double, std::pair<double, T>> snapshot_map;
+
+  static double getDueTime(typename snapshot_map::const_iterator it) {
+    return it->first - it->second.first;
+  }
+
+  RenderClock clock_;
+  // t => (dt, snapshot)
+  snapshot_map snapshots_;
+  double lastPlayed_;
+  size_t dropped_;
+};
+
+#endif  // SRC_COMMON_JITTERBUFFER_H_
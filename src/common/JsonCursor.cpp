@@ -0,0 +1,356 @@
+#include "common/JsonCursor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "common/Exception.h"
+
+// Longest number text read, jsoncpp writes doubles with 17 digits
+static const size_t MAX_NUMBER_LENGTH = 64;
+
+JsonCursor::JsonCursor(const char *begin, const char *end)
+  : begin_(begin),
+    end_(end),
+    pos_(begin) {
+}
+
+JsonCursor::JsonCursor(const std::string &text)
+  : begin_(text.data()),
+    end_(text.data() + text.size()),
+    pos_(text.data()) {
+}
+
+void JsonCursor::fail(const char *what) const {
+  throw network_exception(
+      std::string("json ") + what + " at offset " + std::to_string(tell()));
+}
+
+void JsonCursor::skipSpace() {
+  while (pos_ != end_
+      && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t')) {
+    pos_++;
+  }
+}
+
+bool JsonCursor::atEnd() {
+  skipSpace();
+  return pos_ == end_;
+}
+
+void JsonCursor::expect(char c) {
+  skipSpace();
+  if (pos_ == end_ || *pos_ != c) {
+    fail("unexpected character");
+  }
+  pos_++;
+}
+
+void JsonCursor::expectLiteral(const char *literal) {
+  const size_t len = strlen(literal);
+  if (static_cast<size_t>(end_ - pos_) < len
+      || strncmp(pos_, literal, len) != 0) {
+    fail("bad literal");
+  }
+  pos_ += len;
+}
+
+JsonCursor::Type JsonCursor::peek() {
+  skipSpace();
+  if (pos_ == end_) {
+    fail("unexpected end");
+  }
+  switch (*pos_) {
+    case '{': return OBJECT;
+    case '[': return ARRAY;
+    case '"': return STRING;
+    case 't':
+    case 'f': return BOOL;
+    case 'n': return NULL_VALUE;
+    default: return NUMBER;
+  }
+}
+
+void JsonCursor::beginObject() {
+  expect('{');
+}
+
+bool JsonCursor::atClose(char close) {
+  skipSpace();
+  if (pos_ != end_ && *pos_ == ',') {
+    pos_++;
+    skipSpace();
+  }
+  if (pos_ == end_) {
+    fail("unexpected end");
+  }
+  if (*pos_ == close) {
+    pos_++;
+    return true;
+  }
+  return false;
+}
+
+bool JsonCursor::nextKey(std::string &key) {
+  if (atClose('}')) {
+    return false;
+  }
+  readString(key);
+  expect(':');
+  return true;
+}
+
+void JsonCursor::beginArray() {
+  expect('[');
+}
+
+bool JsonCursor::nextElement() {
+  return !atClose(']');
+}
+
+bool JsonCursor::readBool() {
+  skipSpace();
+  if (pos_ != end_ && *pos_ == 't') {
+    expectLiteral("true");
+    return true;
+  }
+  expectLiteral("false");
+  return false;
+}
+
+const char * JsonCursor::scanNumber() const {
+  const char *p = pos_;
+  while (p != end_
+      && ((*p >= '0' && *p <= '9')
+        || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) {
+    p++;
+  }
+  return p;
+}
+
+double JsonCursor::readDouble() {
+  skipSpace();
+  const char *number_end = scanNumber();
+  const size_t len = number_end - pos_;
+  if (len == 0 || len >= MAX_NUMBER_LENGTH) {
+    fail("bad number");
+  }
+  // The text may not be terminated where the number is
+  char buf[MAX_NUMBER_LENGTH];
+  memcpy(buf, pos_, len);
+  buf[len] = '\0';
+  char *parsed_end;
+  const double ret = strtod(buf, &parsed_end);
+  if (parsed_end != buf + len) {
+    fail("bad number");
+  }
+  pos_ = number_end;
+  return ret;
+}
+
+uint64_t JsonCursor::readUInt64() {
+  skipSpace();
+  const char *number_end = scanNumber();
+  uint64_t ret = 0;
+  const char *p = pos_;
+  for ( ; p != number_end && *p >= '0' && *p <= '9'; p++) {
+    ret = 10 * ret + (*p - '0');
+  }
+  if (p == pos_ || p != number_end) {
+    // Written as a double
+    return static_cast<uint64_t>(readDouble());
+  }
+  pos_ = number_end;
+  return ret;
+}
+
+// Reads the 4 hex digits of a \u escape
+static bool read_hex4(const char *p, const char *end, uint32_t &value) {
+  if (end - p < 4) {
+    return false;
+  }
+  value = 0;
+  for (int i = 0; i < 4; i++) {
+    const char c = p[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9') {
+      value |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      value |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      value |= c - 'A' + 10;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void append_utf8(uint32_t code_point, std::string &str) {
+  if (code_point < 0x80) {
+    str += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    str += static_cast<char>(0xC0 | (code_point >> 6));
+    str += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    str += static_cast<char>(0xE0 | (code_point >> 12));
+    str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    str += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    str += static_cast<char>(0xF0 | (code_point >> 18));
+    str += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    str += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+void JsonCursor::readString(std::string &str) {
+  expect('"');
+  str.clear();
+  while (true) {
+    // Copy runs without escapes at once
+    const char *run = pos_;
+    while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+      pos_++;
+    }
+    str.append(run, pos_);
+    if (pos_ == end_) {
+      fail("unterminated string");
+    }
+    if (*pos_++ == '"') {
+      return;
+    }
+    if (pos_ == end_) {
+      fail("unterminated string");
+    }
+    const char escape = *pos_++;
+    switch (escape) {
+      case '"': str += '"'; break;
+      case '\\': str += '\\'; break;
+      case '/': str += '/'; break;
+      case 'b': str += '\b'; break;
+      case 'f': str += '\f'; break;
+      case 'n': str += '\n'; break;
+      case 'r': str += '\r'; break;
+      case 't': str += '\t'; break;
+      case 'u': {
+        uint32_t code_point;
+        if (!read_hex4(pos_, end_, code_point)) {
+          fail("bad unicode escape");
+        }
+        pos_ += 4;
+        // The second half of a surrogate pair follows as its own escape
+        uint32_t low;
+        if (code_point >= 0xD800 && code_point < 0xDC00
+            && end_ - pos_ >= 2 && pos_[0] == '\\' && pos_[1] == 'u'
+            && read_hex4(pos_ + 2, end_, low)
+            && low >= 0xDC00 && low < 0xE000) {
+          code_point = 0x10000 + ((code_point - 0xD800) << 10)
+            + (low - 0xDC00);
+          pos_ += 6;
+        }
+        append_utf8(code_point, str);
+        break;
+      }
+      default:
+        fail("bad escape");
+    }
+  }
+}
+
+void JsonCursor::readValue(Json::Value &value) {
+  switch (peek()) {
+    case NULL_VALUE:
+      expectLiteral("null");
+      value = Json::Value();
+      break;
+    case BOOL:
+      value = readBool();
+      break;
+    case STRING:
+      value = readString();
+      break;
+    case NUMBER: {
+      // Integers stay integers, like jsoncpp reads them
+      const char *number_end = scanNumber();
+      if (std::find_if(pos_, number_end, [](char c) {
+            return c == '.' || c == 'e' || c == 'E';
+          }) != number_end) {
+        value = readDouble();
+      } else if (*pos_ == '-') {
+        value = static_cast<Json::Int64>(readDouble());
+      } else {
+        const uint64_t n = readUInt64();
+        if (n <= static_cast<uint64_t>(Json::Value::maxInt)) {
+          value = static_cast<Json::Int64>(n);
+        } else {
+          value = static_cast<Json::UInt64>(n);
+        }
+      }
+      break;
+    }
+    case ARRAY:
+      value = Json::Value(Json::arrayValue);
+      beginArray();
+      while (nextElement()) {
+        readValue(value[value.size()]);
+      }
+      break;
+    case OBJECT: {
+      value = Json::Value(Json::objectValue);
+      beginObject();
+      std::string key;
+      while (nextKey(key)) {
+        readValue(value[key]);
+      }
+      break;
+    }
+  }
+}
+
+void JsonCursor::skipValue() {
+  switch (peek()) {
+    case NULL_VALUE:
+      expectLiteral("null");
+      break;
+    case BOOL:
+      readBool();
+      break;
+    case NUMBER: {
+      const char *number_end = scanNumber();
+      if (number_end == pos_) {
+        fail("unexpected character");
+      }
+      pos_ = number_end;
+      break;
+    }
+    case STRING: {
+      expect('"');
+      while (pos_ != end_ && *pos_ != '"') {
+        if (*pos_ == '\\') {
+          pos_++;
+        }
+        if (pos_ != end_) {
+          pos_++;
+        }
+      }
+      if (pos_ == end_) {
+        fail("unterminated string");
+      }
+      pos_++;
+      break;
+    }
+    case ARRAY:
+      beginArray();
+      while (nextElement()) {
+        skipValue();
+      }
+      break;
+    case OBJECT:
+      beginObject();
+      while (atClose('}') == false) {
+        skipValue();
+        expect(':');
+        skipValue();
+      }
+      break;
+  }
+}
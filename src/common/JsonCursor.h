@@ -0,0 +1,88 @@
+#ifndef SRC_COMMON_JSONCURSOR_H_
+#define SRC_COMMON_JSONCURSOR_H_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <json/json.h>
+
+// Reads JSON text front to back in one pass, without building a
+// Json::Value, so decoders can put each value straight where it belongs.
+// The caller walks the structure it expects: beginObject then nextKey until
+// it returns false, beginArray then nextElement until it returns false, and
+// a read or skipValue for every value.
+//
+// Commas are only checked for loosely, this is for messages from our own
+// writer.  Malformed text, or a value of the wrong type, throws
+// network_exception.
+class JsonCursor {
+ public:
+  enum Type {
+    NULL_VALUE,
+    BOOL,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+  };
+
+  // The text must outlive the cursor
+  JsonCursor(const char *begin, const char *end);
+  explicit JsonCursor(const std::string &text);
+
+  // Type of the next value
+  Type peek();
+
+  void beginObject();
+  // Reads the next key of the current object, or consumes the closing
+  // brace and returns false.  key's memory is reused.
+  bool nextKey(std::string &key);
+  void beginArray();
+  // Returns false, consuming the closing bracket, if the current array has
+  // no more elements.
+  bool nextElement();
+
+  bool readBool();
+  double readDouble();
+  float readFloat() {
+    return static_cast<float>(readDouble());
+  }
+  uint64_t readUInt64();
+  // Reads a string into str, reusing its memory
+  void readString(std::string &str);
+  std::string readString() {
+    std::string str;
+    readString(str);
+    return str;
+  }
+  // Reads a whole value, for parts of a message that are kept as JSON
+  void readValue(Json::Value &value);
+  void skipValue();
+
+  // Offset of the cursor in the text, to seek back to
+  size_t tell() const {
+    return pos_ - begin_;
+  }
+  void seek(size_t offset) {
+    pos_ = begin_ + offset;
+  }
+  bool atEnd();
+
+ private:
+  void skipSpace();
+  // Skips space and requires the next character to be c
+  void expect(char c);
+  void expectLiteral(const char *literal);
+  // Skips space and a comma if there is one, then consumes close if it is
+  // next.  Returns whether it was.
+  bool atClose(char close);
+  // Returns the end of the number at pos_
+  const char *scanNumber() const;
+  // Throws network_exception
+  void fail(const char *what) const;
+
+  const char *begin_;
+  const char *end_;
+  const char *pos_;
+};
+
+#endif  // SRC_COMMON_JSONCURSOR_H_
@@ -0,0 +1,202 @@
+#include "common/LinkSimulator.h"
+#include <algorithm>
+#include <cmath>
+#include "common/util.h"
+
+// Tail heaviness of LINK_DELAY_PARETO, lower is heavier
+static const double PARETO_SHAPE = 3.0;
+
+link_conditions::link_conditions()
+  : latency(0.0),
+    jitter(0.0),
+    distribution(LINK_DELAY_UNIFORM),
+    loss(0.0),
+    lossBurst(1.0),
+    bandwidth(0.0),
+    queueLimit(0),
+    reorder(0.0),
+    duplicate(0.0) {
+}
+
+link_conditions parse_link_conditions(
+    const Json::Value &v,
+    const link_conditions &base) {
+  link_conditions ret = base;
+  ret.latency = v.get("latency", base.latency).asDouble();
+  ret.jitter = v.get("jitter", base.jitter).asDouble();
+  if (v.isMember("distribution")) {
+    auto name = v["distribution"].asString();
+    if (name == "uniform") {
+      ret.distribution = LINK_DELAY_UNIFORM;
+    } else if (name == "normal") {
+      ret.distribution = LINK_DELAY_NORMAL;
+    } else if (name == "pareto") {
+      ret.distribution = LINK_DELAY_PARETO;
+    } else {
+      invariant_violation("unknown delay distribution: " + name);
+    }
+  }
+  ret.loss = v.get("loss", base.loss).asDouble();
+  ret.lossBurst = v.get("loss_burst", base.lossBurst).asDouble();
+  ret.bandwidth = v.get("bandwidth", base.bandwidth).asDouble();
+  ret.queueLimit = v.get(
+      "queue_limit",
+      static_cast<Json::UInt64>(base.queueLimit)).asUInt64();
+  ret.reorder = v.get("reorder", base.reorder).asDouble();
+  ret.duplicate = v.get("duplicate", base.duplicate).asDouble();
+  return ret;
+}
+
+LinkSimulator::LinkSimulator(
+    const link_conditions &conditions,
+    uint32_t seed)
+  : conditions_(conditions),
+    nextStep_(0),
+    rng_(seed),
+    uniform_(0.0, 1.0),
+    normal_(0.0, 1.0),
+    losing_(false),
+    linkFreeTime_(0.0),
+    nextOrder_(0),
+    dropped_(0),
+    overflowed_(0),
+    reordered_(0),
+    duplicated_(0) {
+}
+
+static link_conditions lossy_link(double loss, double latency) {
+  link_conditions ret;
+  ret.loss = loss;
+  ret.latency = latency;
+  return ret;
+}
+
+LinkSimulator::LinkSimulator(double loss, double latency, uint32_t seed)
+  : LinkSimulator(lossy_link(loss, latency), seed) {
+}
+
+void LinkSimulator::addStep(double t, const link_conditions &conditions) {
+  invariant(
+      steps_.empty() || steps_.back().first <= t,
+      "link steps must be in time order");
+  steps_.push_back(std::make_pair(t, conditions));
+}
+
+void LinkSimulator::applySteps(double now) {
+  while (nextStep_ < steps_.size() && steps_[nextStep_].first <= now) {
+    conditions_ = steps_[nextStep_].second;
+    nextStep_++;
+  }
+}
+
+bool LinkSimulator::sampleLoss() {
+  const double loss = conditions_.loss;
+  if (loss <= 0.0) {
+    losing_ = false;
+    return false;
+  }
+  if (loss >= 1.0) {
+    return true;
+  }
+  if (conditions_.lossBurst <= 1.0) {
+    return uniform_(rng_) < loss;
+  }
+  // Two state chain.  A burst ends with chance 1 / lossBurst per datagram,
+  // and starts at the rate that keeps the overall loss at loss.
+  const double end = 1.0 / conditions_.lossBurst;
+  const double start = std::min(1.0, loss * end / (1.0 - loss));
+  losing_ = losing_ ? uniform_(rng_) >= end : uniform_(rng_) < start;
+  return losing_;
+}
+
+double LinkSimulator::sampleDelay() {
+  double delay = conditions_.latency;
+  const double jitter = conditions_.jitter;
+  if (jitter > 0.0) {
+    switch (conditions_.distribution) {
+    case LINK_DELAY_UNIFORM:
+      delay += jitter * (2.0 * uniform_(rng_) - 1.0);
+      break;
+    case LINK_DELAY_NORMAL:
+      delay += jitter * normal_(rng_);
+      break;
+    case LINK_DELAY_PARETO: {
+      // Pareto with scale x has mean x * shape / (shape - 1), pick x so
+      // the part over x averages jitter
+      const double scale = jitter * (PARETO_SHAPE - 1.0);
+      delay += scale / pow(1.0 - uniform_(rng_), 1.0 / PARETO_SHAPE) - scale;
+      break;
+    }
+    }
+  }
+  return std::max(0.0, delay);
+}
+
+void LinkSimulator::schedule(const std::string &packet, double due) {
+  delayed_packet delayed;
+  delayed.due = due;
+  delayed.order = nextOrder_++;
+  delayed.data = packet;
+  packets_.push_back(std::move(delayed));
+  std::push_heap(packets_.begin(), packets_.end(), later_packet());
+}
+
+void LinkSimulator::push(const std::string &packet, double now) {
+  applySteps(now);
+
+  // A capped link sends one datagram at a time, the rest wait in a queue
+  double sent = now;
+  if (conditions_.bandwidth > 0.0) {
+    const double start = std::max(now, linkFreeTime_);
+    const double queued = (start - now) * conditions_.bandwidth;
+    if (conditions_.queueLimit > 0
+        && queued + packet.size() > conditions_.queueLimit) {
+      overflowed_++;
+      return;
+    }
+    linkFreeTime_ = start + packet.size() / conditions_.bandwidth;
+    sent = linkFreeTime_;
+  }
+
+  if (sampleLoss()) {
+    dropped_++;
+    return;
+  }
+  if (conditions_.reorder > 0.0 && uniform_(rng_) < conditions_.reorder) {
+    reordered_++;
+    schedule(packet, sent);
+  } else {
+    schedule(packet, sent + sampleDelay());
+  }
+  if (conditions_.duplicate > 0.0 && uniform_(rng_) < conditions_.duplicate) {
+    duplicated_++;
+    schedule(packet, sent + sampleDelay());
+  }
+}
+
+bool LinkSimulator::pop(std::string &packet, double now) {
+  if (packets_.empty() || packets_.front().due > now) {
+    return false;
+  }
+  std::pop_heap(packets_.begin(), packets_.end(), later_packet());
+  packet.swap(packets_.back().data);
+  packets_.pop_back();
+  return true;
+}
+
+std::unique_ptr<LinkSimulator> make_link_simulator(
+    const Json::Value &config,
+    uint32_t seed) {
+  std::unique_ptr<LinkSimulator> ret;
+  if (!config.isObject() || !config.get("enabled", false).asBool()) {
+    return ret;
+  }
+  seed += config.get("seed", 0).asUInt();
+  ret.reset(new LinkSimulator(link_conditions(), seed));
+  link_conditions conditions;
+  for (const auto &step : config["script"]) {
+    conditions = parse_link_conditions(step, conditions);
+    ret->addStep(step.get("at", 0.0).asDouble(), conditions);
+  }
+  return ret;
+}
@@ -0,0 +1,143 @@
+#ifndef SRC_COMMON_LINKSIMULATOR_H_
+#define SRC_COMMON_LINKSIMULATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+enum LinkDelayDistribution {
+  // latency +- jitter
+  LINK_DELAY_UNIFORM,
+  // Normal around latency, with jitter as the standard deviation
+  LINK_DELAY_NORMAL,
+  // Never under latency, with a long tail averaging jitter on top
+  LINK_DELAY_PARETO,
+};
+
+// One direction of a simulated network path.  The defaults are a perfect
+// link.
+struct link_conditions {
+  link_conditions();
+
+  // Delay, in seconds
+  double latency;
+  double jitter;
+  LinkDelayDistribution distribution;
+  // Chance each datagram is dropped
+  double loss;
+  // Average number of datagrams dropped in a row.  Above 1, losses come in
+  // bursts, with the same overall rate.
+  double lossBurst;
+  // Bytes per second, 0 for no cap.  Datagrams queue behind each other
+  // while the link is busy.
+  double bandwidth;
+  // Bytes that can wait for a capped link before datagrams are dropped, 0
+  // for no limit.
+  size_t queueLimit;
+  // Chance a datagram skips the delay, arriving ahead of those sent before
+  // it.  Jitter reorders datagrams too.
+  double reorder;
+  // Chance a datagram arrives twice
+  double duplicate;
+};
+
+// Reads the fields present in v over base.  Times are in seconds,
+// "distribution" is "uniform", "normal" or "pareto", and "queue_limit" and
+// "loss_burst" use underscores.
+link_conditions parse_link_conditions(
+    const Json::Value &v,
+    const link_conditions &base = link_conditions());
+
+// Drops, delays, reorders and duplicates datagrams on their way to the
+// socket, so the transport and the game can be tested over loopback.  See
+// UDPConnection::setLinkSimulator.
+//
+// The conditions can be scripted to change over time, to see how the game
+// copes when a link gets worse or recovers.
+class LinkSimulator {
+ public:
+  explicit LinkSimulator(
+      const link_conditions &conditions,
+      uint32_t seed = 0);
+  // loss is the chance each datagram is dropped, latency is in seconds.
+  LinkSimulator(double loss, double latency, uint32_t seed = 0);
+
+  // Conditions change at each step's time, in the same clock as push.
+  // Steps must be in time order.
+  void addStep(double t, const link_conditions &conditions);
+  const link_conditions &getConditions() const {
+    return conditions_;
+  }
+
+  // Takes a datagram sent at now.
+  void push(const std::string &packet, double now);
+  // Pops a datagram that is due to arrive by now, in arrival order.
+  bool pop(std::string &packet, double now);
+
+  // Datagrams dropped as random loss
+  size_t getDropped() const {
+    return dropped_;
+  }
+  // Datagrams dropped because the bandwidth queue was full
+  size_t getOverflowed() const {
+    return overflowed_;
+  }
+  size_t getReordered() const {
+    return reordered_;
+  }
+  size_t getDuplicated() const {
+    return duplicated_;
+  }
+
+ private:
+  struct delayed_packet {
+    double due;
+    // Breaks ties in due, so equal delays keep their order
+    uint64_t order;
+    std::string data;
+  };
+  struct later_packet {
+    bool operator()(const delayed_packet &a, const delayed_packet &b) const {
+      return a.due > b.due || (a.due == b.due && a.order > b.order);
+    }
+  };
+
+  void applySteps(double now);
+  bool sampleLoss();
+  double sampleDelay();
+  void schedule(const std::string &packet, double due);
+
+  link_conditions conditions_;
+  std::vector<std::pair<double, link_conditions>> steps_;
+  size_t nextStep_;
+
+  std::mt19937 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  std::normal_distribution<double> normal_;
+  // In a burst of losses
+  bool losing_;
+  // When the capped link finishes sending what is queued on it
+  double linkFreeTime_;
+
+  // Heap ordered by later_packet
+  std::vector<delayed_packet> packets_;
+  uint64_t nextOrder_;
+
+  size_t dropped_;
+  size_t overflowed_;
+  size_t reordered_;
+  size_t duplicated_;
+};
+
+// Builds a simulator from a config object like local.link_impairment, or
+// returns null if it is missing or not enabled.  "script" is a list of
+// conditions, each with an "at" time in seconds after the connection
+// starts, and each changing only the fields it lists.
+std::unique_ptr<LinkSimulator> make_link_simulator(
+    const Json::Value &config,
+    uint32_t seed);
+
+#endif  // SRC_COMMON_LINKSIMULATOR_H_
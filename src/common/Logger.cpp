@@ -1,33 +1,289 @@
 #include "common/Logger.h"
 #include <stdarg.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include "common/ParamReader.h"
 
-static const size_t MAX_MESSAGE_LENGTH = 512;
 Logger * Logger::instance_ = nullptr;
+std::atomic<LogSeverity> Logger::minSeverity_(LOG_SEVERITY_DEBUG);
+LOGGER_THREAD_LOCAL LogThreadBuffer *Logger::threadBuffer_ = nullptr;
 
-Logger::Logger() {
+// How long the log thread sleeps between drains.
+static const std::chrono::milliseconds LOG_INTERVAL(10);
+
+static const char *SEVERITY_NAMES[] = {
+  "DEBUG",
+  "INFO",
+  "WARNING",
+  "ERROR",
+  "FATAL",
+};
+
+const char *log_severity_name(LogSeverity severity) {
+  return SEVERITY_NAMES[severity];
+}
+
+bool parse_log_severity(const std::string &name, LogSeverity &severity) {
+  for (int i = LOG_SEVERITY_DEBUG; i <= LOG_SEVERITY_FATAL; i++) {
+    if (name == SEVERITY_NAMES[i]) {
+      severity = static_cast<LogSeverity>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+static int64_t log_timestamp() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// HH:MM:SS.uuuuuu file:line SEVERITY - message
+static void format_record(std::ostream &os, const log_record &record) {
+  time_t seconds = record.timestamp / 1000000;
+  struct tm tm;
+#if defined(_MSC_VER)
+  localtime_s(&tm, &seconds);
+#else
+  localtime_r(&seconds, &tm);
+#endif
+  char time_buf[32];
+  snprintf(time_buf, sizeof(time_buf), "%02d:%02d:%02d.%06d",
+      tm.tm_hour, tm.tm_min, tm.tm_sec,
+      static_cast<int>(record.timestamp % 1000000));
+
+  os << time_buf << ' ' << record.file << ':' << record.line << ' '
+    << log_severity_name(record.severity) << " - ";
+  os.write(record.message, record.length);
+  // Most messages bring their own newline
+  if (!record.length || record.message[record.length - 1] != '\n') {
+    os << '\n';
+  }
+}
+
+Logger::Logger()
+  : running_(true) {
+  thread_ = std::thread(std::bind(&Logger::loggerFunc, this));
+}
+
+Logger::~Logger() {
+  stop();
 }
 
 void Logger::initLogger() {
   invariant(!instance_, "Logger already initialized");
+  if (hasParam("local.debug.log_level")) {
+    LogSeverity severity;
+    std::string level = strParam("local.debug.log_level");
+    invariant(
+        parse_log_severity(level, severity),
+        "unknown log level " + level);
+    setMinSeverity(severity);
+  }
   instance_ = new Logger();
+  if (hasParam("local.debug.log_file")
+      && !strParam("local.debug.log_file").empty()) {
+    instance_->addFileSink(strParam("local.debug.log_file"));
+  }
   atexit(&Logger::shutdownLogger);
 }
 
 void Logger::shutdownLogger() {
-  delete instance_;
+  // The instance is left allocated, threads that are still running may log
+  // at any point.  Once stopped their messages are written synchronously.
+  if (instance_) {
+    instance_->stop();
+  }
+}
+
+void Logger::stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    cond_.notify_all();
+  }
+  thread_.join();
+  std::unique_lock<std::mutex> lock(mutex_);
+  drain();
+}
+
+void Logger::addFileSink(const std::string &filename) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  file_.open(filename.c_str(), std::ios::out | std::ios::app);
+  if (!file_) {
+    throw file_exception("Unable to open log file " + filename);
+  }
+}
+
+void Logger::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  drain();
+}
+
+size_t Logger::getBufferCount() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return buffers_.size();
+}
+
+Logger::thread_exit_hook::~thread_exit_hook() {
+  // The logger is never freed, see shutdownLogger
+  if (threadBuffer_) {
+    threadBuffer_->exited.store(true, std::memory_order_release);
+    threadBuffer_ = nullptr;
+  }
+}
+
+LogThreadBuffer *Logger::getThreadBuffer() {
+  if (!threadBuffer_) {
+    // Threads come and go with connections and games
+    static thread_local thread_exit_hook exit_hook;
+    (void) &exit_hook;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!freeBuffers_.empty()) {
+      threadBuffer_ = freeBuffers_.back();
+      freeBuffers_.pop_back();
+    } else {
+      buffers_.emplace_back(new LogThreadBuffer(buffers_.size()));
+      threadBuffer_ = buffers_.back().get();
+    }
+  }
+  return threadBuffer_;
+}
+
+void Logger::write(const log_record &record) {
+  Logger *logger = instance_;
+  if (logger && logger->running_) {
+    logger->push(record);
+    // stop may have done its last drain between the check and the push,
+    // pairs with the store to running_ in stop
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (record.severity == LOG_SEVERITY_FATAL || !logger->running_) {
+      logger->flush();
+    }
+    return;
+  }
+
+  static std::mutex sync_mutex;
+  std::unique_lock<std::mutex> lock(sync_mutex);
+  format_record(std::cout, record);
+  std::cout.flush();
+}
+
+void Logger::push(const log_record &record) {
+  LogThreadBuffer *buffer = getThreadBuffer();
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+  if (head - tail >= LogThreadBuffer::kCapacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  log_record &slot = buffer->records[head % LogThreadBuffer::kCapacity];
+  // Only copy the used part of the message
+  memcpy(&slot, &record, offsetof(log_record, message) + record.length);
+  slot.threadIndex = buffer->threadIndex;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Logger::loggerFunc() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    cond_.wait_for(lock, LOG_INTERVAL);
+    drain();
+  }
+}
+
+void Logger::drain() {
+  pending_.clear();
+  for (auto &buffer : buffers_) {
+    // Read before head, so nothing is pushed after the last drain
+    const bool exited = buffer->exited.load(std::memory_order_acquire);
+    uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; i++) {
+      pending_.push_back(buffer->records[i % LogThreadBuffer::kCapacity]);
+    }
+    buffer->tail.store(head, std::memory_order_release);
+
+    uint64_t dropped = buffer->dropped.exchange(0);
+    if (dropped) {
+      log_record record;
+      record.timestamp = log_timestamp();
+      record.file = __FILE__;
+      record.line = __LINE__;
+      record.severity = LOG_SEVERITY_WARNING;
+      record.threadIndex = buffer->threadIndex;
+      record.length = snprintf(record.message, sizeof(record.message),
+          "dropped %llu messages from thread %u, log buffer full\n",
+          static_cast<unsigned long long>(dropped), buffer->threadIndex);
+      pending_.push_back(record);
+    }
+
+    if (exited) {
+      buffer->exited.store(false, std::memory_order_relaxed);
+      freeBuffers_.push_back(buffer.get());
+    }
+  }
+  if (pending_.empty()) {
+    return;
+  }
+
+  // Interleave the threads in the order the messages were logged
+  std::stable_sort(pending_.begin(), pending_.end(),
+      [](const log_record &a, const log_record &b) {
+        return a.timestamp < b.timestamp;
+      });
+  for (const auto &record : pending_) {
+    writeRecord(record);
+  }
+  std::cout.flush();
+  if (file_.is_open()) {
+    file_.flush();
+  }
+}
+
+void Logger::writeRecord(const log_record &record) {
+  format_record(std::cout, record);
+  if (file_.is_open()) {
+    format_record(file_, record);
+  }
 }
 
 void Logger::log(const char * format, ...) {
-  // TODO(zack): Move the string processing to the worker thread.
-  va_list va;
-  char *buf = new char[MAX_MESSAGE_LENGTH];
+  log_record record;
+  record.timestamp = log_timestamp();
+  record.file = "";
+  record.line = 0;
+  record.severity = LOG_SEVERITY_INFO;
 
+  va_list va;
   va_start(va, format);
-  vsnprintf(buf, MAX_MESSAGE_LENGTH, format, va);
+  int len = vsnprintf(record.message, sizeof(record.message), format, va);
   va_end(va);
+  record.length = std::min<size_t>(
+      std::max(len, 0),
+      sizeof(record.message) - 1);
+  write(record);
+}
+
+LogMessage::LogMessage(LogSeverity severity, const char *file, int line)
+  : buf_(record_.message, log_record::kMaxMessageLength),
+    stream_(&buf_) {
+  record_.timestamp = log_timestamp();
+  record_.file = file;
+  record_.line = line;
+  record_.severity = severity;
+  record_.threadIndex = 0;
+}
 
-  worker_.post([=]() {
-    printf("%s", buf);
-    delete buf;
-  });
+LogMessage::~LogMessage() {
+  record_.length = buf_.size();
+  Logger::write(record_);
 }
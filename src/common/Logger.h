@@ -1,17 +1,93 @@
 #ifndef SRC_COMMON_LOGGER_H_
 #define SRC_COMMON_LOGGER_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <boost/format.hpp>
 #include "common/util.h"
-#include "common/WorkerThread.h"
 
-#define LOG(str) std::cout << __FILE__ << ":" <<  __LINE__ << " "#str << " - "
+// LOG(SEVERITY) << "message\n";
+//
+// The message is written into a fixed size buffer on the calling thread and
+// queued on a per thread lock free ring buffer.  A background thread adds
+// the timestamp and source location and writes it to the console and the
+// log file, so logging never blocks on IO.  FATAL messages are written out
+// before LOG returns.
+//
+// Messages below LOG_MIN_SEVERITY are compiled out, messages below the
+// runtime level (Logger::setMinSeverity) are skipped without formatting.
+
+enum LogSeverity {
+  LOG_SEVERITY_DEBUG = 0,
+  LOG_SEVERITY_INFO = 1,
+  LOG_SEVERITY_WARNING = 2,
+  LOG_SEVERITY_ERROR = 3,
+  LOG_SEVERITY_FATAL = 4,
+};
+
+#ifndef LOG_MIN_SEVERITY
+#define LOG_MIN_SEVERITY LOG_SEVERITY_DEBUG
+#endif
+
+#define LOG(severity) \
+  (LOG_SEVERITY_##severity < LOG_MIN_SEVERITY \
+   || !Logger::isEnabled(LOG_SEVERITY_##severity)) \
+    ? (void) 0 \
+    : LogMessageVoidify() & \
+      LogMessage(LOG_SEVERITY_##severity, __FILE__, __LINE__).stream()
+
+#if defined(_MSC_VER)
+#define LOGGER_THREAD_LOCAL __declspec(thread)
+#else
+#define LOGGER_THREAD_LOCAL __thread
+#endif
+
+const char *log_severity_name(LogSeverity severity);
+// Parses DEBUG, INFO, etc.  Returns false for unknown names.
+bool parse_log_severity(const std::string &name, LogSeverity &severity);
+
+struct log_record {
+  static const size_t kMaxMessageLength = 1024;
+
+  int64_t timestamp;  // system_clock microseconds
+  const char *file;
+  uint32_t line;
+  LogSeverity severity;
+  uint32_t threadIndex;
+  uint32_t length;
+  char message[kMaxMessageLength];
+};
+
+// Single producer (the owning thread), single consumer (the log thread).
+struct LogThreadBuffer {
+  static const size_t kCapacity = 128;
+
+  explicit LogThreadBuffer(uint32_t index)
+    : head(0), tail(0), dropped(0), exited(false), threadIndex(index) {
+  }
+
+  log_record records[kCapacity];
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  std::atomic<uint64_t> dropped;
+  // Set when the owning thread exits, the buffer is reused once drained
+  std::atomic<bool> exited;
+  const uint32_t threadIndex;
+};
 
 class Logger {
  public:
+  // Starts the log thread.  Reads the runtime level from local.debug.log_level
+  // and opens local.debug.log_file, if set.  Before initLogger, and after
+  // shutdown, messages are written synchronously to stdout.
   static void initLogger();
   static void shutdownLogger();
 
@@ -20,15 +96,89 @@ class Logger {
     return instance_;
   }
 
-  void log(const char * format, ...);
+  static bool isEnabled(LogSeverity severity) {
+    return severity >= minSeverity_.load(std::memory_order_relaxed);
+  }
+  static void setMinSeverity(LogSeverity severity) {
+    minSeverity_ = severity;
+  }
+
+  // Called by LogMessage
+  static void write(const log_record &record);
+
+  // Appends all messages to filename, in addition to stdout.
+  void addFileSink(const std::string &filename);
+  // Blocks until every message queued before the call has been written.
+  void flush();
+  // Number of thread buffers allocated, including free ones.
+  size_t getBufferCount();
 
+  void log(const char * format, ...);
 
  private:
   Logger();
+  ~Logger();
   static Logger *instance_;
+  static std::atomic<LogSeverity> minSeverity_;
+  static LOGGER_THREAD_LOCAL LogThreadBuffer *threadBuffer_;
+
+  // Destroyed when a thread that logged exits
+  struct thread_exit_hook {
+    ~thread_exit_hook();
+  };
+
+  LogThreadBuffer *getThreadBuffer();
+  void push(const log_record &record);
+  void stop();
+  void loggerFunc();
+  // Writes every queued message, oldest first.  Requires mutex_.
+  void drain();
+  void writeRecord(const log_record &record);
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Guarded by mutex_
+  std::vector<std::unique_ptr<LogThreadBuffer>> buffers_;
+  // Buffers of exited threads, drained and ready for new threads
+  std::vector<LogThreadBuffer *> freeBuffers_;
+  std::vector<log_record> pending_;
+  std::ofstream file_;
+};
+
+// Fixed size, allocation free stream buffer.  Output past the end is dropped.
+class LogStreamBuf : public std::streambuf {
+ public:
+  LogStreamBuf(char *buf, size_t len) {
+    setp(buf, buf + len);
+  }
+  size_t size() const {
+    return pptr() - pbase();
+  }
+};
+
+class LogMessage {
+ public:
+  LogMessage(LogSeverity severity, const char *file, int line);
+  ~LogMessage();
+
+  std::ostream &stream() {
+    return stream_;
+  }
+
+ private:
+  LogMessage(const LogMessage &);
+
+  log_record record_;
+  LogStreamBuf buf_;
+  std::ostream stream_;
+};
 
-  //std::ofstream file_;
-  WorkerThread worker_;
+// Lets LOG be an expression, see the LOG macro.
+struct LogMessageVoidify {
+  void operator&(std::ostream &) { }
 };
 
-#endif  // SRC_COMMON_LOGGER_H_
\ No newline at end of file
+#endif  // SRC_COMMON_LOGGER_H_
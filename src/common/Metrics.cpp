@@ -0,0 +1,277 @@
+#include "common/Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include "common/Exception.h"
+#include "common/util.h"
+
+void Gauge::add(double delta) {
+  double current = value_.load(std::memory_order_relaxed);
+  while (!value_.compare_exchange_weak(current, current + delta)) {
+  }
+}
+
+Histogram::Histogram(double unit, uint64_t max_value)
+  : unit_(unit),
+    buckets_(bucketIndex(max_value) + 1),
+    count_(0),
+    sum_(0) {
+  invariant(unit > 0.0, "histogram unit must be positive");
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Bucket layout with 1 << bits sub buckets per power of two
+static size_t bucket_index(uint64_t units, int bits) {
+  const uint64_t sub_buckets = 1ull << bits;
+  if (units < sub_buckets) {
+    return units;
+  }
+  int msb = 63;
+  while (!(units & (1ull << msb))) {
+    msb--;
+  }
+  int shift = msb - bits;
+  uint64_t sub_bucket = (units >> shift) - sub_buckets;
+  return sub_buckets + shift * sub_buckets + sub_bucket;
+}
+
+static uint64_t bucket_upper_bound(size_t bucket, int bits) {
+  const uint64_t sub_buckets = 1ull << bits;
+  if (bucket < sub_buckets) {
+    return bucket;
+  }
+  uint64_t shift = (bucket - sub_buckets) / sub_buckets;
+  uint64_t sub_bucket = (bucket - sub_buckets) % sub_buckets;
+  uint64_t lower = (sub_buckets + sub_bucket) << shift;
+  return lower + (1ull << shift) - 1;
+}
+
+size_t Histogram::bucketIndex(uint64_t units) {
+  return bucket_index(units, kSubBucketBits);
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+  return bucket_upper_bound(bucket, kSubBucketBits);
+}
+
+bool Histogram::isExportedBucket(size_t bucket) {
+  // The fine layout splits every coarse bucket, so coarse bounds are bounds
+  const uint64_t bound = bucketUpperBound(bucket);
+  return bucket_upper_bound(
+      bucket_index(bound, kExportSubBucketBits),
+      kExportSubBucketBits) == bound;
+}
+
+void Histogram::record(double value) {
+  double units = std::floor(value / unit_ + 0.5);
+  if (!(units > 0.0)) {
+    units = 0.0;
+  } else if (units >= std::numeric_limits<uint64_t>::max()) {
+    units = std::numeric_limits<uint64_t>::max();
+  }
+  recordUnits(static_cast<uint64_t>(units));
+}
+
+void Histogram::recordUnits(uint64_t units) {
+  size_t bucket = std::min(bucketIndex(units), buckets_.size() - 1);
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(units, std::memory_order_relaxed);
+}
+
+double Histogram::getSum() const {
+  return sum_.load(std::memory_order_relaxed) * unit_;
+}
+
+double Histogram::getBucketBound(size_t bucket) const {
+  return bucketUpperBound(bucket) * unit_;
+}
+
+double Histogram::getPercentile(double percentile) const {
+  uint64_t count = getCount();
+  if (count == 0) {
+    return 0.0;
+  }
+  uint64_t target = static_cast<uint64_t>(
+      std::ceil(count * std::min(std::max(percentile, 0.0), 100.0) / 100.0));
+  target = std::max<uint64_t>(target, 1);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += getBucketValue(i);
+    if (seen >= target) {
+      return getBucketBound(i);
+    }
+  }
+  // Concurrent records can bump count past the bucket total
+  return getBucketBound(buckets_.size() - 1);
+}
+
+MetricsRegistry *MetricsRegistry::get() {
+  static MetricsRegistry registry;
+  return &registry;
+}
+
+static std::string format_labels(const MetricLabels &labels) {
+  std::string ret;
+  for (const auto &label : labels) {
+    if (!ret.empty()) {
+      ret += ',';
+    }
+    ret += label.first + "=\"";
+    for (char c : label.second) {
+      if (c == '\\' || c == '"') {
+        ret += '\\';
+        ret += c;
+      } else if (c == '\n') {
+        ret += "\\n";
+      } else {
+        ret += c;
+      }
+    }
+    ret += '"';
+  }
+  return ret;
+}
+
+MetricsRegistry::Family &MetricsRegistry::getFamily(
+    const std::string &name,
+    const std::string &help,
+    MetricType type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    Family &family = families_[name];
+    family.type = type;
+    family.help = help;
+    return family;
+  }
+  invariant(
+      it->second.type == type,
+      "metric " + name + " registered with two different types");
+  return it->second;
+}
+
+Counter *MetricsRegistry::counter(
+    const std::string &name,
+    const std::string &help,
+    const MetricLabels &labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto &metric =
+    getFamily(name, help, COUNTER).counters[format_labels(labels)];
+  if (!metric) {
+    metric.reset(new Counter());
+  }
+  return metric.get();
+}
+
+Gauge *MetricsRegistry::gauge(
+    const std::string &name,
+    const std::string &help,
+    const MetricLabels &labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto &metric = getFamily(name, help, GAUGE).gauges[format_labels(labels)];
+  if (!metric) {
+    metric.reset(new Gauge());
+  }
+  return metric.get();
+}
+
+Histogram *MetricsRegistry::histogram(
+    const std::string &name,
+    const std::string &help,
+    double unit,
+    uint64_t max_value,
+    const MetricLabels &labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto &metric =
+    getFamily(name, help, HISTOGRAM).histograms[format_labels(labels)];
+  if (!metric) {
+    metric.reset(new Histogram(unit, max_value));
+  }
+  return metric.get();
+}
+
+template<typename T>
+static void write_sample(
+    std::ostream &os,
+    const std::string &name,
+    const std::string &labels,
+    T value) {
+  os << name;
+  if (!labels.empty()) {
+    os << '{' << labels << '}';
+  }
+  os << ' ' << value << '\n';
+}
+
+static std::string with_le(const std::string &labels, const std::string &le) {
+  std::string ret = labels;
+  if (!ret.empty()) {
+    ret += ',';
+  }
+  return ret + "le=\"" + le + '"';
+}
+
+void MetricsRegistry::writePrometheus(std::ostream &os) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto old_precision = os.precision(10);
+  for (const auto &pair : families_) {
+    const std::string &name = pair.first;
+    const Family &family = pair.second;
+    const char *type_name = family.type == COUNTER ? "counter"
+      : family.type == GAUGE ? "gauge"
+      : "histogram";
+    os << "# HELP " << name << ' ' << family.help << '\n';
+    os << "# TYPE " << name << ' ' << type_name << '\n';
+
+    for (const auto &metric : family.counters) {
+      write_sample(os, name, metric.first, metric.second->get());
+    }
+    for (const auto &metric : family.gauges) {
+      write_sample(os, name, metric.first, metric.second->get());
+    }
+    for (const auto &metric : family.histograms) {
+      const Histogram &histogram = *metric.second;
+      // Read the buckets once so the cumulative counts are consistent
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < histogram.getBucketCount(); i++) {
+        cumulative += histogram.getBucketValue(i);
+        if (!Histogram::isExportedBucket(i)) {
+          continue;
+        }
+        std::ostringstream le;
+        le.precision(10);
+        le << histogram.getBucketBound(i);
+        write_sample(
+            os,
+            name + "_bucket",
+            with_le(metric.first, le.str()),
+            cumulative);
+      }
+      write_sample(
+          os, name + "_bucket", with_le(metric.first, "+Inf"), cumulative);
+      write_sample(os, name + "_sum", metric.first, histogram.getSum());
+      write_sample(os, name + "_count", metric.first, cumulative);
+    }
+  }
+  os.precision(old_precision);
+}
+
+void MetricsRegistry::writePrometheusFile(const std::string &filename) {
+  std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::trunc);
+    if (!file) {
+      throw file_exception("Unable to open metrics file " + tmp_filename);
+    }
+    writePrometheus(file);
+  }
+  if (rename(tmp_filename.c_str(), filename.c_str())) {
+    throw file_exception("Unable to replace metrics file " + filename);
+  }
+}
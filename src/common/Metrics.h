@@ -0,0 +1,154 @@
+#ifndef SRC_COMMON_METRICS_H_
+#define SRC_COMMON_METRICS_H_
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Process wide counters, gauges and histograms, exported in the Prometheus
+// text format.
+//
+// Looking up a metric takes a lock, so look them up once and keep the
+// pointer.  Updating a metric is lock free and safe from any thread.
+
+typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+class Counter {
+ public:
+  Counter() : value_(0) { }
+
+  void inc(uint64_t n = 1) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+  uint64_t get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> value_;
+};
+
+class Gauge {
+ public:
+  Gauge() : value_(0.0) { }
+
+  void set(double value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  void add(double delta);
+  double get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<double> value_;
+};
+
+// Log-linear buckets in the style of HdrHistogram: each power of two range
+// is split into kSubBuckets linear buckets, so the relative error of a
+// recorded value is bounded by 1/kSubBuckets regardless of its magnitude.
+//
+// Values are recorded in units of `unit` (e.g. 1e-6 to record seconds with
+// microsecond resolution) and exported in the original units.  The export
+// merges buckets down to kExportSubBuckets per power of two, to keep the
+// number of series down, percentiles use the full resolution.
+class Histogram {
+ public:
+  static const int kSubBucketBits = 5;
+  static const uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static const int kExportSubBucketBits = 2;
+  static const uint64_t kExportSubBuckets = 1 << kExportSubBucketBits;
+
+  // Values larger than max_value (in units) land in the last bucket.
+  Histogram(double unit, uint64_t max_value);
+
+  void record(double value);
+  // Records a value already in units.
+  void recordUnits(uint64_t units);
+
+  uint64_t getCount() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+  double getSum() const;
+  // Upper bound of the bucket holding the given percentile, [0, 100].
+  double getPercentile(double percentile) const;
+
+  size_t getBucketCount() const {
+    return buckets_.size();
+  }
+  // Largest value, in original units, that lands in the given bucket.
+  double getBucketBound(size_t bucket) const;
+  uint64_t getBucketValue(size_t bucket) const {
+    return buckets_[bucket].load(std::memory_order_relaxed);
+  }
+
+  static size_t bucketIndex(uint64_t units);
+  static uint64_t bucketUpperBound(size_t bucket);
+  // Whether the bucket's bound is also a bound at the export resolution
+  static bool isExportedBucket(size_t bucket);
+
+ private:
+  const double unit_;
+  std::vector<std::atomic<uint64_t>> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+};
+
+class MetricsRegistry {
+ public:
+  static MetricsRegistry *get();
+
+  // Returns the metric with the given name and labels, creating it if it
+  // doesn't exist.  Metrics are never destroyed.
+  Counter *counter(
+      const std::string &name,
+      const std::string &help,
+      const MetricLabels &labels = MetricLabels());
+  Gauge *gauge(
+      const std::string &name,
+      const std::string &help,
+      const MetricLabels &labels = MetricLabels());
+  Histogram *histogram(
+      const std::string &name,
+      const std::string &help,
+      double unit,
+      uint64_t max_value,
+      const MetricLabels &labels = MetricLabels());
+
+  void writePrometheus(std::ostream &os);
+  // Atomically replaces filename, for the node exporter textfile collector.
+  void writePrometheusFile(const std::string &filename);
+
+ private:
+  MetricsRegistry() { }
+
+  enum MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM,
+  };
+
+  struct Family {
+    MetricType type;
+    std::string help;
+    // Keyed by formatted label string
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family &getFamily(
+      const std::string &name,
+      const std::string &help,
+      MetricType type);
+
+  std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+#endif  // SRC_COMMON_METRICS_H_
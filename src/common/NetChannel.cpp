@@ -0,0 +1,549 @@
+#include "common/NetChannel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "common/Logger.h"
+#include "common/util.h"
+
+// 'RT', datagrams without it are ignored
+static const uint16_t PROTOCOL_ID = 0x5254;
+
+// Pacing rates, in bytes per second
+static const double INITIAL_SEND_RATE = 256 * 1024;
+static const double MIN_SEND_RATE = 16 * 1024;
+static const double MAX_SEND_RATE = 8 * 1024 * 1024;
+// Added to the rate each round trip without loss
+static const double SEND_RATE_INCREASE = 16 * 1024;
+// Seconds of sending the token bucket can save up, at least enough for a
+// full snapshot in one go.
+static const double BURST_TIME = 0.05;
+static const double MIN_BURST = 16 * ChannelEndpoint::kMaxPacketSize;
+
+static const double INITIAL_RTO = 0.25;
+static const double MIN_RTO = 0.05;
+// Acks are piggybacked on outgoing messages, or sent on their own after this
+static const double ACK_DELAY = 0.01;
+static const double KEEPALIVE_INTERVAL = 0.1;
+// A packet is lost once this many newer packets have been acked
+static const int LOSS_REORDER_THRESHOLD = 3;
+// Sequenced or unreliable messages being reassembled at once, per channel
+static const size_t MAX_PARTIAL_INCOMING = 16;
+// Reliable messages can't be dropped, so a peer that sends more than this
+// ahead of a missing message is disconnected instead
+static const size_t MAX_RELIABLE_INCOMING_SIZE =
+  4 * ChannelEndpoint::kMaxMessageSize;
+
+const size_t ChannelEndpoint::kMaxPacketSize;
+const size_t ChannelEndpoint::kPacketHeaderSize;
+const size_t ChannelEndpoint::kFragmentHeaderSize;
+const size_t ChannelEndpoint::kMaxFragmentSize;
+const size_t ChannelEndpoint::kMaxMessageSize;
+const size_t ChannelEndpoint::kMaxMessageFragments;
+
+bool sequence_greater(uint16_t a, uint16_t b) {
+  return ((a > b) && (a - b <= 32768)) || ((a < b) && (b - a > 32768));
+}
+
+static void write_u8(std::string &buf, uint8_t v) {
+  buf.push_back(static_cast<char>(v));
+}
+
+static void write_u16(std::string &buf, uint16_t v) {
+  buf.push_back(static_cast<char>(v & 0xff));
+  buf.push_back(static_cast<char>(v >> 8));
+}
+
+static void write_u32(std::string &buf, uint32_t v) {
+  write_u16(buf, v & 0xffff);
+  write_u16(buf, v >> 16);
+}
+
+// Bounds checked little endian reads
+class packet_reader {
+ public:
+  explicit packet_reader(const std::string &buf)
+    : buf_(buf), pos_(0) {
+  }
+  bool done() const {
+    return pos_ == buf_.size();
+  }
+  bool readU8(uint8_t &v) {
+    if (pos_ + 1 > buf_.size()) {
+      return false;
+    }
+    v = static_cast<uint8_t>(buf_[pos_++]);
+    return true;
+  }
+  bool readU16(uint16_t &v) {
+    uint8_t lo, hi;
+    if (!readU8(lo) || !readU8(hi)) {
+      return false;
+    }
+    v = lo | (hi << 8);
+    return true;
+  }
+  bool readU32(uint32_t &v) {
+    uint16_t lo, hi;
+    if (!readU16(lo) || !readU16(hi)) {
+      return false;
+    }
+    v = lo | (static_cast<uint32_t>(hi) << 16);
+    return true;
+  }
+  bool readBytes(size_t len, std::string &v) {
+    if (pos_ + len > buf_.size()) {
+      return false;
+    }
+    v.assign(buf_, pos_, len);
+    pos_ += len;
+    return true;
+  }
+
+ private:
+  const std::string &buf_;
+  size_t pos_;
+};
+
+ChannelEndpoint::ChannelEndpoint()
+  : nextSequence_(0),
+    sentPackets_(kSentPacketHistory),
+    lastPacketTime_(-std::numeric_limits<double>::infinity()),
+    sendRate_(INITIAL_SEND_RATE),
+    sendBudget_(0.0),
+    lastBudgetTime_(-1.0),
+    lastRateDecrease_(-std::numeric_limits<double>::infinity()),
+    srtt_(0.0),
+    rttvar_(0.0),
+    hasRTT_(false),
+    hasReceived_(false),
+    remoteSequence_(0),
+    receivedBits_(0),
+    ackPending_(false),
+    lastReceiveTime_(-1.0),
+    nextReliableID_(0),
+    reliableIncomingSize_(0),
+    hasSequenced_(false),
+    lastSequencedID_(0),
+    bytesSent_(0),
+    bytesReceived_(0),
+    packetsSent_(0),
+    packetsLost_(0),
+    failed_(false) {
+  for (auto &id : nextMessageID_) {
+    id = 0;
+  }
+  for (auto &sent : sentPackets_) {
+    sent.valid = false;
+  }
+}
+
+void ChannelEndpoint::queueFragments(
+    std::deque<outgoing_fragment> &queue,
+    NetChannel channel,
+    uint16_t message_id,
+    const std::string &payload) {
+  size_t count = std::max<size_t>(
+      1,
+      (payload.size() + kMaxFragmentSize - 1) / kMaxFragmentSize);
+  invariant(count <= kMaxMessageFragments, "message too large to send");
+  for (size_t i = 0; i < count; i++) {
+    outgoing_fragment fragment;
+    fragment.channel = channel;
+    fragment.messageID = message_id;
+    fragment.index = i;
+    fragment.count = count;
+    fragment.data = payload.substr(i * kMaxFragmentSize, kMaxFragmentSize);
+    fragment.lastSent = -1.0;
+    fragment.acked = false;
+    queue.push_back(fragment);
+  }
+}
+
+void ChannelEndpoint::send(NetChannel channel, const std::string &payload) {
+  uint16_t message_id = nextMessageID_[channel]++;
+  if (channel == NET_CHANNEL_RELIABLE) {
+    queueFragments(reliableQueue_, channel, message_id, payload);
+  } else if (channel == NET_CHANNEL_UNRELIABLE) {
+    queueFragments(unreliableQueue_, channel, message_id, payload);
+  } else {
+    // Anything still queued is older, and would be dropped on arrival
+    sequencedQueue_.clear();
+    queueFragments(sequencedQueue_, channel, message_id, payload);
+  }
+}
+
+double ChannelEndpoint::getRTO() const {
+  if (!hasRTT_) {
+    return INITIAL_RTO;
+  }
+  return std::max(MIN_RTO, srtt_ + 4 * rttvar_);
+}
+
+void ChannelEndpoint::refillBudget(double now) {
+  double burst = std::max(MIN_BURST, sendRate_ * BURST_TIME);
+  if (lastBudgetTime_ < 0.0) {
+    sendBudget_ = burst;
+  } else {
+    sendBudget_ = std::min(
+        burst,
+        sendBudget_ + sendRate_ * std::max(now - lastBudgetTime_, 0.0));
+  }
+  lastBudgetTime_ = now;
+}
+
+bool ChannelEndpoint::nextPacket(std::string &packet, double now) {
+  refillBudget(now);
+  // The budget may go negative by one packet
+  if (sendBudget_ < 0.0) {
+    return false;
+  }
+
+  std::string body;
+  size_t room = kMaxPacketSize - kPacketHeaderSize;
+  std::vector<std::pair<uint16_t, uint16_t>> reliable_fragments;
+  auto append = [&](const outgoing_fragment &fragment) {
+    write_u8(body, fragment.channel);
+    write_u16(body, fragment.messageID);
+    write_u16(body, fragment.index);
+    write_u16(body, fragment.count);
+    write_u16(body, fragment.data.size());
+    body.append(fragment.data);
+    room -= kFragmentHeaderSize + fragment.data.size();
+  };
+
+  const double rto = getRTO();
+  for (auto &fragment : reliableQueue_) {
+    if (room < kFragmentHeaderSize + fragment.data.size()) {
+      break;
+    }
+    if (fragment.acked
+        || (fragment.lastSent >= 0.0 && now - fragment.lastSent < rto)) {
+      continue;
+    }
+    append(fragment);
+    fragment.lastSent = now;
+    reliable_fragments.push_back(
+        std::make_pair(fragment.messageID, fragment.index));
+  }
+  for (auto queue : {&unreliableQueue_, &sequencedQueue_}) {
+    while (!queue->empty()
+        && room >= kFragmentHeaderSize + queue->front().data.size()) {
+      append(queue->front());
+      queue->pop_front();
+    }
+  }
+
+  if (body.empty()
+      && !(ackPending_ && now - lastPacketTime_ >= ACK_DELAY)
+      && now - lastPacketTime_ < KEEPALIVE_INTERVAL) {
+    return false;
+  }
+
+  uint16_t sequence = nextSequence_++;
+  packet.clear();
+  write_u16(packet, PROTOCOL_ID);
+  write_u16(packet, sequence);
+  write_u16(packet, remoteSequence_);
+  write_u32(packet, hasReceived_ ? receivedBits_ : 0);
+  packet.append(body);
+
+  sent_packet &sent = sentPackets_[sequence % kSentPacketHistory];
+  sent.sequence = sequence;
+  sent.valid = true;
+  sent.acked = false;
+  sent.lost = false;
+  sent.hasMessages = !body.empty();
+  sent.sendTime = now;
+  sent.size = packet.size();
+  sent.reliableFragments.swap(reliable_fragments);
+
+  sendBudget_ -= packet.size();
+  bytesSent_ += packet.size();
+  packetsSent_++;
+  lastPacketTime_ = now;
+  ackPending_ = false;
+  return true;
+}
+
+bool ChannelEndpoint::receivePacket(const std::string &packet, double now) {
+  if (failed_) {
+    return false;
+  }
+  packet_reader reader(packet);
+  uint16_t protocol, sequence, ack;
+  uint32_t ack_bits;
+  if (!reader.readU16(protocol) || protocol != PROTOCOL_ID
+      || !reader.readU16(sequence)
+      || !reader.readU16(ack)
+      || !reader.readU32(ack_bits)) {
+    return false;
+  }
+
+  // Parse everything before changing any state
+  struct fragment_header {
+    uint8_t channel;
+    uint16_t messageID;
+    uint16_t index;
+    uint16_t count;
+    std::string data;
+  };
+  std::vector<fragment_header> fragments;
+  while (!reader.done()) {
+    fragment_header fragment;
+    uint16_t length;
+    if (!reader.readU8(fragment.channel)
+        || !reader.readU16(fragment.messageID)
+        || !reader.readU16(fragment.index)
+        || !reader.readU16(fragment.count)
+        || !reader.readU16(length)
+        || !reader.readBytes(length, fragment.data)
+        || fragment.channel >= NET_CHANNEL_COUNT
+        || fragment.index >= fragment.count
+        || fragment.count > kMaxMessageFragments
+        || length > kMaxFragmentSize) {
+      return false;
+    }
+    fragments.push_back(fragment);
+  }
+
+  bytesReceived_ += packet.size();
+  lastReceiveTime_ = now;
+
+  bool duplicate = false;
+  if (!hasReceived_) {
+    hasReceived_ = true;
+    remoteSequence_ = sequence;
+    receivedBits_ = 1;
+  } else if (sequence_greater(sequence, remoteSequence_)) {
+    uint16_t shift = sequence - remoteSequence_;
+    receivedBits_ = shift >= 32 ? 0 : receivedBits_ << shift;
+    receivedBits_ |= 1;
+    remoteSequence_ = sequence;
+  } else {
+    uint16_t age = remoteSequence_ - sequence;
+    if (age < 32) {
+      duplicate = receivedBits_ & (1u << age);
+      receivedBits_ |= 1u << age;
+    }
+  }
+
+  processAcks(ack, ack_bits, now);
+
+  if (duplicate) {
+    return true;
+  }
+  if (!fragments.empty()) {
+    ackPending_ = true;
+  }
+  for (const auto &fragment : fragments) {
+    if (!receiveFragment(
+          fragment.channel,
+          fragment.messageID,
+          fragment.index,
+          fragment.count,
+          fragment.data)) {
+      LOG(WARNING) << "Peer sent too many reliable messages out of order\n";
+      failed_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+void ChannelEndpoint::processAcks(
+    uint16_t ack,
+    uint32_t ack_bits,
+    double now) {
+  for (int i = 0; i < 32; i++) {
+    uint16_t sequence = ack - i;
+    sent_packet &sent = sentPackets_[sequence % kSentPacketHistory];
+    if (!sent.valid || sent.sequence != sequence || sent.acked) {
+      continue;
+    }
+    if (ack_bits & (1u << i)) {
+      onPacketAcked(sent, now);
+    } else if (i >= LOSS_REORDER_THRESHOLD && !sent.lost) {
+      onPacketLost(sent, now);
+    }
+  }
+
+  while (!reliableQueue_.empty() && reliableQueue_.front().acked) {
+    reliableQueue_.pop_front();
+  }
+}
+
+void ChannelEndpoint::onPacketAcked(sent_packet &sent, double now) {
+  sent.acked = true;
+
+  if (sent.hasMessages) {
+    double rtt = std::max(now - sent.sendTime, 0.0);
+    if (!hasRTT_) {
+      srtt_ = rtt;
+      rttvar_ = rtt / 2;
+      hasRTT_ = true;
+    } else {
+      rttvar_ = 0.75 * rttvar_ + 0.25 * std::fabs(srtt_ - rtt);
+      srtt_ = 0.875 * srtt_ + 0.125 * rtt;
+    }
+  }
+
+  if (!sent.lost) {
+    // Additive increase, SEND_RATE_INCREASE per round trip's worth of acks
+    sendRate_ = std::min(
+        MAX_SEND_RATE,
+        sendRate_ + SEND_RATE_INCREASE * sent.size
+          / (sendRate_ * std::max(srtt_, 0.01)));
+  }
+
+  for (const auto &ref : sent.reliableFragments) {
+    for (auto &fragment : reliableQueue_) {
+      if (fragment.messageID == ref.first && fragment.index == ref.second) {
+        fragment.acked = true;
+        break;
+      }
+    }
+  }
+}
+
+void ChannelEndpoint::onPacketLost(sent_packet &sent, double now) {
+  sent.lost = true;
+  packetsLost_++;
+
+  // Multiplicative decrease, once per round trip
+  if (now - lastRateDecrease_ > std::max(srtt_, MIN_RTO)) {
+    sendRate_ = std::max(MIN_SEND_RATE, sendRate_ / 2);
+    lastRateDecrease_ = now;
+  }
+
+  // Resend without waiting for the timeout
+  for (const auto &ref : sent.reliableFragments) {
+    for (auto &fragment : reliableQueue_) {
+      if (fragment.messageID == ref.first && fragment.index == ref.second) {
+        if (!fragment.acked) {
+          fragment.lastSent = -1.0;
+        }
+        break;
+      }
+    }
+  }
+}
+
+bool ChannelEndpoint::receiveFragment(
+    uint8_t channel,
+    uint16_t message_id,
+    uint16_t index,
+    uint16_t count,
+    const std::string &data) {
+  std::map<uint16_t, incoming_message> *incoming;
+  if (channel == NET_CHANNEL_RELIABLE) {
+    // Already delivered
+    if (static_cast<uint16_t>(message_id - nextReliableID_) >= 32768) {
+      return true;
+    }
+    if (!reliableIncoming_.count(message_id)) {
+      reliableIncomingSize_ += count * kMaxFragmentSize;
+      if (reliableIncomingSize_ > MAX_RELIABLE_INCOMING_SIZE) {
+        return false;
+      }
+    }
+    incoming = &reliableIncoming_;
+  } else if (channel == NET_CHANNEL_UNRELIABLE) {
+    incoming = &unreliableIncoming_;
+  } else {
+    if (hasSequenced_ && !sequence_greater(message_id, lastSequencedID_)) {
+      return true;
+    }
+    incoming = &sequencedIncoming_;
+  }
+
+  incoming_message &message = (*incoming)[message_id];
+  if (message.fragments.empty()) {
+    message.received = 0;
+    message.have.resize(count, false);
+    message.fragments.resize(count);
+  }
+  if (message.fragments.size() != count || message.have[index]) {
+    return true;
+  }
+  message.have[index] = true;
+  message.fragments[index] = data;
+  message.received++;
+
+  if (channel == NET_CHANNEL_RELIABLE) {
+    deliverReliable();
+    return true;
+  }
+  if (channel == NET_CHANNEL_UNRELIABLE) {
+    if (message.received == count) {
+      std::string payload;
+      for (const auto &fragment : message.fragments) {
+        payload.append(fragment);
+      }
+      delivered_.push_back(std::make_pair(NET_CHANNEL_UNRELIABLE, payload));
+      unreliableIncoming_.erase(message_id);
+    }
+    trimIncoming(unreliableIncoming_);
+    return true;
+  }
+
+  if (message.received == count) {
+    std::string payload;
+    for (const auto &fragment : message.fragments) {
+      payload.append(fragment);
+    }
+    delivered_.push_back(std::make_pair(NET_CHANNEL_SEQUENCED, payload));
+    hasSequenced_ = true;
+    lastSequencedID_ = message_id;
+  }
+  // Drop delivered and superseded messages, and the oldest partial ones
+  for (auto it = sequencedIncoming_.begin(); it != sequencedIncoming_.end(); ) {
+    if (hasSequenced_ && !sequence_greater(it->first, lastSequencedID_)) {
+      it = sequencedIncoming_.erase(it);
+    } else {
+      it++;
+    }
+  }
+  trimIncoming(sequencedIncoming_);
+  return true;
+}
+
+void ChannelEndpoint::trimIncoming(
+    std::map<uint16_t, incoming_message> &incoming) {
+  while (incoming.size() > MAX_PARTIAL_INCOMING) {
+    auto oldest = incoming.begin();
+    for (auto it = incoming.begin(); it != incoming.end(); it++) {
+      if (sequence_greater(oldest->first, it->first)) {
+        oldest = it;
+      }
+    }
+    incoming.erase(oldest);
+  }
+}
+
+void ChannelEndpoint::deliverReliable() {
+  while (true) {
+    auto it = reliableIncoming_.find(nextReliableID_);
+    if (it == reliableIncoming_.end()
+        || it->second.received != it->second.fragments.size()) {
+      return;
+    }
+    std::string payload;
+    for (const auto &fragment : it->second.fragments) {
+      payload.append(fragment);
+    }
+    delivered_.push_back(std::make_pair(NET_CHANNEL_RELIABLE, payload));
+    reliableIncomingSize_ -= it->second.fragments.size() * kMaxFragmentSize;
+    reliableIncoming_.erase(it);
+    nextReliableID_++;
+  }
+}
+
+bool ChannelEndpoint::receive(NetChannel &channel, std::string &payload) {
+  if (delivered_.empty()) {
+    return false;
+  }
+  channel = delivered_.front().first;
+  payload.swap(delivered_.front().second);
+  delivered_.pop_front();
+  return true;
+}
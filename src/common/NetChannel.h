@@ -0,0 +1,183 @@
+#ifndef SRC_COMMON_NETCHANNEL_H_
+#define SRC_COMMON_NETCHANNEL_H_
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "common/Connection.h"
+
+// The message layer of UDPConnection, without any sockets or threads.  Time
+// is passed in, in seconds, so it can be driven by tests.
+//
+// Every datagram carries a packet sequence number and acks for the last 32
+// packets received from the peer.  Messages are split into fragments that
+// fit in a datagram.  Reliable fragments are resent until a packet holding
+// them is acked; sequenced and unreliable fragments are sent once, and a
+// newer sequenced message replaces any fragments of older ones still waiting
+// to be sent.
+//
+// Sending is paced with a token bucket.  The rate grows additively while
+// packets are acked and halves when loss is detected, at most once per
+// round trip.
+class ChannelEndpoint {
+ public:
+  // Largest datagram sent, small enough to avoid IP fragmentation on
+  // typical paths.
+  static const size_t kMaxPacketSize = 1200;
+  static const size_t kPacketHeaderSize = 10;
+  static const size_t kFragmentHeaderSize = 9;
+  static const size_t kMaxFragmentSize =
+    kMaxPacketSize - kPacketHeaderSize - kFragmentHeaderSize;
+  // Largest message sent or reassembled
+  static const size_t kMaxMessageSize = 4 * 1024 * 1024;
+  static const size_t kMaxMessageFragments =
+    (kMaxMessageSize + kMaxFragmentSize - 1) / kMaxFragmentSize;
+
+  ChannelEndpoint();
+
+  // Queues a message.  Messages over kMaxMessageSize are rejected.
+  void send(NetChannel channel, const std::string &payload);
+  // Handles a datagram from the peer.  Returns false if it was malformed,
+  // or once the endpoint has failed.
+  bool receivePacket(const std::string &packet, double now);
+  // True once the peer sent more reliable messages ahead of a missing one
+  // than are buffered.  The connection should be dropped.
+  bool hasFailed() const {
+    return failed_;
+  }
+  // Fills packet with the next datagram to send, if there is anything to
+  // send and the pacing allows it.
+  bool nextPacket(std::string &packet, double now);
+  // Pops the next delivered message.
+  bool receive(NetChannel &channel, std::string &payload);
+
+  // Smoothed round trip time, in seconds.
+  double getRTT() const {
+    return srtt_;
+  }
+  // Current pacing rate, in bytes per second.
+  double getSendRate() const {
+    return sendRate_;
+  }
+  // Time the last valid packet arrived, or -1.
+  double getLastReceiveTime() const {
+    return lastReceiveTime_;
+  }
+  size_t getBytesSent() const {
+    return bytesSent_;
+  }
+  size_t getBytesReceived() const {
+    return bytesReceived_;
+  }
+  size_t getPacketsSent() const {
+    return packetsSent_;
+  }
+  size_t getPacketsLost() const {
+    return packetsLost_;
+  }
+  // Reliable fragments not yet acked.
+  size_t getReliableBacklog() const {
+    return reliableQueue_.size();
+  }
+
+ private:
+  struct outgoing_fragment {
+    uint8_t channel;
+    uint16_t messageID;
+    uint16_t index;
+    uint16_t count;
+    std::string data;
+    // -1 if never sent
+    double lastSent;
+    bool acked;
+  };
+  struct sent_packet {
+    uint16_t sequence;
+    bool valid;
+    bool acked;
+    bool lost;
+    // Packets without messages may not be acked until the next keepalive
+    bool hasMessages;
+    double sendTime;
+    size_t size;
+    // (message id, fragment index) of the reliable fragments in the packet
+    std::vector<std::pair<uint16_t, uint16_t>> reliableFragments;
+  };
+  struct incoming_message {
+    uint16_t received;
+    std::vector<bool> have;
+    std::vector<std::string> fragments;
+  };
+
+  static const size_t kSentPacketHistory = 1024;
+
+  void queueFragments(
+      std::deque<outgoing_fragment> &queue,
+      NetChannel channel,
+      uint16_t message_id,
+      const std::string &payload);
+  double getRTO() const;
+  void refillBudget(double now);
+  void processAcks(uint16_t ack, uint32_t ack_bits, double now);
+  void onPacketAcked(sent_packet &sent, double now);
+  void onPacketLost(sent_packet &sent, double now);
+  // Returns false if the reliable messages being reassembled are over
+  // their limit
+  bool receiveFragment(
+      uint8_t channel,
+      uint16_t message_id,
+      uint16_t index,
+      uint16_t count,
+      const std::string &data);
+  void deliverReliable();
+  // Removes the oldest messages being reassembled beyond the limit
+  void trimIncoming(std::map<uint16_t, incoming_message> &incoming);
+
+  // Sending
+  uint16_t nextSequence_;
+  uint16_t nextMessageID_[NET_CHANNEL_COUNT];
+  std::deque<outgoing_fragment> reliableQueue_;
+  std::deque<outgoing_fragment> sequencedQueue_;
+  std::deque<outgoing_fragment> unreliableQueue_;
+  std::vector<sent_packet> sentPackets_;
+  double lastPacketTime_;
+
+  // Pacing and congestion
+  double sendRate_;
+  double sendBudget_;
+  double lastBudgetTime_;
+  double lastRateDecrease_;
+  double srtt_;
+  double rttvar_;
+  bool hasRTT_;
+
+  // Receiving
+  bool hasReceived_;
+  uint16_t remoteSequence_;
+  uint32_t receivedBits_;
+  // Set when a packet with messages arrives, cleared when acks are sent
+  bool ackPending_;
+  double lastReceiveTime_;
+  uint16_t nextReliableID_;
+  std::map<uint16_t, incoming_message> reliableIncoming_;
+  // kMaxFragmentSize for each fragment of the messages in reliableIncoming_
+  size_t reliableIncomingSize_;
+  bool hasSequenced_;
+  uint16_t lastSequencedID_;
+  std::map<uint16_t, incoming_message> sequencedIncoming_;
+  std::map<uint16_t, incoming_message> unreliableIncoming_;
+  std::deque<std::pair<NetChannel, std::string>> delivered_;
+  bool failed_;
+
+  size_t bytesSent_;
+  size_t bytesReceived_;
+  size_t packetsSent_;
+  size_t packetsLost_;
+};
+
+// True if sequence number a is newer than b, allowing for wraparound.
+bool sequence_greater(uint16_t a, uint16_t b);
+
+#endif  // SRC_COMMON_NETCHANNEL_H_
@@ -2,6 +2,8 @@
 #include <cassert>
 #include "common/Exception.h"
 #include "common/Logger.h"
+#include "common/Metrics.h"
+#include "common/Profiler.h"
 #include "common/util.h"
 
 struct net_msg {
@@ -54,43 +56,84 @@ net_msg readPacket(kissnet::tcp_socket_ptr sock, double timeout) throw (kissnet:
   return ret;
 }
 
-void netThreadFunc(
-    kissnet::tcp_socket_ptr sock,
-    std::vector<Json::Value> &queue,
-    std::mutex &queueMutex,
-    std::condition_variable &condVar,
-    bool &running,
-    size_t &bytes_received) {
+static Counter *bytes_received_counter() {
+  static Counter *counter = MetricsRegistry::get()->counter(
+      "rts_net_bytes_received_total",
+      "Bytes read from all connections, including framing");
+  return counter;
+}
+
+static Counter *bytes_sent_counter() {
+  static Counter *counter = MetricsRegistry::get()->counter(
+      "rts_net_bytes_sent_total",
+      "Bytes written to all connections, including framing");
+  return counter;
+}
+
+static Histogram *packet_size_histogram(const char *direction) {
+  return MetricsRegistry::get()->histogram(
+      "rts_net_packet_bytes",
+      "Size of each packet body",
+      1.0,
+      1 << 24,
+      {{"direction", direction}});
+}
+
+void NetConnection::netThreadFunc() {
   Json::Reader reader;
-  while (running) {
+  auto packet_sizes = packet_size_histogram("received");
+  while (running_) {
     Json::Value msg;
     try {
+      Json::Value ping;
+      if (nextPing(ping)) {
+        sendPacket(ping, NET_CHANNEL_UNRELIABLE);
+      }
+
       // TODO(zack): add maybe 100ms timeout to this so the game/thread joins
       // more readily
-      net_msg packet = readPacket(sock, 0.1);
+      net_msg packet = readPacket(sock_, 0.1);
 
       // It was a timeout, just try again
       if (packet.sz == 0) {
         continue;
       }
-      bytes_received += packet.sz + 4;
+      bytesReceived_ += packet.sz + 4;
+      bytes_received_counter()->inc(packet.sz + 4);
+      packet_sizes->recordUnits(packet.sz);
+
+      if (isRawBatch(packet.msg)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batches_.push_back(std::move(packet.msg));
+        condVar_.notify_all();
+        continue;
+      }
 
       // Parse
+      record_section("parse packet");
       reader.parse(packet.msg, msg);
+
+      Json::Value reply;
+      if (handleTimeMessage(msg, reply)) {
+        if (!reply.isNull()) {
+          sendPacket(reply, NET_CHANNEL_UNRELIABLE);
+        }
+        continue;
+      }
     } catch (kissnet::socket_exception e) {
       LOG(ERROR) << "Caught socket exception '" << e.what()
                       << "'... terminating thread.\n";
       // On exception, quit thread
-      running = false;
+      running_ = false;
     }
 
     // Lock and queue
-    std::unique_lock<std::mutex> lock(queueMutex);
-    if (running) {
-      queue.push_back(msg);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (running_) {
+      queue_.push_back(msg);
     }
-    // Wake waiting thread, if applicable
-    condVar.notify_one();
+    // Wake waiting threads, if applicable
+    condVar_.notify_all();
     // automatically unlocks when lock goes out of scope
   }
 
@@ -102,14 +145,7 @@ NetConnection::NetConnection(kissnet::tcp_socket_ptr sock)
     sock_(sock),
     bytesReceived_(0),
     bytesSent_(0) {
-  netThread_ = std::thread(
-    netThreadFunc,
-    sock_,
-    std::ref(queue_),
-    std::ref(mutex_),
-    std::ref(condVar_),
-    std::ref(running_),
-    std::ref(bytesReceived_));
+  netThread_ = std::thread(std::bind(&NetConnection::netThreadFunc, this));
 }
 
 NetConnection::~NetConnection() {
@@ -121,7 +157,10 @@ void NetConnection::stop() {
   running_ = false;
 }
 
-void NetConnection::sendPacket(const Json::Value &message) {
+void NetConnection::sendPacket(
+    const Json::Value &message,
+    NetChannel channel) {
+  record_section("sendPacket");
   Json::FastWriter writer;
   std::string body = writer.write(message);
   uint32_t len = body.size();
@@ -129,9 +168,27 @@ void NetConnection::sendPacket(const Json::Value &message) {
   std::string msg((char *) &len, 4);
   msg.append(body);
 
-  // Just send out the message
+  // Just send out the message.  The network thread sends pongs.
+  std::unique_lock<std::mutex> lock(sendMutex_);
   sock_->send(msg);
   bytesSent_ += msg.length();
+
+  static Histogram *packet_sizes = packet_size_histogram("sent");
+  bytes_sent_counter()->inc(msg.length());
+  packet_sizes->recordUnits(len);
+}
+
+std::vector<Json::Value> NetConnection::drainQueue() {
+  static Histogram *queue_depth = MetricsRegistry::get()->histogram(
+      "rts_net_queue_depth",
+      "Messages waiting in a connection queue when it is drained",
+      1.0,
+      1 << 16);
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<Json::Value> ret;
+  ret.swap(queue_);
+  queue_depth->recordUnits(ret.size());
+  return ret;
 }
 
 Json::Value NetConnection::readNext() {
@@ -154,7 +211,7 @@ Json::Value NetConnection::readNext() {
 
 Json::Value NetConnection::readNext(size_t millis) {
   std::unique_lock<std::mutex> lock(mutex_);
-  LOG(INFO) << "timeout is " << millis << " ms.\n";
+  LOG(DEBUG) << "timeout is " << millis << " ms.\n";
   // Wait until queue has value, thread stopped, or timeout
   bool success = condVar_.wait_for(
     lock,
@@ -175,3 +232,22 @@ Json::Value NetConnection::readNext(size_t millis) {
   // Lock automatically goes out of scope
   return ret;
 }
+
+std::string NetConnection::readNextBatch(size_t millis) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool success = condVar_.wait_for(
+    lock,
+    std::chrono::milliseconds(millis),
+    [this]() {return !running_ || !batches_.empty();});
+
+  if (!success) {
+    throw timeout_exception();
+  }
+  if (!running_ && batches_.empty()) {
+    throw network_exception("network thread died");
+  }
+
+  std::string ret = std::move(batches_.front());
+  batches_.pop_front();
+  return ret;
+}
@@ -4,21 +4,19 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <deque>
 #include <queue>
 #include <json/json.h>
+#include "common/Connection.h"
 #include "common/kissnet.h"
 
-class NetConnection {
+// Length prefixed json messages over TCP.
+class NetConnection : public Connection {
  public:
   explicit NetConnection(kissnet::tcp_socket_ptr sock);
   ~NetConnection();
 
-  std::vector<Json::Value> drainQueue() {
-    std::unique_lock<std::mutex>(mutex_);
-    std::vector<Json::Value> ret;
-    ret.swap(queue_);
-    return ret;
-  }
+  std::vector<Json::Value> drainQueue() override;
 
   std::vector<Json::Value>& getQueue() {
     return queue_;
@@ -31,32 +29,35 @@ class NetConnection {
   std::mutex& getMutex() {
     return mutex_;
   }
-  size_t getBytesSent() {
+  size_t getBytesSent() override {
     return bytesSent_;
   }
-  size_t getBytesReceived() {
+  size_t getBytesReceived() override {
     return bytesReceived_;
   }
 
-  bool running() const {
+  bool running() const override {
     return running_;
   }
 
-  // Blocks until next message becomes available.
-  // throws an exception if the socket is closed unexpectedly
-  // throws an exception on timeout (arg version)
-  Json::Value readNext();
-  Json::Value readNext(size_t millis);
+  Json::Value readNext() override;
+  Json::Value readNext(size_t millis) override;
+  std::string readNextBatch(size_t millis) override;
 
-  void sendPacket(const Json::Value &msg);
+  using Connection::sendPacket;
+  void sendPacket(const Json::Value &msg, NetChannel channel) override;
 
-  void stop();
+  void stop() override;
 
  private:
+  void netThreadFunc();
+
   bool running_;
   kissnet::tcp_socket_ptr sock_;
   std::vector<Json::Value> queue_;
+  std::deque<std::string> batches_;
   std::mutex mutex_;
+  std::mutex sendMutex_;
   std::condition_variable condVar_;
   std::thread netThread_;
   size_t bytesSent_;
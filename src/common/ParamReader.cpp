@@ -3,7 +3,7 @@
 #include <sstream>
 #include <boost/algorithm/string.hpp>
 #include "common/Checksum.h"
-#include "common/Clock.h"
+#include "common/Profiler.h"
 #include "common/util.h"
 
 ParamReader::ParamReader() {
@@ -93,7 +93,7 @@ void ParamReader::flattenValue(
       flattenValue(*it, name);
     }
     // always save param, so people can access object params too
-    params_[name] = *it;
+    setValue(name, *it);
   }
 }
 
@@ -102,13 +102,27 @@ bool ParamReader::hasParam(const std::string &param) const {
 }
 
 Json::Value ParamReader::getParam(const std::string &param) const {
+  return getSlot(param)->value;
+}
+
+const param_slot *ParamReader::getSlot(const std::string &param) const {
   auto it = params_.find(param);
   if (it == params_.end()) {
     LOG(FATAL) << "missing param: " << param << '\n';
     throw param_exception("Param " + param + " not found.\n");
   }
 
-  return it->second;
+  return &it->second;
+}
+
+void ParamReader::setValue(const std::string &param, const Json::Value &value) {
+  param_slot &slot = params_[param];
+  // Unchanged values keep their version so handles stay valid
+  if (slot.version && slot.value == value) {
+    return;
+  }
+  slot.value = value;
+  slot.version++;
 }
 
 // Global helpers
@@ -124,21 +138,15 @@ bool hasParam(const std::string &param) {
 }
 
 std::string strParam(const std::string &param) {
-  Json::Value val = ParamReader::get()->getParam(param);
-  invariant(val.isString(), "unknown or badly typed param");
-  return val.asString();
+  return param_cast<std::string>(ParamReader::get()->getParam(param), param);
 }
 
 float fltParam(const std::string &param) {
-  Json::Value val = ParamReader::get()->getParam(param);
-  invariant(val.isNumeric(), "unknown or badly typed param");
-  return val.asFloat();
+  return param_cast<float>(ParamReader::get()->getParam(param), param);
 }
 
 int intParam(const std::string &param) {
-  Json::Value val = ParamReader::get()->getParam(param);
-  invariant(val.isInt(), "unknown or badly typed param");
-  return val.asInt();
+  return param_cast<int>(ParamReader::get()->getParam(param), param);
 }
 
 std::vector<std::string> arrParam(const std::string &param) {
@@ -152,22 +160,52 @@ std::vector<std::string> arrParam(const std::string &param) {
 }
 
 glm::vec2 vec2Param(const std::string &param) {
-  Json::Value arr = ParamReader::get()->getParam(param);
+  return param_cast<glm::vec2>(ParamReader::get()->getParam(param), param);
+}
+
+glm::vec3 vec3Param(const std::string &param) {
+  return param_cast<glm::vec3>(ParamReader::get()->getParam(param), param);
+}
+
+glm::vec4 vec4Param(const std::string &param) {
+  return param_cast<glm::vec4>(ParamReader::get()->getParam(param), param);
+}
+
+template<>
+std::string param_cast(const Json::Value &val, const std::string &param) {
+  invariant(val.isString(), "unknown or badly typed param " + param);
+  return val.asString();
+}
+
+template<>
+float param_cast(const Json::Value &val, const std::string &param) {
+  invariant(val.isNumeric(), "unknown or badly typed param " + param);
+  return val.asFloat();
+}
+
+template<>
+int param_cast(const Json::Value &val, const std::string &param) {
+  invariant(val.isInt(), "unknown or badly typed param " + param);
+  return val.asInt();
+}
+
+template<>
+glm::vec2 param_cast(const Json::Value &arr, const std::string &param) {
   invariant(arr.isArray() && arr.size() == 2,
-      "vec2 param not found or not correctly sized array");
+      "vec2 param " + param + " not found or not correctly sized array");
   return toVec2(arr);
 }
 
-glm::vec3 vec3Param(const std::string &param) {
-  Json::Value arr = ParamReader::get()->getParam(param);
+template<>
+glm::vec3 param_cast(const Json::Value &arr, const std::string &param) {
   invariant(arr.isArray() && arr.size() == 3,
-      "vec3 param not found or not correctly sized array");
+      "vec3 param " + param + " not found or not correctly sized array");
   return toVec3(arr);
 }
 
-glm::vec4 vec4Param(const std::string &param) {
-  Json::Value arr = ParamReader::get()->getParam(param);
+template<>
+glm::vec4 param_cast(const Json::Value &arr, const std::string &param) {
   invariant(arr.isArray() && arr.size() == 4,
-      "vec4 param not found or not correctly sized array");
+      "vec4 param " + param + " not found or not correctly sized array");
   return toVec4(arr);
 }
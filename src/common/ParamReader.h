@@ -31,17 +31,29 @@ class param_exception : public exception_with_trace {
 };
 
 
+// Storage for a single param.  Slots are never freed, so Param handles can
+// keep a pointer to them.  version changes whenever value does.
+struct param_slot {
+  param_slot() : version(0) { }
+
+  Json::Value value;
+  uint32_t version;
+};
+
 class ParamReader {
  public:
   static ParamReader *get();
 
+  // Loading a file over existing params invalidates their Param handles.
   void loadFile(const char *filename);
 
   bool hasParam(const std::string &param) const;
   Json::Value getParam(const std::string &param) const;
+  // Throws param_exception if the param doesn't exist.
+  const param_slot *getSlot(const std::string &param) const;
   template<class T>
   void setParam(const std::string &param, const T& value) {
-    params_[param] = toJson(value);
+    setValue(param, toJson(value));
   }
 
   // Returns a checksum of the root file loaded.  Any included files have
@@ -53,8 +65,9 @@ class ParamReader {
  private:
   ParamReader();
   void flattenValue(const Json::Value &v, const std::string &prefix = "");
+  void setValue(const std::string &param, const Json::Value &value);
 
-  std::unordered_map<std::string, Json::Value> params_;
+  std::unordered_map<std::string, param_slot> params_;
   uint32_t fileChecksum_;
 };
 
@@ -63,4 +76,70 @@ void setParam(const std::string &param, const T& value) {
   ParamReader::get()->setParam(param, value);
 }
 
+// Converts a param value, failing an invariant on a type mismatch.
+template<class T>
+T param_cast(const Json::Value &value, const std::string &param);
+template<> float param_cast(
+    const Json::Value &value,
+    const std::string &param);
+template<> int param_cast(
+    const Json::Value &value,
+    const std::string &param);
+template<> std::string param_cast(
+    const Json::Value &value,
+    const std::string &param);
+template<> glm::vec2 param_cast(
+    const Json::Value &value,
+    const std::string &param);
+template<> glm::vec3 param_cast(
+    const Json::Value &value,
+    const std::string &param);
+template<> glm::vec4 param_cast(
+    const Json::Value &value,
+    const std::string &param);
+
+// A handle to a param that looks up and converts the value once, for use in
+// per frame code.  get() is a version check and a load until the param
+// changes.  The param must exist by the first get().
+//
+// static Param<float> thickness("ui.highlight.thickness");
+// float t = thickness.get();
+template<class T>
+class Param {
+ public:
+  explicit Param(const std::string &name)
+    : name_(name),
+      slot_(nullptr),
+      version_(0) {
+  }
+
+  const T& get() const {
+    if (!slot_ || slot_->version != version_) {
+      resolve();
+    }
+    return value_;
+  }
+  operator const T&() const {
+    return get();
+  }
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+ private:
+  void resolve() const {
+    if (!slot_) {
+      slot_ = ParamReader::get()->getSlot(name_);
+    }
+    value_ = param_cast<T>(slot_->value, name_);
+    version_ = slot_->version;
+  }
+
+  const std::string name_;
+  mutable const param_slot *slot_;
+  mutable uint32_t version_;
+  mutable T value_;
+};
+
 #endif  // SRC_COMMON_PARAMREADER_H_
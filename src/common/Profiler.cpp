@@ -0,0 +1,178 @@
+#include "common/Profiler.h"
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+PROFILER_THREAD_LOCAL ProfilerThreadBuffer *Profiler::threadBuffer_ = nullptr;
+
+// How often the aggregator drains the thread buffers.  Must be well under the
+// time it takes a busy thread to fill its buffer.
+static const std::chrono::milliseconds AGGREGATE_INTERVAL(20);
+
+Profiler *Profiler::get() {
+  static Profiler profiler;
+  return &profiler;
+}
+
+Profiler::Profiler()
+  : enabled_(false),
+    running_(false),
+    startTicks_(profiler_now()),
+    startTime_(std::chrono::steady_clock::now()) {
+}
+
+Profiler::~Profiler() {
+  stop();
+}
+
+void Profiler::start() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  enabled_ = true;
+  aggregator_ = std::thread(std::bind(&Profiler::aggregatorFunc, this));
+}
+
+void Profiler::stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    enabled_ = false;
+    cond_.notify_all();
+  }
+  aggregator_.join();
+}
+
+ProfilerThreadBuffer *Profiler::registerThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  buffers_.emplace_back(new ProfilerThreadBuffer(buffers_.size()));
+  pending_.emplace_back();
+  return buffers_.back().get();
+}
+
+void Profiler::aggregatorFunc() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    cond_.wait_for(lock, AGGREGATE_INTERVAL);
+    for (size_t i = 0; i < buffers_.size(); i++) {
+      drain(i);
+    }
+  }
+}
+
+void Profiler::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    drain(i);
+  }
+}
+
+static void merge_node(ProfileNode &into, const ProfileNode &from) {
+  into.name = from.name;
+  into.calls += from.calls;
+  into.seconds += from.seconds;
+  for (const auto &pair : from.children) {
+    merge_node(into.children[pair.first], pair.second);
+  }
+}
+
+// Records are written when a section ends, so they arrive children first.
+// Completed children wait in pending[depth] until their parent shows up.
+void Profiler::drain(size_t thread_idx) {
+  auto &buffer = *buffers_[thread_idx];
+  auto &pending = pending_[thread_idx];
+  const double seconds_per_tick = secondsPerTick();
+
+  uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+  uint64_t head = buffer.head.load(std::memory_order_acquire);
+  for (uint64_t i = tail; i < head; i++) {
+    const section_record &record =
+      buffer.records[i % ProfilerThreadBuffer::kCapacity];
+
+    ProfileNode node;
+    node.name = record.name;
+    node.calls = 1;
+    node.seconds = seconds_per_tick * (record.end - record.start);
+    if (pending.size() > record.depth + 1) {
+      for (const auto &child : pending[record.depth + 1]) {
+        merge_node(node.children[child.name], child);
+      }
+      pending[record.depth + 1].clear();
+    }
+
+    if (record.depth == 0) {
+      merge_node(trees_[buffer.threadIndex][node.name], node);
+    } else {
+      if (pending.size() <= record.depth) {
+        pending.resize(record.depth + 1);
+      }
+      pending[record.depth].push_back(node);
+    }
+  }
+  buffer.tail.store(head, std::memory_order_release);
+}
+
+double Profiler::secondsPerTick() const {
+  // Calibrate against the steady clock over the lifetime of the profiler,
+  // tsc rates are constant on anything we run on.
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - startTime_).count();
+  profile_ticks_t elapsed_ticks = profiler_now() - startTicks_;
+  if (elapsed_ticks == 0) {
+    return 0.0;
+  }
+  return (elapsed / 1e9) / elapsed_ticks;
+}
+
+std::map<uint32_t, std::map<std::string, ProfileNode>> Profiler::getTrees() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return trees_;
+}
+
+void Profiler::reset() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  trees_.clear();
+}
+
+static void print_node(
+    std::ostream &os,
+    const ProfileNode &node,
+    double frames,
+    int indent) {
+  os << std::string(2 * indent, ' ') << node.name << ": "
+    << 1000.0 * node.seconds / frames << " ms";
+  // Top level sections run once per frame by definition
+  if (indent > 2) {
+    os << " (" << node.calls / frames << " calls)";
+  }
+  os << '\n';
+  for (const auto &pair : node.children) {
+    print_node(os, pair.second, frames, indent + 1);
+  }
+}
+
+std::string Profiler::report() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  for (const auto &thread_pair : trees_) {
+    uint64_t dropped = buffers_[thread_pair.first]->dropped.exchange(0);
+    os << "Thread " << thread_pair.first;
+    if (dropped) {
+      os << " (" << dropped << " sections dropped)";
+    }
+    os << '\n';
+    for (const auto &pair : thread_pair.second) {
+      const auto &root = pair.second;
+      os << "  " << root.calls << " frames, per frame:\n";
+      print_node(os, root, root.calls, 2);
+    }
+  }
+  trees_.clear();
+  return os.str();
+}
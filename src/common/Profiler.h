@@ -0,0 +1,183 @@
+#ifndef SRC_COMMON_PROFILER_H_
+#define SRC_COMMON_PROFILER_H_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Hierarchical section profiler, cheap enough to leave on in release builds.
+//
+// record_section("name") times the rest of the enclosing scope.  The name
+// must be a string literal, it is stored by pointer.  Each thread writes
+// completed sections to its own lock free ring buffer, and a background
+// thread drains the buffers and builds a per-frame tree for each top level
+// section.
+
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+typedef uint64_t profile_ticks_t;
+
+inline profile_ticks_t profiler_now() {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct section_record {
+  const char *name;
+  uint32_t depth;
+  profile_ticks_t start;
+  profile_ticks_t end;
+};
+
+// Single producer (the owning thread), single consumer (the aggregator).
+struct ProfilerThreadBuffer {
+  static const size_t kCapacity = 1 << 14;
+
+  ProfilerThreadBuffer(uint32_t index)
+    : head(0), tail(0), dropped(0), depth(0), threadIndex(index) {
+  }
+
+  section_record records[kCapacity];
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  std::atomic<uint64_t> dropped;
+  // Only touched by the owning thread
+  uint32_t depth;
+  const uint32_t threadIndex;
+};
+
+// Aggregated timings for one section, and the sections nested inside it.
+struct ProfileNode {
+  ProfileNode() : calls(0), seconds(0.0) { }
+
+  std::string name;
+  uint64_t calls;
+  double seconds;
+  std::map<std::string, ProfileNode> children;
+};
+
+class Profiler {
+ public:
+  static Profiler *get();
+
+  // Starts recording and the aggregation thread.
+  void start();
+  void stop();
+  bool isEnabled() const {
+    return enabled_;
+  }
+
+  // Drains all thread buffers now, instead of waiting for the aggregator.
+  void flush();
+
+  // Returns the top level sections aggregated since the last reset, keyed by
+  // thread and then name.  calls on a root node is the number of frames.
+  std::map<uint32_t, std::map<std::string, ProfileNode>> getTrees();
+  void reset();
+  // Per frame averages of getTrees, formatted for the console.  Resets.
+  std::string report();
+
+  // Called by ProfileScope
+  static ProfilerThreadBuffer *getThreadBuffer() {
+    if (!threadBuffer_) {
+      threadBuffer_ = get()->registerThread();
+    }
+    return threadBuffer_;
+  }
+
+ private:
+  Profiler();
+  ~Profiler();
+
+  ProfilerThreadBuffer *registerThread();
+  void aggregatorFunc();
+  void drain(size_t thread_idx);
+  double secondsPerTick() const;
+
+  static PROFILER_THREAD_LOCAL ProfilerThreadBuffer *threadBuffer_;
+
+  std::atomic<bool> enabled_;
+  bool running_;
+  std::thread aggregator_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Guarded by mutex_
+  std::vector<std::unique_ptr<ProfilerThreadBuffer>> buffers_;
+  // Per thread: sections completed but whose parent hasn't, by depth
+  std::vector<std::vector<std::vector<ProfileNode>>> pending_;
+  std::map<uint32_t, std::map<std::string, ProfileNode>> trees_;
+
+  // For converting ticks to seconds
+  profile_ticks_t startTicks_;
+  std::chrono::steady_clock::time_point startTime_;
+};
+
+// Object that records a section from construction until it is destroyed
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char *name)
+    : name_(name), buffer_(nullptr) {
+    if (!Profiler::get()->isEnabled()) {
+      return;
+    }
+    buffer_ = Profiler::getThreadBuffer();
+    depth_ = buffer_->depth++;
+    start_ = profiler_now();
+  }
+
+  ~ProfileScope() {
+    if (!buffer_) {
+      return;
+    }
+    section_record record;
+    record.end = profiler_now();
+    record.start = start_;
+    record.name = name_;
+    record.depth = depth_;
+    buffer_->depth--;
+
+    uint64_t head = buffer_->head.load(std::memory_order_relaxed);
+    uint64_t tail = buffer_->tail.load(std::memory_order_acquire);
+    if (head - tail >= ProfilerThreadBuffer::kCapacity) {
+      buffer_->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    buffer_->records[head % ProfilerThreadBuffer::kCapacity] = record;
+    buffer_->head.store(head + 1, std::memory_order_release);
+  }
+
+ private:
+  ProfileScope(const ProfileScope &);
+
+  const char *name_;
+  ProfilerThreadBuffer *buffer_;
+  uint32_t depth_;
+  profile_ticks_t start_;
+};
+
+#define PROFILER_CONCAT_IMPL(x, y) x##y
+#define PROFILER_CONCAT(x, y) PROFILER_CONCAT_IMPL(x, y)
+#define record_section(name) \
+  ProfileScope PROFILER_CONCAT(profile_scope_, __LINE__)(name)
+
+#endif  // SRC_COMMON_PROFILER_H_
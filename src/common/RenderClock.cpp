@@ -0,0 +1,56 @@
+#include "common/RenderClock.h"
+#include <algorithm>
+#include <cmath>
+
+// Smoothing of the lateness estimates.  Jitter rises faster than it decays,
+// so a burst of late snapshots grows the delay quickly.
+static const double LATENESS_GAIN = 1.0 / 16.0;
+static const double JITTER_RISE_GAIN = 1.0 / 4.0;
+static const double JITTER_DECAY_GAIN = 1.0 / 32.0;
+// Mean deviations of lateness to allow for
+static const double JITTER_MARGIN = 2.0;
+// The render clock runs at most this much faster or slower than real time.
+// Below that, gaps close exponentially over about SLEW_TIME seconds.
+static const double MAX_SLEW = 0.1;
+static const double SLEW_TIME = 1.0;
+// Gaps bigger than this are jumped
+static const double SNAP_DISTANCE = 0.25;
+
+RenderClock::RenderClock()
+  : hasSnapshot_(false),
+    interval_(0.0),
+    lateness_(0.0),
+    jitter_(0.0) {
+}
+
+void RenderClock::addSnapshot(double t, double dt, double server_time) {
+  const double lateness = server_time - t;
+  interval_ = dt;
+  if (!hasSnapshot_) {
+    lateness_ = lateness;
+    jitter_ = 0.0;
+    hasSnapshot_ = true;
+    return;
+  }
+  const double deviation = fabs(lateness - lateness_);
+  const double jitter_gain = deviation > jitter_
+    ? JITTER_RISE_GAIN
+    : JITTER_DECAY_GAIN;
+  jitter_ += jitter_gain * (deviation - jitter_);
+  lateness_ += LATENESS_GAIN * (lateness - lateness_);
+}
+
+double RenderClock::getDelay() const {
+  return std::min(
+      MAX_RENDER_DELAY,
+      std::max(0.0, lateness_) + interval_ + JITTER_MARGIN * jitter_);
+}
+
+float RenderClock::correct(float &render_t, double server_time) const {
+  const double error = getTarget(server_time) - render_t;
+  if (fabs(error) > SNAP_DISTANCE) {
+    render_t = getTarget(server_time);
+    return 1.f;
+  }
+  return 1.0 + std::max(-MAX_SLEW, std::min(MAX_SLEW, error / SLEW_TIME));
+}
@@ -0,0 +1,51 @@
+#ifndef SRC_COMMON_RENDERCLOCK_H_
+#define SRC_COMMON_RENDERCLOCK_H_
+
+// The most the render clock trails the server's, in seconds
+const double MAX_RENDER_DELAY = 1.0;
+
+// Picks the game time a client renders: behind the server's clock by enough
+// that a snapshot on either side of it has usually arrived.
+//
+// A snapshot's lateness is how long after its game time it arrived, on the
+// server's clock.  The delay is the typical lateness, plus a snapshot
+// interval, plus a margin that grows with how much the lateness varies.
+// The render clock is sped up or slowed down a little to close on the
+// target instead of jumping, unless it is far off.
+class RenderClock {
+ public:
+  RenderClock();
+
+  // A snapshot of game time t arrived when the server's clock read
+  // server_time.  dt is the time between snapshots.
+  void addSnapshot(double t, double dt, double server_time);
+
+  // Seconds behind the server's clock to render.
+  double getDelay() const;
+  double getTarget(double server_time) const {
+    return server_time - getDelay();
+  }
+  // Returns how fast to run the render clock, relative to real time, to
+  // close on the target.  If render_t is too far off to slew, moves it to
+  // the target and returns 1.
+  float correct(float &render_t, double server_time) const;
+
+  bool hasSnapshot() const {
+    return hasSnapshot_;
+  }
+  double getLateness() const {
+    return lateness_;
+  }
+  double getJitter() const {
+    return jitter_;
+  }
+
+ private:
+  bool hasSnapshot_;
+  double interval_;
+  // Smoothed lateness, and its mean deviation
+  double lateness_;
+  double jitter_;
+};
+
+#endif  // SRC_COMMON_RENDERCLOCK_H_
@@ -0,0 +1,108 @@
+#ifndef SRC_COMMON_RINGBUFFER_H_
+#define SRC_COMMON_RINGBUFFER_H_
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "common/util.h"
+
+// A double ended queue of at most maxSize elements, in one block that grows
+// by doubling up to that size.  Pushing onto a full buffer drops the
+// oldest element.  Elements removed from either end are only destroyed when
+// their slot is reused.
+template<typename T>
+class RingBuffer {
+ public:
+  explicit RingBuffer(size_t max_size)
+    : maxSize_(max_size),
+      head_(0),
+      size_(0) {
+    invariant(max_size > 0, "ring buffer must hold something");
+  }
+
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  // Elements there is memory for
+  size_t capacity() const {
+    return data_.capacity();
+  }
+  size_t maxSize() const {
+    return maxSize_;
+  }
+
+  // Index 0 is the oldest element
+  T &operator[](size_t i) {
+    return data_[(head_ + i) % data_.size()];
+  }
+  const T &operator[](size_t i) const {
+    return data_[(head_ + i) % data_.size()];
+  }
+  T &front() {
+    return (*this)[0];
+  }
+  const T &front() const {
+    return (*this)[0];
+  }
+  T &back() {
+    return (*this)[size_ - 1];
+  }
+  const T &back() const {
+    return (*this)[size_ - 1];
+  }
+
+  void push_back(T val) {
+    if (size_ == maxSize_) {
+      pop_front();
+    }
+    if (size_ < data_.size()) {
+      (*this)[size_] = std::move(val);
+    } else {
+      if (head_ != 0 || data_.size() == data_.capacity()) {
+        grow();
+      }
+      data_.push_back(std::move(val));
+    }
+    size_++;
+  }
+
+  // Requires !empty()
+  void pop_front() {
+    head_ = (head_ + 1) % data_.size();
+    size_--;
+  }
+  // Keeps the memory for reuse
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+  // Drops the newest elements until n are left
+  void truncate(size_t n) {
+    if (n < size_) {
+      size_ = n;
+    }
+  }
+
+ private:
+  // Moves the elements to a new block with room for at least one more, in
+  // order from index 0 so the free slots are at the end.
+  void grow() {
+    std::vector<T> data;
+    data.reserve(std::min(std::max<size_t>(2 * size_, 4), maxSize_));
+    for (size_t i = 0; i < size_; i++) {
+      data.push_back(std::move((*this)[i]));
+    }
+    data_.swap(data);
+    head_ = 0;
+  }
+
+  size_t maxSize_;
+  size_t head_;
+  size_t size_;
+  std::vector<T> data_;
+};
+
+#endif  // SRC_COMMON_RINGBUFFER_H_
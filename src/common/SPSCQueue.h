@@ -0,0 +1,52 @@
+#ifndef SRC_COMMON_SPSCQUEUE_H_
+#define SRC_COMMON_SPSCQUEUE_H_
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// A bounded queue between one producer thread and one consumer thread,
+// without locks.  Each index is only written by one side; the release store
+// of an index publishes the slot it covers to the other side.
+template<typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(size_t capacity)
+    : slots_(capacity + 1),
+      head_(0),
+      tail_(0) {
+  }
+
+  // Producer only.  Returns false, leaving value alone, if the queue is
+  // full.
+  bool push(T &value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t next = (tail + 1) % slots_.size();
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots_[tail] = std::move(value);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only.  Returns false if the queue is empty.
+  bool pop(T &value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots_[head]);
+    head_.store((head + 1) % slots_.size(), std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> slots_;
+  // Next slot to pop, written by the consumer
+  std::atomic<size_t> head_;
+  // Next slot to push, written by the producer
+  std::atomic<size_t> tail_;
+};
+
+#endif  // SRC_COMMON_SPSCQUEUE_H_
@@ -0,0 +1,144 @@
+#ifndef SRC_COMMON_SLOTMAP_H_
+#define SRC_COMMON_SLOTMAP_H_
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Values stored contiguously, so visiting all of them is a linear scan, with
+// handles that stay valid while the values move around.  Removing a value
+// moves the last one into its place.
+//
+// A handle is a slot index and the slot's generation, which goes up each
+// time the slot is freed.  Handles to removed values never find a value
+// stored later in the same slot.  Handles are never 0.
+template<typename T>
+class SlotMap {
+ public:
+  typedef uint64_t handle_type;
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  SlotMap()
+    : freeHead_(NO_SLOT) {
+  }
+
+  handle_type insert(T value) {
+    uint32_t slot_idx;
+    if (freeHead_ != NO_SLOT) {
+      slot_idx = freeHead_;
+      freeHead_ = slots_[slot_idx].index;
+    } else {
+      slot_idx = slots_.size();
+      slot s;
+      s.generation = 1;
+      slots_.push_back(s);
+    }
+    slots_[slot_idx].index = values_.size();
+    values_.push_back(std::move(value));
+    valueSlots_.push_back(slot_idx);
+    return makeHandle(slot_idx, slots_[slot_idx].generation);
+  }
+
+  // Returns false if there was no value for h
+  bool erase(handle_type h) {
+    const uint32_t slot_idx = findSlot(h);
+    if (slot_idx == NO_SLOT) {
+      return false;
+    }
+    slot &s = slots_[slot_idx];
+    const uint32_t last = values_.size() - 1;
+    if (s.index != last) {
+      values_[s.index] = std::move(values_[last]);
+      valueSlots_[s.index] = valueSlots_[last];
+      slots_[valueSlots_[s.index]].index = s.index;
+    }
+    values_.pop_back();
+    valueSlots_.pop_back();
+    s.generation++;
+    s.index = freeHead_;
+    freeHead_ = slot_idx;
+    return true;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < valueSlots_.size(); i++) {
+      slot &s = slots_[valueSlots_[i]];
+      s.generation++;
+      s.index = freeHead_;
+      freeHead_ = valueSlots_[i];
+    }
+    values_.clear();
+    valueSlots_.clear();
+  }
+
+  // Returns null if there is no value for h
+  T * find(handle_type h) {
+    const uint32_t slot_idx = findSlot(h);
+    return slot_idx == NO_SLOT ? nullptr : &values_[slots_[slot_idx].index];
+  }
+  const T * find(handle_type h) const {
+    const uint32_t slot_idx = findSlot(h);
+    return slot_idx == NO_SLOT ? nullptr : &values_[slots_[slot_idx].index];
+  }
+
+  size_t size() const {
+    return values_.size();
+  }
+  bool empty() const {
+    return values_.empty();
+  }
+  // Handle of the value at position i of the iteration order
+  handle_type handleAt(size_t i) const {
+    const uint32_t slot_idx = valueSlots_[i];
+    return makeHandle(slot_idx, slots_[slot_idx].generation);
+  }
+
+  iterator begin() {
+    return values_.begin();
+  }
+  iterator end() {
+    return values_.end();
+  }
+  const_iterator begin() const {
+    return values_.begin();
+  }
+  const_iterator end() const {
+    return values_.end();
+  }
+
+ private:
+  static const uint32_t NO_SLOT = UINT32_MAX;
+
+  struct slot {
+    uint32_t generation;
+    // Position in values_, or the next free slot
+    uint32_t index;
+  };
+
+  static handle_type makeHandle(uint32_t slot_idx, uint32_t generation) {
+    return (static_cast<handle_type>(generation) << 32) | slot_idx;
+  }
+  uint32_t findSlot(handle_type h) const {
+    const uint32_t slot_idx = h & UINT32_MAX;
+    const uint32_t generation = h >> 32;
+    if (slot_idx >= slots_.size()) {
+      return NO_SLOT;
+    }
+    const slot &s = slots_[slot_idx];
+    if (s.generation != generation
+        || s.index >= valueSlots_.size()
+        || valueSlots_[s.index] != slot_idx) {
+      return NO_SLOT;
+    }
+    return slot_idx;
+  }
+
+  std::vector<slot> slots_;
+  uint32_t freeHead_;
+  std::vector<T> values_;
+  // Slot of each value
+  std::vector<uint32_t> valueSlots_;
+};
+
+#endif  // SRC_COMMON_SLOTMAP_H_
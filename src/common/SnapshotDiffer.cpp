@@ -0,0 +1,283 @@
+#include "common/SnapshotDiffer.h"
+#include <algorithm>
+#include <cmath>
+#include "common/util.h"
+
+bool json_values_close(
+    const Json::Value &a,
+    const Json::Value &b,
+    double quantum) {
+  if (quantum > 0.0 && a.isNumeric() && b.isNumeric()
+      && !a.isBool() && !b.isBool()) {
+    return std::fabs(a.asDouble() - b.asDouble()) < quantum;
+  }
+  if (a.type() != b.type()) {
+    return a == b;
+  }
+  if (a.isArray()) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (Json::ArrayIndex i = 0; i < a.size(); i++) {
+      if (!json_values_close(a[i], b[i], quantum)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (a.isObject()) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (auto it = a.begin(); it != a.end(); it++) {
+      const char *name = it.memberName();
+      if (!b.isMember(name) || !json_values_close(*it, b[name], quantum)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return a == b;
+}
+
+SnapshotDiffer::SnapshotDiffer()
+  : hasLastT_(false),
+    lastT_(0.f) {
+}
+
+void SnapshotDiffer::setQuantum(const std::string &field, double quantum) {
+  quanta_[field] = quantum;
+}
+
+void SnapshotDiffer::setRemovedValue(
+    const std::string &field,
+    const Json::Value &value) {
+  removedField_ = field;
+  removedValue_ = value;
+}
+
+double SnapshotDiffer::getQuantum(const std::string &field) const {
+  auto it = quanta_.find(field);
+  return it == quanta_.end() ? 0.0 : it->second;
+}
+
+void SnapshotDiffer::reset() {
+  sent_.clear();
+  hasLastT_ = false;
+}
+
+static Json::Value make_sample(float t, const Json::Value &value) {
+  Json::Value sample(Json::arrayValue);
+  sample.append(t);
+  sample.append(value);
+  return sample;
+}
+
+Json::Value SnapshotDiffer::diff(
+    float t,
+    const Json::Value &objects,
+    const snapshot_state &baseline,
+    float prev_t,
+    const snapshot_state *previous,
+    const std::vector<const snapshot_state *> &unacked,
+    snapshot_state &view) const {
+  typedef std::map<std::string, snapshot_field> object_state;
+  Json::Value ret(Json::objectValue);
+  view.clear();
+  std::vector<const object_state *> object_unacked;
+
+  for (auto it = objects.begin(); it != objects.end(); it++) {
+    const std::string id = it.memberName();
+    auto &object_view = view[id];
+    auto base_it = baseline.find(id);
+    if (base_it != baseline.end()) {
+      object_view = base_it->second;
+    }
+    const std::map<std::string, snapshot_field> *object_previous = nullptr;
+    if (previous) {
+      auto prev_it = previous->find(id);
+      if (prev_it != previous->end()) {
+        object_previous = &prev_it->second;
+      }
+    }
+    object_unacked.clear();
+    for (const snapshot_state *state : unacked) {
+      auto unacked_it = state->find(id);
+      if (unacked_it != state->end()) {
+        object_unacked.push_back(&unacked_it->second);
+      }
+    }
+
+    Json::Value object_diff(Json::objectValue);
+    const Json::Value &object = *it;
+    for (auto field_it = object.begin(); field_it != object.end(); field_it++) {
+      const std::string field = field_it.memberName();
+      const Json::Value &value = *field_it;
+      const double quantum = getQuantum(field);
+      auto state_it = object_view.find(field);
+      if (state_it != object_view.end()
+          && json_values_close(state_it->second.value, value, quantum)) {
+        // A change since baseline that was changed back still has to be
+        // sent, the receiver may be holding the changed value.
+        bool unchanged = true;
+        for (const object_state *state : object_unacked) {
+          auto unacked_it = state->find(field);
+          if (unacked_it != state->end()
+              && !json_values_close(
+                unacked_it->second.value,
+                value,
+                quantum)) {
+            unchanged = false;
+            break;
+          }
+        }
+        if (unchanged) {
+          continue;
+        }
+      }
+
+      Json::Value samples(Json::arrayValue);
+      // Only hold if nothing newer than the baseline was sent since, the
+      // receiver may have applied that.
+      if (state_it != object_view.end()
+          && object_previous
+          && state_it->second.t < prev_t) {
+        auto prev_field_it = object_previous->find(field);
+        if (prev_field_it != object_previous->end()
+            && prev_field_it->second.t == state_it->second.t) {
+          samples.append(make_sample(prev_t, state_it->second.value));
+        }
+      }
+      samples.append(make_sample(t, value));
+      object_diff[field] = samples;
+
+      snapshot_field &state = object_view[field];
+      state.value = value;
+      state.t = t;
+    }
+
+    if (!object_diff.empty()) {
+      ret[id] = object_diff;
+    }
+  }
+
+  if (!removedField_.empty()) {
+    // Including objects that came and went since baseline
+    std::vector<const snapshot_state *> known(unacked);
+    known.push_back(&baseline);
+    for (const snapshot_state *state : known) {
+      for (const auto &pair : *state) {
+        if (!objects.isMember(pair.first) && !ret.isMember(pair.first)) {
+          ret[pair.first][removedField_].append(
+              make_sample(t, removedValue_));
+        }
+      }
+    }
+  }
+
+  return ret;
+}
+
+Json::Value SnapshotDiffer::diff(float t, const Json::Value &objects) {
+  snapshot_state view;
+  Json::Value ret = diff(
+      t,
+      objects,
+      sent_,
+      lastT_,
+      hasLastT_ ? &sent_ : nullptr,
+      std::vector<const snapshot_state *>(),
+      view);
+  sent_.swap(view);
+  hasLastT_ = true;
+  lastT_ = t;
+  return ret;
+}
+
+// An empty ring slot
+static const uint64_t NO_TICK = ~0ull;
+
+DeltaEncoder::DeltaEncoder(const SnapshotDiffer &differ, size_t history_size)
+  : differ_(differ),
+    history_(history_size) {
+  invariant(history_size > 0, "delta history must not be empty");
+  reset();
+}
+
+void DeltaEncoder::reset() {
+  for (auto &entry : history_) {
+    entry.tick = NO_TICK;
+    entry.view.clear();
+  }
+  hasSent_ = false;
+  lastTick_ = 0;
+  ackedTick_ = -1;
+}
+
+const DeltaEncoder::sent_snapshot *DeltaEncoder::find(uint64_t tick) const {
+  if (!hasSent_ || tick > lastTick_ || lastTick_ - tick >= history_.size()) {
+    return nullptr;
+  }
+  const sent_snapshot &entry = history_[tick % history_.size()];
+  return entry.tick == tick ? &entry : nullptr;
+}
+
+void DeltaEncoder::ack(uint64_t tick) {
+  // Acks can arrive out of order, and for ticks that were never sent if the
+  // client is confused.  Only move forward to snapshots we still have.
+  if (static_cast<int64_t>(tick) > ackedTick_ && find(tick)) {
+    ackedTick_ = tick;
+  }
+}
+
+Json::Value DeltaEncoder::encode(
+    uint64_t tick,
+    float t,
+    const Json::Value &objects,
+    int64_t &baseline_tick) {
+  invariant(
+      !hasSent_ || tick > lastTick_,
+      "delta encoded ticks must increase");
+  static const snapshot_state empty_state;
+
+  const sent_snapshot *base =
+    ackedTick_ >= 0 ? find(ackedTick_) : nullptr;
+  const sent_snapshot *previous = hasSent_ ? find(lastTick_) : nullptr;
+  baseline_tick = base ? ackedTick_ : -1;
+  // Everything sent after the baseline that is still in the ring
+  std::vector<const snapshot_state *> unacked;
+  if (hasSent_) {
+    const uint64_t first = base
+      ? ackedTick_ + 1
+      : lastTick_ + 1 - std::min<uint64_t>(lastTick_ + 1, history_.size());
+    for (uint64_t unacked_tick = first;
+         unacked_tick <= lastTick_;
+         unacked_tick++) {
+      const sent_snapshot *entry = find(unacked_tick);
+      if (entry) {
+        unacked.push_back(&entry->view);
+      }
+    }
+  }
+
+  sent_snapshot sent;
+  sent.tick = tick;
+  sent.t = t;
+  Json::Value ret = differ_.diff(
+      t,
+      objects,
+      base ? base->view : empty_state,
+      previous ? previous->t : 0.f,
+      previous ? &previous->view : nullptr,
+      unacked,
+      sent.view);
+
+  // Might overwrite base, which is why sent is built separately
+  sent_snapshot &slot = history_[tick % history_.size()];
+  slot.tick = sent.tick;
+  slot.t = sent.t;
+  slot.view.swap(sent.view);
+  hasSent_ = true;
+  lastTick_ = tick;
+  return ret;
+}
@@ -0,0 +1,116 @@
+#ifndef SRC_COMMON_SNAPSHOTDIFFER_H_
+#define SRC_COMMON_SNAPSHOTDIFFER_H_
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+// What a receiver knows about each field of each object: the value and the
+// time it was sent at.  id -> field -> state
+struct snapshot_field {
+  Json::Value value;
+  float t;
+};
+typedef std::map<std::string, std::map<std::string, snapshot_field>>
+  snapshot_state;
+
+// Turns full object states into per field keyframes, leaving out the fields
+// the receiver already has.
+//
+// Input is an object of id -> {field: value}, output is id -> {field:
+// [[t, value], ...]}.  Objects without changed fields are left out.
+// Objects the receiver has that are missing from the input get the removed
+// value (e.g. "alive": false), if one is set.
+//
+// Values are compared structurally.  Fields with a quantum ignore changes
+// to any number inside them smaller than the quantum, measured from the
+// receiver's value so slow drift is still sent eventually.  When a field
+// changes after being skipped, the receiver's value is repeated at the
+// previous time, so that interpolating receivers hold it until then.
+class SnapshotDiffer {
+ public:
+  SnapshotDiffer();
+
+  void setQuantum(const std::string &field, double quantum);
+  void setRemovedValue(const std::string &field, const Json::Value &value);
+
+  // Diffs against what the receiver has in baseline.  previous is what was
+  // last sent, at prev_t, and may be null.  unacked are the views of
+  // everything sent since baseline, which the receiver may or may not have
+  // applied, so fields that differ in any of them are sent even if they
+  // match baseline.  view is filled with what the receiver has after
+  // applying the result.
+  Json::Value diff(
+      float t,
+      const Json::Value &objects,
+      const snapshot_state &baseline,
+      float prev_t,
+      const snapshot_state *previous,
+      const std::vector<const snapshot_state *> &unacked,
+      snapshot_state &view) const;
+
+  // Diffs against the previous call, for a receiver that gets every diff.
+  Json::Value diff(float t, const Json::Value &objects);
+  // Forget all sent state, the next diff sends every field.
+  void reset();
+
+ private:
+  double getQuantum(const std::string &field) const;
+
+  std::map<std::string, double> quanta_;
+  std::string removedField_;
+  Json::Value removedValue_;
+
+  snapshot_state sent_;
+  bool hasLastT_;
+  float lastT_;
+};
+
+// Keeps what was sent to one receiver for the last few ticks, and encodes
+// each new snapshot as a diff from the newest one the receiver acknowledged.
+// Until the first ack, or if the acked tick is too old, every field is sent.
+class DeltaEncoder {
+ public:
+  DeltaEncoder(const SnapshotDiffer &differ, size_t history_size = 64);
+
+  // Returns the diff of objects for tick, and the tick it is relative to, or
+  // -1 for a full baseline.
+  Json::Value encode(
+      uint64_t tick,
+      float t,
+      const Json::Value &objects,
+      int64_t &baseline_tick);
+  // The receiver has applied the snapshot for tick.
+  void ack(uint64_t tick);
+  void reset();
+
+  int64_t getAckedTick() const {
+    return ackedTick_;
+  }
+
+ private:
+  struct sent_snapshot {
+    uint64_t tick;
+    float t;
+    snapshot_state view;
+  };
+
+  const sent_snapshot *find(uint64_t tick) const;
+
+  const SnapshotDiffer &differ_;
+  // Ring buffer, indexed by tick
+  std::vector<sent_snapshot> history_;
+  bool hasSent_;
+  uint64_t lastTick_;
+  int64_t ackedTick_;
+};
+
+// True if a and b are structurally equal, with numbers compared to within
+// quantum.
+bool json_values_close(
+    const Json::Value &a,
+    const Json::Value &b,
+    double quantum);
+
+#endif  // SRC_COMMON_SNAPSHOTDIFFER_H_
@@ -0,0 +1,127 @@
+#ifndef SRC_COMMON_SPATIALGRID_H_
+#define SRC_COMMON_SPATIALGRID_H_
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A loose grid over 2d bounds, for finding what overlaps a rect without
+// testing everything.  Each value is kept in the one cell its center falls
+// in, and queries look that much further out, so values are never split
+// across cells.  Centers outside the covered area go in the edge cells.
+//
+// Made to be rebuilt from scratch whenever the values move: reset, insert
+// everything, then build before querying.  Memory is kept between builds.
+template<typename T>
+class SpatialGrid {
+ public:
+  SpatialGrid()
+    : min_(0.f),
+      cellSize_(1.f),
+      dim_(1),
+      maxHalfSize_(0.f),
+      cellStart_(2, 0) {
+  }
+
+  // Empties the grid and sets the area it covers
+  void reset(const glm::vec2 &min, const glm::vec2 &max, float cell_size) {
+    min_ = min;
+    cellSize_ = cell_size;
+    dim_ = glm::max(
+        glm::ivec2(glm::ceil((max - min) / cell_size)),
+        glm::ivec2(1));
+    maxHalfSize_ = glm::vec2(0.f);
+    entries_.clear();
+    cells_.clear();
+    cellStart_.assign(dim_.x * dim_.y + 1, 0);
+  }
+
+  void insert(
+      const T &value,
+      const glm::vec2 &center,
+      const glm::vec2 &half_size) {
+    entry e;
+    e.value = value;
+    e.min = center - half_size;
+    e.max = center + half_size;
+    e.cell = cellIndex(center);
+    entries_.push_back(e);
+    maxHalfSize_ = glm::max(maxHalfSize_, half_size);
+  }
+
+  // Sorts the values inserted since reset into their cells
+  void build() {
+    std::fill(cellStart_.begin(), cellStart_.end(), 0);
+    for (const auto &e : entries_) {
+      cellStart_[e.cell + 1]++;
+    }
+    for (size_t i = 1; i < cellStart_.size(); i++) {
+      cellStart_[i] += cellStart_[i - 1];
+    }
+    cells_.resize(entries_.size());
+    // Fills each cell from its start, leaving cellStart_ one cell behind
+    for (const auto &e : entries_) {
+      cells_[cellStart_[e.cell]++] = e;
+    }
+    for (size_t i = cellStart_.size() - 1; i > 0; i--) {
+      cellStart_[i] = cellStart_[i - 1];
+    }
+    cellStart_[0] = 0;
+  }
+
+  // Calls f with each value whose bounds overlap the rect from min to max
+  template<class F>
+  void query(const glm::vec2 &min, const glm::vec2 &max, F f) const {
+    const glm::ivec2 lo = cellCoord(min - maxHalfSize_);
+    const glm::ivec2 hi = cellCoord(max + maxHalfSize_);
+    for (int y = lo.y; y <= hi.y; y++) {
+      const uint32_t end = cellStart_[y * dim_.x + hi.x + 1];
+      for (uint32_t i = cellStart_[y * dim_.x + lo.x]; i < end; i++) {
+        const entry &e = cells_[i];
+        if (e.min.x <= max.x && e.max.x >= min.x
+            && e.min.y <= max.y && e.max.y >= min.y) {
+          f(e.value);
+        }
+      }
+    }
+  }
+
+  size_t size() const {
+    return cells_.size();
+  }
+
+ private:
+  struct entry {
+    T value;
+    glm::vec2 min;
+    glm::vec2 max;
+    uint32_t cell;
+  };
+
+  // Clamped to the grid, in floats so that infinite points work
+  glm::ivec2 cellCoord(const glm::vec2 &p) const {
+    const glm::vec2 coord = glm::clamp(
+        glm::floor((p - min_) / cellSize_),
+        glm::vec2(0.f),
+        glm::vec2(dim_ - glm::ivec2(1)));
+    return glm::ivec2(coord);
+  }
+  uint32_t cellIndex(const glm::vec2 &p) const {
+    const glm::ivec2 coord = cellCoord(p);
+    return coord.y * dim_.x + coord.x;
+  }
+
+  glm::vec2 min_;
+  float cellSize_;
+  glm::ivec2 dim_;
+  // Largest half size inserted, how far a value can reach out of its cell
+  glm::vec2 maxHalfSize_;
+  // Values as inserted
+  std::vector<entry> entries_;
+  // Values sorted by cell, cell i is [cellStart_[i], cellStart_[i + 1])
+  std::vector<entry> cells_;
+  std::vector<uint32_t> cellStart_;
+};
+
+#endif  // SRC_COMMON_SPATIALGRID_H_
@@ -0,0 +1,44 @@
+#include "common/StringTable.h"
+#include "common/util.h"
+
+const std::string InternedString::empty_;
+
+InternedString::InternedString()
+  : str_(&empty_) {
+}
+
+uint32_t StringTable::intern(const std::string &str) {
+  auto it = ids_.find(str);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = strings_.size();
+  strings_.push_back(str);
+  ids_[str] = id;
+  return id;
+}
+
+void StringTable::define(uint32_t first, const Json::Value &strings) {
+  invariant(first <= size(), "string definitions must be contiguous");
+  for (Json::ArrayIndex i = size() - first; i < strings.size(); i++) {
+    strings_.push_back(strings[i].asString());
+    ids_.emplace(strings_.back(), size() - 1);
+  }
+}
+
+Json::Value StringTable::getDefinitions(uint32_t first) const {
+  Json::Value ret(Json::arrayValue);
+  for (uint32_t id = first; id < size(); id++) {
+    ret.append(strings_[id]);
+  }
+  return ret;
+}
+
+InternedString StringTable::get(uint32_t id) const {
+  invariant(id < size(), "unknown string id");
+  return InternedString(&strings_[id]);
+}
+
+InternedString StringTable::get(const Json::Value &id) const {
+  return get(id.asUInt());
+}
@@ -0,0 +1,75 @@
+#ifndef SRC_COMMON_STRINGTABLE_H_
+#define SRC_COMMON_STRINGTABLE_H_
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <json/json.h>
+
+// A string owned by a StringTable.  Copying is a pointer copy, and the
+// string lives as long as the table.  Default constructed handles are
+// empty.
+class InternedString {
+ public:
+  InternedString();
+
+  const std::string &str() const {
+    return *str_;
+  }
+  operator const std::string &() const {
+    return *str_;
+  }
+  bool empty() const {
+    return str_->empty();
+  }
+  void clear() {
+    str_ = &empty_;
+  }
+
+  bool operator==(const InternedString &rhs) const {
+    return str_ == rhs.str_ || *str_ == *rhs.str_;
+  }
+  bool operator!=(const InternedString &rhs) const {
+    return !(*this == rhs);
+  }
+
+ private:
+  friend class StringTable;
+  explicit InternedString(const std::string *str)
+    : str_(str) {
+  }
+
+  static const std::string empty_;
+  const std::string *str_;
+};
+
+// Session wide table of strings that are sent over and over, like names,
+// icons and tooltips.  The server interns each string once and sends ids,
+// and the definitions of new ids until the client has them.  Ids are
+// assigned in order, so what a client knows is always a prefix of the
+// table.
+class StringTable {
+ public:
+  // Returns the id of str, adding it if it is new.
+  uint32_t intern(const std::string &str);
+  // Defines the strings starting at id first, as sent by getDefinitions.
+  // Ids the table already has are skipped.
+  void define(uint32_t first, const Json::Value &strings);
+  // Returns ids [first, size()) for define.
+  Json::Value getDefinitions(uint32_t first) const;
+
+  // Returns the string with id, which must be defined.
+  InternedString get(uint32_t id) const;
+  InternedString get(const Json::Value &id) const;
+  // Number of strings in the table, also the next id.
+  uint32_t size() const {
+    return strings_.size();
+  }
+
+ private:
+  // Deque so handles stay valid as the table grows
+  std::deque<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> ids_;
+};
+
+#endif  // SRC_COMMON_STRINGTABLE_H_
@@ -0,0 +1,112 @@
+#include "common/Trace.h"
+#include <functional>
+#include <thread>
+#include "common/Exception.h"
+
+using std::chrono::duration_cast;
+
+Tracer *Tracer::get() {
+  static Tracer tracer;
+  return &tracer;
+}
+
+Tracer::Tracer()
+  : enabled_(false) {
+}
+
+void Tracer::open(const std::string &filename) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (file_.is_open()) {
+    file_.close();
+  }
+  file_.open(filename.c_str(), std::ios::out | std::ios::trunc);
+  if (!file_) {
+    throw file_exception("Unable to open trace file " + filename);
+  }
+  file_ << "[\n";
+  start_ = Clock::now();
+  enabled_ = true;
+}
+
+void Tracer::close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  enabled_ = false;
+  if (file_.is_open()) {
+    // Terminate the array with a metadata event so the file is valid json
+    file_ << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+      << "\"args\":{\"name\":\"rts\"}}]\n";
+    file_.close();
+  }
+}
+
+uint64_t Tracer::now() const {
+  return duration_cast<std::chrono::microseconds>(
+      Clock::now() - start_).count();
+}
+
+void Tracer::begin(const std::string &name, const char *category) {
+  if (!enabled_) {
+    return;
+  }
+  Json::Value event;
+  event["name"] = name;
+  event["cat"] = category;
+  event["ph"] = "B";
+  event["ts"] = (Json::UInt64)now();
+  writeEvent(event);
+}
+
+void Tracer::end(const char *category) {
+  if (!enabled_) {
+    return;
+  }
+  Json::Value event;
+  event["cat"] = category;
+  event["ph"] = "E";
+  event["ts"] = (Json::UInt64)now();
+  writeEvent(event);
+}
+
+void Tracer::complete(
+    const std::string &name,
+    const char *category,
+    uint64_t ts,
+    uint64_t duration,
+    const Json::Value &args) {
+  if (!enabled_) {
+    return;
+  }
+  Json::Value event;
+  event["name"] = name;
+  event["cat"] = category;
+  event["ph"] = "X";
+  event["ts"] = (Json::UInt64)ts;
+  event["dur"] = (Json::UInt64)duration;
+  if (!args.isNull()) {
+    event["args"] = args;
+  }
+  writeEvent(event);
+}
+
+void Tracer::writeEvent(Json::Value &event) {
+  static std::hash<std::thread::id> hasher;
+  event["pid"] = 1;
+  event["tid"] = (Json::UInt)hasher(std::this_thread::get_id());
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (file_.is_open()) {
+    // FastWriter terminates with a newline, put the comma before it
+    std::string line = writer_.write(event);
+    line.insert(line.size() - 1, ",");
+    file_ << line;
+  }
+}
+
+TraceSection::TraceSection(const std::string &name, const char *category)
+  : category_(category) {
+  Tracer::get()->begin(name, category);
+}
+
+TraceSection::~TraceSection() {
+  Tracer::get()->end(category_);
+}
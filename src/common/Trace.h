@@ -0,0 +1,62 @@
+#ifndef SRC_COMMON_TRACE_H_
+#define SRC_COMMON_TRACE_H_
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <json/json.h>
+#include "common/Clock.h"
+
+// Writes Chrome trace event files, viewable in chrome://tracing.
+// Events are written as they happen using the unterminated array format, so
+// a trace from a crashed process is still readable.
+class Tracer {
+ public:
+  static Tracer *get();
+
+  // Starts writing events to filename, replacing any previous trace.
+  void open(const std::string &filename);
+  void close();
+
+  bool isEnabled() const {
+    return enabled_;
+  }
+
+  // Microseconds since open, the trace timestamp unit.
+  uint64_t now() const;
+
+  // Begin/end pairs must be properly nested on each thread.
+  void begin(const std::string &name, const char *category);
+  void end(const char *category);
+  // Records an event with an explicit start time and duration.
+  void complete(
+      const std::string &name,
+      const char *category,
+      uint64_t ts,
+      uint64_t duration,
+      const Json::Value &args = Json::Value());
+
+ private:
+  Tracer();
+  void writeEvent(Json::Value &event);
+
+  std::atomic<bool> enabled_;
+  Clock::time_point start_;
+  std::mutex mutex_;
+  std::ofstream file_;
+  Json::FastWriter writer_;
+};
+
+// Object that records a trace span until it is destroyed
+class TraceSection {
+ public:
+  TraceSection(const std::string &name, const char *category);
+  ~TraceSection();
+ private:
+  TraceSection(const TraceSection &);
+
+  const char *category_;
+};
+
+#endif  // SRC_COMMON_TRACE_H_
@@ -0,0 +1,232 @@
+#include "common/UDPConnection.h"
+#include <algorithm>
+#include "common/Exception.h"
+#include "common/Logger.h"
+#include "common/Metrics.h"
+#include "common/Profiler.h"
+#include "common/util.h"
+
+// How long the net thread waits for datagrams before checking for resends
+static const double POLL_INTERVAL = 0.002;
+// Seconds without a packet from the peer before giving up
+static const double CONNECTION_TIMEOUT = 10.0;
+
+UDPConnection::UDPConnection(kissnet::udp_socket_ptr sock)
+  : sock_(sock),
+    connected_(sock->isConnected()),
+    running_(true),
+    start_(Clock::now()),
+    packetsLost_(0) {
+  sock_->setNonBlocking();
+
+  auto metrics = MetricsRegistry::get();
+  bytesSentCounter_ = metrics->counter(
+      "rts_net_bytes_sent_total",
+      "Bytes written to all connections, including framing");
+  bytesReceivedCounter_ = metrics->counter(
+      "rts_net_bytes_received_total",
+      "Bytes read from all connections, including framing");
+  packetsLostCounter_ = metrics->counter(
+      "rts_net_udp_packets_lost_total",
+      "UDP packets the peer did not ack");
+
+  netThread_ = std::thread(std::bind(&UDPConnection::netThreadFunc, this));
+}
+
+UDPConnection::~UDPConnection() {
+  stop();
+  netThread_.join();
+}
+
+void UDPConnection::stop() {
+  running_ = false;
+  condVar_.notify_all();
+}
+
+double UDPConnection::now() const {
+  return std::chrono::duration<double>(Clock::now() - start_).count();
+}
+
+void UDPConnection::setLinkSimulator(std::unique_ptr<LinkSimulator> link) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  link_ = std::move(link);
+}
+
+double UDPConnection::getRTT() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return endpoint_.getRTT();
+}
+
+size_t UDPConnection::getBytesSent() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return endpoint_.getBytesSent();
+}
+
+size_t UDPConnection::getBytesReceived() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return endpoint_.getBytesReceived();
+}
+
+void UDPConnection::sendPacket(const Json::Value &msg, NetChannel channel) {
+  record_section("sendPacket");
+  Json::FastWriter writer;
+  std::unique_lock<std::mutex> lock(mutex_);
+  endpoint_.send(channel, writer.write(msg));
+  flush(now());
+}
+
+void UDPConnection::flush(double t) {
+  if (!connected_) {
+    return;
+  }
+  std::string packet;
+  while (endpoint_.nextPacket(packet, t)) {
+    bytesSentCounter_->inc(packet.size());
+    if (link_) {
+      link_->push(packet, t);
+    } else {
+      sock_->send(packet);
+    }
+  }
+  if (link_) {
+    while (link_->pop(packet, t)) {
+      sock_->send(packet);
+    }
+  }
+}
+
+void UDPConnection::netThreadFunc() {
+  Json::Reader reader;
+  Json::FastWriter writer;
+  std::vector<char> buffer(1 << 16);
+  try {
+    while (running_) {
+      bool readable = sock_->waitReadable(POLL_INTERVAL);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      double t = now();
+      while (readable) {
+        kissnet::udp_address from;
+        int bytes_read = connected_
+          ? sock_->recv(&buffer[0], buffer.size())
+          : sock_->recvFrom(&buffer[0], buffer.size(), from);
+        if (bytes_read < 0) {
+          break;
+        }
+        std::string packet(&buffer[0], bytes_read);
+        if (!endpoint_.receivePacket(packet, t)) {
+          if (endpoint_.hasFailed()) {
+            running_ = false;
+            break;
+          }
+          continue;
+        }
+        bytesReceivedCounter_->inc(bytes_read);
+        if (!connected_) {
+          sock_->connect(from);
+          connected_ = true;
+        }
+      }
+
+      NetChannel channel;
+      std::string payload;
+      bool delivered = false;
+      while (endpoint_.receive(channel, payload)) {
+        if (isRawBatch(payload)) {
+          batches_.push_back(std::move(payload));
+          delivered = true;
+          continue;
+        }
+        record_section("parse packet");
+        Json::Value msg;
+        if (!reader.parse(payload, msg)) {
+          LOG(WARNING) << "Dropping unparseable message\n";
+          continue;
+        }
+        Json::Value reply;
+        if (handleTimeMessage(msg, reply)) {
+          if (!reply.isNull()) {
+            endpoint_.send(NET_CHANNEL_UNRELIABLE, writer.write(reply));
+          }
+          continue;
+        }
+        queue_.push_back(msg);
+        delivered = true;
+      }
+      if (delivered) {
+        condVar_.notify_all();
+      }
+      Json::Value ping;
+      if (connected_ && nextPing(ping)) {
+        endpoint_.send(NET_CHANNEL_UNRELIABLE, writer.write(ping));
+      }
+
+      flush(t);
+      packetsLostCounter_->inc(endpoint_.getPacketsLost() - packetsLost_);
+      packetsLost_ = endpoint_.getPacketsLost();
+
+      double last_receive = std::max(endpoint_.getLastReceiveTime(), 0.0);
+      if (t - last_receive > CONNECTION_TIMEOUT) {
+        LOG(WARNING) << "UDP connection timed out\n";
+        running_ = false;
+      }
+    }
+  } catch (kissnet::socket_exception &e) {
+    LOG(ERROR) << "Caught socket exception '" << e.what()
+      << "'... terminating thread.\n";
+    running_ = false;
+  }
+  condVar_.notify_all();
+}
+
+Json::Value UDPConnection::popQueue() {
+  if (!running_ && queue_.empty()) {
+    throw network_exception("network thread died");
+  }
+  invariant(!queue_.empty(), "queue shouldn't be empty");
+  Json::Value ret = queue_.front();
+  queue_.erase(queue_.begin());
+  return ret;
+}
+
+std::vector<Json::Value> UDPConnection::drainQueue() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<Json::Value> ret;
+  ret.swap(queue_);
+  return ret;
+}
+
+Json::Value UDPConnection::readNext() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condVar_.wait(lock, [this]() {return !running_ || !queue_.empty();});
+  return popQueue();
+}
+
+Json::Value UDPConnection::readNext(size_t millis) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool success = condVar_.wait_for(
+    lock,
+    std::chrono::milliseconds(millis),
+    [this]() {return !running_ || !queue_.empty();});
+  if (!success) {
+    throw timeout_exception();
+  }
+  return popQueue();
+}
+
+std::string UDPConnection::readNextBatch(size_t millis) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool success = condVar_.wait_for(
+    lock,
+    std::chrono::milliseconds(millis),
+    [this]() {return !running_ || !batches_.empty();});
+  if (!success) {
+    throw timeout_exception();
+  }
+  if (!running_ && batches_.empty()) {
+    throw network_exception("network thread died");
+  }
+  std::string ret = std::move(batches_.front());
+  batches_.pop_front();
+  return ret;
+}
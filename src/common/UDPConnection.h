@@ -0,0 +1,88 @@
+#ifndef SRC_COMMON_UDPCONNECTION_H_
+#define SRC_COMMON_UDPCONNECTION_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+#include "common/Clock.h"
+#include "common/Connection.h"
+#include "common/LinkSimulator.h"
+#include "common/NetChannel.h"
+#include "common/kissnet.h"
+
+class Counter;
+
+// Json messages over UDP, with reliable and sequenced channels, see
+// ChannelEndpoint.  A background thread receives datagrams, and sends acks,
+// resends and anything held back by pacing.  The connection stops if nothing
+// arrives for a while.
+class UDPConnection : public Connection {
+ public:
+  // sock must be bound.  If it is connected, packets go to that peer right
+  // away, otherwise the peer is whoever sends the first valid packet.
+  explicit UDPConnection(kissnet::udp_socket_ptr sock);
+  ~UDPConnection();
+
+  using Connection::sendPacket;
+  void sendPacket(const Json::Value &msg, NetChannel channel) override;
+
+  std::vector<Json::Value> drainQueue() override;
+  Json::Value readNext() override;
+  Json::Value readNext(size_t millis) override;
+  std::string readNextBatch(size_t millis) override;
+
+  size_t getBytesSent() override;
+  size_t getBytesReceived() override;
+
+  bool running() const override {
+    return running_;
+  }
+  void stop() override;
+
+  // Outgoing datagrams pass through link on their way to the socket, to test
+  // over impaired networks.  Its clock is seconds since the connection was
+  // created.  Null removes it.
+  void setLinkSimulator(std::unique_ptr<LinkSimulator> link);
+  // Smoothed round trip time, in seconds.
+  double getRTT();
+  kissnet::udp_socket_ptr getSocket() {
+    return sock_;
+  }
+
+ private:
+  void netThreadFunc();
+  // Seconds since the connection was created
+  double now() const;
+  // Sends whatever the endpoint and link have ready.  Requires mutex_.
+  void flush(double t);
+  Json::Value popQueue();
+
+  kissnet::udp_socket_ptr sock_;
+  bool connected_;
+  std::atomic<bool> running_;
+  const Clock::time_point start_;
+
+  // Guards everything below
+  std::mutex mutex_;
+  std::condition_variable condVar_;
+  ChannelEndpoint endpoint_;
+  std::unique_ptr<LinkSimulator> link_;
+  std::vector<Json::Value> queue_;
+  std::deque<std::string> batches_;
+  size_t packetsLost_;
+
+  Counter *bytesSentCounter_;
+  Counter *bytesReceivedCounter_;
+  Counter *packetsLostCounter_;
+
+  std::thread netThread_;
+};
+
+typedef std::shared_ptr<UDPConnection> UDPConnectionPtr;
+
+#endif  // SRC_COMMON_UDPCONNECTION_H_
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <cstring>  // for strerror
 #include <cstdlib>
+#include <cmath>
+#include <algorithm>
 #include <errno.h>
 #include <sstream>
 
@@ -346,6 +348,219 @@ void tcp_socket::fillAddr() const {
   portStr = ss.str();
 }
 
+// -----------------------------------------------------------------------------
+// udp definitions
+// -----------------------------------------------------------------------------
+static bool is_transient_udp_error(int err) {
+#ifdef _MSC_VER
+  return err == WSAEWOULDBLOCK || err == WSAECONNRESET || err == WSAENOBUFS;
+#else
+  return err == EAGAIN || err == EWOULDBLOCK || err == ECONNREFUSED
+    || err == ENOBUFS || err == EINTR;
+#endif
+}
+
+static int last_socket_error() {
+#ifdef _MSC_VER
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+static void sockaddr_to_strings(
+    const struct sockaddr_storage &addr,
+    std::string &host,
+    std::string &port) {
+  char ipstr[INET6_ADDRSTRLEN];
+  int portnum;
+  if (addr.ss_family == AF_INET) {
+    struct sockaddr_in *s = (struct sockaddr_in *)&addr;
+    portnum = ntohs(s->sin_port);
+    inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
+  } else {  // AF_INET6
+    struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
+    portnum = ntohs(s->sin6_port);
+    inet_ntop(AF_INET6, &s->sin6_addr, ipstr, sizeof ipstr);
+  }
+  host = ipstr;
+  std::stringstream ss;
+  ss << portnum;
+  port = ss.str();
+}
+
+std::string udp_address::getHostname() const {
+  invariant(!empty(), "empty udp address");
+  struct sockaddr_storage addr;
+  memcpy(&addr, raw_.data(), std::min(raw_.size(), sizeof(addr)));
+  std::string host, port;
+  sockaddr_to_strings(addr, host, port);
+  return host;
+}
+
+std::string udp_address::getPort() const {
+  invariant(!empty(), "empty udp address");
+  struct sockaddr_storage addr;
+  memcpy(&addr, raw_.data(), std::min(raw_.size(), sizeof(addr)));
+  std::string host, port;
+  sockaddr_to_strings(addr, host, port);
+  return port;
+}
+
+udp_socket_ptr udp_socket::create() {
+  udp_socket_ptr ret(new udp_socket());
+  return ret;
+}
+
+udp_socket::udp_socket() {
+  if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+    throw socket_exception("socket:", true);
+  }
+}
+
+udp_socket::~udp_socket() {
+  close();
+}
+
+void udp_socket::bind(const std::string &port) {
+  struct addrinfo *res = nullptr, hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  if (getaddrinfo(nullptr, port.c_str(), &hints, &res)) {
+    throw socket_exception("getaddrinfo");
+  }
+  int ret = ::bind(sock, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (ret < 0) {
+    throw socket_exception("Unable to bind", true);
+  }
+}
+
+void udp_socket::connect(const std::string &addr, const std::string &port) {
+  struct addrinfo *res = nullptr, hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  if (getaddrinfo(addr.c_str(), port.c_str(), &hints, &res)) {
+    throw socket_exception("unable to resolve address", true);
+  }
+  int ret = ::connect(sock, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (ret < 0) {
+    throw socket_exception("Unable to connect", true);
+  }
+}
+
+void udp_socket::connect(const udp_address &addr) {
+  invariant(!addr.empty(), "cannot connect to an empty address");
+  if (::connect(sock, (const struct sockaddr *)addr.raw_.data(),
+        addr.raw_.size()) < 0) {
+    throw socket_exception("Unable to connect", true);
+  }
+}
+
+bool udp_socket::isConnected() const {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  return getpeername(sock, (struct sockaddr *)&addr, &len) == 0;
+}
+
+udp_socket* udp_socket::setNonBlocking() {
+#ifdef _MSC_VER
+  unsigned long val = 1;
+  ioctlsocket(sock, FIONBIO, &val);
+#else
+  fcntl(sock, F_SETFL, O_NONBLOCK);
+#endif
+  return this;
+}
+
+void udp_socket::close() {
+#ifdef _MSC_VER
+  ::closesocket(sock);
+#else
+  ::close(sock);
+#endif
+}
+
+bool udp_socket::waitReadable(double timeout) {
+  double secs;
+  double partial_secs = modf(timeout, &secs);
+  struct timeval tv;
+  tv.tv_sec = (int) secs;
+  tv.tv_usec = 1e6 * partial_secs;
+
+  fd_set rset;
+  FD_ZERO(&rset);
+  FD_SET(sock, &rset);
+  int select_ret = ::select(sock + 1, &rset, nullptr, nullptr, &tv);
+  if (select_ret < 0) {
+    if (last_socket_error() == EINTR) {
+      return false;
+    }
+    throw socket_exception("error in select", true);
+  }
+  return select_ret > 0;
+}
+
+int udp_socket::send(const std::string &data) {
+  int bytes_sent = ::send(sock, data.c_str(), data.size(), 0);
+  if (bytes_sent < 0) {
+    if (is_transient_udp_error(last_socket_error())) {
+      return -1;
+    }
+    throw socket_exception("Unable to send", true);
+  }
+  return bytes_sent;
+}
+
+int udp_socket::recv(char *buffer, size_t buffer_len) {
+  int bytes_received = ::recv(sock, buffer, buffer_len, 0);
+  if (bytes_received < 0) {
+    if (is_transient_udp_error(last_socket_error())) {
+      return -1;
+    }
+    throw socket_exception("Unable to recv", true);
+  }
+  return bytes_received;
+}
+
+int udp_socket::recvFrom(
+    char *buffer,
+    size_t buffer_len,
+    udp_address &from) {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  int bytes_received = ::recvfrom(
+      sock, buffer, buffer_len, 0, (struct sockaddr *)&addr, &len);
+  if (bytes_received < 0) {
+    if (is_transient_udp_error(last_socket_error())) {
+      return -1;
+    }
+    throw socket_exception("Unable to recv", true);
+  }
+  from.raw_.assign((const char *)&addr, len);
+  return bytes_received;
+}
+
+std::string udp_socket::getLocalPort() const {
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  int ret = getsockname(sock, (struct sockaddr*)&addr, &len);
+  invariant(!ret, "unacceptable error getting local port");
+  std::stringstream ss;
+  ss << ntohs(((struct sockaddr_in*) &addr)->sin_port);
+  return ss.str();
+}
+
+int udp_socket::getSocket() const {
+  return sock;
+}
+
 // -----------------------------------------------------------------------------
 // socket_set definitions
 // -----------------------------------------------------------------------------
@@ -74,6 +74,61 @@ class tcp_socket {
   mutable std::string portStr;
 };
 
+// A peer address, as filled in by udp_socket::recvFrom.
+class udp_address {
+ public:
+  bool empty() const {
+    return raw_.empty();
+  }
+  std::string getHostname() const;
+  std::string getPort() const;
+
+  bool operator==(const udp_address &rhs) const {
+    return raw_ == rhs.raw_;
+  }
+
+ private:
+  friend class udp_socket;
+  // The raw sockaddr
+  std::string raw_;
+};
+
+class udp_socket;
+typedef std::shared_ptr<udp_socket> udp_socket_ptr;
+
+class udp_socket {
+ public:
+  static udp_socket_ptr create();
+
+  ~udp_socket();
+
+  // "0" binds any free port, see getLocalPort
+  void bind(const std::string &port);
+  // Only exchange datagrams with this peer, and allow send/recv
+  void connect(const std::string &addr, const std::string &port);
+  void connect(const udp_address &addr);
+  bool isConnected() const;
+  udp_socket* setNonBlocking();
+  void close();
+
+  // Returns false if nothing arrived within timeout seconds
+  bool waitReadable(double timeout);
+  // Datagrams are sent whole.  Returns -1 if the datagram was dropped
+  // locally (full buffers, or the peer's port is closed).
+  int send(const std::string &data);
+  // Returns -1 if no datagram is waiting on a nonblocking socket
+  int recv(char *buffer, size_t buffer_len);
+  int recvFrom(char *buffer, size_t buffer_len, udp_address &from);
+
+  std::string getLocalPort() const;
+  int getSocket() const;
+
+ private:
+  udp_socket();
+
+  int sock;
+};
+
 class socket_set {
  public:
   socket_set();
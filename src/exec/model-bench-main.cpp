@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <GL/glew.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "common/Clock.h"
+#include "common/Logger.h"
+#include "common/ParamReader.h"
+#include "rts/Graphics.h"
+#include "rts/ResourceManager.h"
+#include "rts/Shader.h"
+
+// Times the CPU side of drawing models, the way entities draw them.  Draws
+// a grid of --count copies of a model with the unit shader each frame, for
+// --frames frames.  Only issuing the draws is timed, the GPU is waited on
+// outside of it.  Runs headless on Mesa's software rasterizer with
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./model-bench melee_unit
+void usage(const char *name) {
+  fprintf(stderr,
+      "usage: %s model [--count n] [--frames n]\n",
+      name);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const std::string model_name = argv[1];
+  int count = 500;
+  int frames = 200;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--count") && i + 1 < argc) {
+      count = std::max(atoi(argv[++i]), 1);
+    } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+      frames = std::max(atoi(argv[++i]), 1);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ParamReader::get()->loadFile("config.json");
+  Logger::initLogger();
+  const glm::vec2 resolution = initEngine();
+
+  Model *model = ResourceManager::get()->getModel(model_name);
+  Shader *shader = ResourceManager::get()->getShader("unit");
+  const int side = static_cast<int>(ceil(sqrt(count)));
+  getProjectionStack().current() = glm::perspective(
+      60.f,
+      resolution.x / resolution.y,
+      0.1f,
+      100.f);
+  getViewStack().current() = glm::lookAt(
+      glm::vec3(0.f, -float(side), float(side)),
+      glm::vec3(0.f),
+      glm::vec3(0.f, 0.f, 1.f));
+  // As the Renderer sets them
+  setParam("renderer.light.ambient", glm::vec3(0.1f));
+  setParam("renderer.light.diffuse", glm::vec3(1.f));
+  setParam("renderer.light.specular", glm::vec3(1.f));
+  setParam("renderer.lightPos", glm::vec3(-5, -5, 10));
+
+  glEnable(GL_DEPTH_TEST);
+  float draw_seconds = 0.f;
+  for (int frame = 0; frame < frames; frame++) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    auto start = Clock::now();
+    shader->makeActive();
+    shader->uniform3f("baseColor", glm::vec3(0.5f));
+    for (int i = 0; i < count; i++) {
+      const glm::vec3 pos(i % side - side / 2.f, i / side - side / 2.f, 0.f);
+      renderModel(glm::translate(glm::mat4(1.f), pos), model, shader);
+    }
+    draw_seconds += Clock::secondsSince(start);
+    glFinish();
+    swapBuffers();
+  }
+
+  printf("%d draws per frame: %f ms per frame, %f us per draw\n",
+      count,
+      1000.f * draw_seconds / frames,
+      1e6f * draw_seconds / (frames * count));
+
+  teardownEngine();
+  return 0;
+}
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "common/Clock.h"
+#include "common/JsonCursor.h"
+#include "common/Logger.h"
+#include "common/ParamReader.h"
+#include "common/SnapshotDiffer.h"
+#include "common/StringTable.h"
+#include "rts/GameServer.h"
+#include "rts/Lobby.h"
+#include "rts/RenderSnapshot.h"
+#include "rts/Replay.h"
+
+// Times decoding the messages a client receives over a recorded game.  The
+// replay is re-simulated and each tick's messages are encoded for a client
+// that acks every render, as the server sends them.  Then all of them are
+// decoded, --repeat times, both by parsing into a Json::Value and then
+// decoding that, and with the streaming decoder the client uses.  Fails if
+// the two decode any render differently.
+void usage(const char *name) {
+  fprintf(stderr,
+      "usage: %s replayfile [--until tick] [--repeat n]\n",
+      name);
+}
+
+// Returns the entities decoded
+size_t decode_dom(const std::vector<std::string> &batches) {
+  StringTable strings;
+  Json::Reader reader;
+  size_t entities = 0;
+  for (const auto &batch : batches) {
+    Json::Value messages;
+    reader.parse(batch, messages);
+    for (const auto &message : messages) {
+      if (message["type"] == "render") {
+        rts::render_snapshot render;
+        rts::decode_render(message, strings, render);
+        entities += render.entities.size();
+      }
+    }
+  }
+  return entities;
+}
+
+size_t decode_streaming(const std::vector<std::string> &batches) {
+  StringTable strings;
+  size_t entities = 0;
+  for (const auto &batch : batches) {
+    JsonCursor cursor(batch);
+    cursor.beginArray();
+    while (cursor.nextElement()) {
+      rts::server_message message;
+      rts::decode_message(cursor, strings, message);
+      entities += message.render.entities.size();
+    }
+  }
+  return entities;
+}
+
+// Decodes batches both ways and returns the first field the decoders
+// disagree on, or "" if they agree on everything
+std::string compare_decoders(const std::vector<std::string> &batches) {
+  StringTable dom_strings;
+  StringTable streaming_strings;
+  Json::Reader reader;
+  for (size_t i = 0; i < batches.size(); i++) {
+    const std::string where = "batch " + std::to_string(i);
+    Json::Value messages;
+    reader.parse(batches[i], messages);
+    JsonCursor cursor(batches[i]);
+    cursor.beginArray();
+    for (const auto &message : messages) {
+      if (!cursor.nextElement()) {
+        return where + " message count";
+      }
+      rts::server_message streamed;
+      rts::decode_message(cursor, streaming_strings, streamed);
+      if (message["type"] != "render") {
+        continue;
+      }
+      rts::render_snapshot render;
+      rts::decode_render(message, dom_strings, render);
+      const std::string diff = rts::diff_render(render, streamed.render);
+      if (!diff.empty()) {
+        return where + " " + diff;
+      }
+    }
+  }
+  return "";
+}
+
+void report(
+    const char *name,
+    float seconds,
+    size_t runs,
+    size_t batches,
+    size_t bytes) {
+  printf("%-10s %f ms per batch, %f MB/s\n",
+      name,
+      1000.f * seconds / (runs * batches),
+      runs * bytes / (seconds * 1024 * 1024));
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *replay_file = argv[1];
+  size_t until_tick = 0;
+  size_t repeat = 5;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--until") && i + 1 < argc) {
+      until_tick = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      repeat = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ParamReader::get()->loadFile("config.json");
+  Logger::initLogger();
+
+  rts::ReplayReader replay(replay_file);
+  const float dt = replay.getSimDT();
+  size_t end_tick = replay.getTickCount();
+  if (until_tick && until_tick < end_tick) {
+    end_tick = until_tick;
+  }
+
+  rts::GameServer server;
+  server.start(replay.getGameDef(), replay.getSeed());
+  SnapshotDiffer differ;
+  rts::configure_entity_differ(differ);
+  DeltaEncoder encoder(differ);
+  StringTable strings;
+  uint32_t known_strings = 0;
+
+  Json::FastWriter writer;
+  std::vector<std::string> batches;
+  size_t bytes = 0;
+  for (size_t tick = 0; tick < end_tick && server.isRunning(); tick++) {
+    for (const auto &action : replay.getActions(tick)) {
+      server.addAction(action);
+    }
+    auto render = server.update(dt);
+    rts::intern_render_strings(render, strings);
+    auto client_render = rts::encode_render(
+        render,
+        encoder,
+        strings,
+        known_strings);
+    // The client has everything once it acks
+    known_strings = strings.size();
+    for (const auto &message : client_render) {
+      if (message.isMember("tick")) {
+        encoder.ack(toTick(message["tick"]));
+      }
+    }
+    batches.push_back(writer.write(client_render));
+    bytes += batches.back().size();
+  }
+  printf("recorded %zu batches, %zu bytes\n", batches.size(), bytes);
+  if (batches.empty()) {
+    return 0;
+  }
+
+  auto start = Clock::now();
+  size_t dom_entities = 0;
+  for (size_t i = 0; i < repeat; i++) {
+    dom_entities = decode_dom(batches);
+  }
+  report("dom", Clock::secondsSince(start), repeat, batches.size(), bytes);
+
+  start = Clock::now();
+  size_t streaming_entities = 0;
+  for (size_t i = 0; i < repeat; i++) {
+    streaming_entities = decode_streaming(batches);
+  }
+  report(
+      "streaming",
+      Clock::secondsSince(start),
+      repeat,
+      batches.size(),
+      bytes);
+
+  const std::string diff = compare_decoders(batches);
+  if (dom_entities != streaming_entities || !diff.empty()) {
+    printf("decoders disagree: %zu vs %zu entity renders, %s\n",
+        dom_entities, streaming_entities, diff.c_str());
+    return 1;
+  }
+  printf("decoders agree on %zu entity renders\n", dom_entities);
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "common/Clock.h"
+#include "common/Logger.h"
+#include "common/ParamReader.h"
+#include "common/Trace.h"
+#include "rts/GameServer.h"
+#include "rts/Replay.h"
+
+// Re-simulates a recorded game as fast as possible.  Ticks before --seek are
+// fast forwarded without being measured, ticks after are timed and
+// summarized.  With --timing each measured tick is printed as well, which is
+// useful for finding the spikes in a real game.  --trace writes a
+// chrome://tracing file of the measured ticks, and --profile-slow adds sampled
+// js stacks for ticks slower than the given number of milliseconds.
+void usage(const char *name) {
+  fprintf(stderr,
+      "usage: %s replayfile [--seek tick] [--until tick] [--timing]\n"
+      "  [--trace tracefile] [--profile-slow ms]\n",
+      name);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *replay_file = argv[1];
+  size_t seek_tick = 0;
+  size_t until_tick = 0;
+  bool print_ticks = false;
+  const char *trace_file = nullptr;
+  float profile_threshold = 0.f;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--seek") && i + 1 < argc) {
+      seek_tick = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--until") && i + 1 < argc) {
+      until_tick = strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--timing")) {
+      print_ticks = true;
+    } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (!strcmp(argv[i], "--profile-slow") && i + 1 < argc) {
+      profile_threshold = strtod(argv[++i], nullptr) / 1000.f;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ParamReader::get()->loadFile("config.json");
+  Logger::initLogger();
+
+  rts::ReplayReader replay(replay_file);
+  if (!replay.isComplete()) {
+    fprintf(stderr, "warning: replay has no footer, it may be truncated\n");
+  }
+  const float dt = replay.getSimDT();
+  size_t end_tick = replay.getTickCount();
+  if (until_tick && until_tick < end_tick) {
+    end_tick = until_tick;
+  }
+
+  rts::GameServer server;
+  server.start(replay.getGameDef(), replay.getSeed());
+
+  auto start = Clock::now();
+  std::vector<float> tick_times;
+  size_t tick = 0;
+  for ( ; tick < end_tick && server.isRunning(); tick++) {
+    for (const auto &action : replay.getActions(tick)) {
+      server.addAction(action);
+    }
+
+    if (tick < seek_tick) {
+      server.update(dt);
+      continue;
+    }
+    if (tick == seek_tick) {
+      if (seek_tick) {
+        printf("fast forwarded %zu ticks in %f s\n",
+            seek_tick, Clock::secondsSince(start));
+      }
+      if (trace_file) {
+        Tracer::get()->open(trace_file);
+        server.setSlowTickProfiling(profile_threshold);
+      }
+    }
+
+    auto tick_start = Clock::now();
+    server.update(dt);
+    float tick_time = Clock::secondsSince(tick_start);
+    tick_times.push_back(tick_time);
+    if (print_ticks) {
+      printf("tick %zu: %f ms\n", tick, 1000.f * tick_time);
+    }
+  }
+  float total = Clock::secondsSince(start);
+  Tracer::get()->close();
+
+  if (tick < end_tick) {
+    printf("game ended early at tick %zu of %zu\n", tick, end_tick);
+  }
+  printf("simulated %zu ticks (%f game seconds) in %f s\n",
+      tick, tick * dt, total);
+  if (tick_times.empty()) {
+    return 0;
+  }
+
+  float sum = 0.f;
+  for (auto t : tick_times) {
+    sum += t;
+  }
+  auto max_it = std::max_element(tick_times.begin(), tick_times.end());
+  size_t max_tick = seek_tick + (max_it - tick_times.begin());
+  float max_time = *max_it;
+  std::sort(tick_times.begin(), tick_times.end());
+  float p99 = tick_times[(tick_times.size() - 1) * 99 / 100];
+  printf("measured %zu ticks: mean %f ms, p99 %f ms, max %f ms (tick %zu)\n",
+      tick_times.size(),
+      1000.f * sum / tick_times.size(),
+      1000.f * p99,
+      1000.f * max_time,
+      max_tick);
+  printf("budget per tick: %f ms\n", 1000.f * dt);
+
+  return 0;
+}
@@ -11,6 +11,7 @@
 #include "common/kissnet.h"
 #include "common/Logger.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
 #include "common/NetConnection.h"
 #include "common/util.h"
 #include "rts/Controller.h"
@@ -145,6 +146,9 @@ int main(int argc, char **argv) {
   if (!initLibs()) {
     exit(1);
   }
+  if (hasParam("local.debug.profile") && intParam("local.debug.profile")) {
+    Profiler::get()->start();
+  }
 
   // Initialize Engine
   Renderer::get();
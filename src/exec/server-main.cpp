@@ -2,11 +2,15 @@
 #include "common/kissnet.h"
 #include "common/Logger.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
 
 int main(int argc, char **argv) {
   ParamReader::get()->loadFile("config.json");
   kissnet::init_networking();
   Logger::initLogger();
+  if (hasParam("local.debug.profile") && intParam("local.debug.profile")) {
+    Profiler::get()->start();
+  }
 
   // Defaults
   int num_players = 2;
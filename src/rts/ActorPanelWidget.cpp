@@ -93,7 +93,7 @@ bool ActorPanelWidget::handleClick(const glm::vec2 &pos, int button) {
   }
 
   const auto t = Renderer::get()->getGameTime();
-  auto ui_info = actor->getUIInfo(t);
+  const auto &ui_info = actor->getUIInfo(t);
   for (int i = 0; i < partWidgets_.size() && i < ui_info.parts.size(); i++) {
     auto *widget = partWidgets_[i];
     if (pointInBox(pos, widget->getCenter(), widget->getSize(), 0.f)) {
@@ -145,7 +145,7 @@ void ActorPanelWidget::render(float dt) {
     return;
   }
   const auto t = Renderer::get()->getGameTime();
-  auto ui_info = actor->getUIInfo(t);
+  const auto &ui_info = actor->getUIInfo(t);
 
   // Background
   drawRectCenter(center_, size_, bgcolor_);
@@ -163,7 +163,7 @@ void ActorPanelWidget::render(float dt) {
     center_.y + size_.y / 2.f - health_height / 2.f);
   glm::vec2 bar_size(size_.x, health_height);
   std::tuple<std::string, glm::vec2> bars[] = {
-    make_tuple(std::string(".mana"), ui_info.mana),
+    make_tuple(std::string(".mana"), actor->getMana(t)),
     make_tuple(std::string(".health"), total_health),
   };
 
@@ -187,7 +187,7 @@ void ActorPanelWidget::update(const glm::vec2 &pos, int buttons) {
     return;
   }
   const auto t = Renderer::get()->getGameTime();
-  auto ui_info = actor->getUIInfo(t);
+  const auto &ui_info = actor->getUIInfo(t);
   auto nparts = ui_info.parts.size();
   invariant(nparts <= partWidgets_.size(), "too many parts to render");
 
@@ -1,40 +1,76 @@
 #ifndef SRC_RTS_CURVES_H_
 #define SRC_RTS_CURVES_H_
 #include <glm/glm.hpp>
-#include <vector>
+#include <algorithm>
 #include "common/Logger.h"
-#include "rts/Renderer.h"
+#include "common/RenderClock.h"
+#include "common/RingBuffer.h"
+#include "common/util.h"
 
 namespace rts {
 
+// Seconds of history a curve keeps behind its newest sample.  Rendering
+// trails the newest snapshot by at most the render delay, and resyncing can
+// move the render clock back by about as much again.
+const float CURVE_RETENTION = 2.f * MAX_RENDER_DELAY;
+// Most samples a curve holds, however close together they are
+const size_t CURVE_MAX_SAMPLES = 256;
+
 template<typename T>
 struct curve_sample {
   curve_sample(float tt, const T& vval) : t(tt), val(vval) { }
   float t;
   T val;
 
-  T interpolateFrom(float interpt, const curve_sample<T> &s0) {
+  T interpolateFrom(float interpt, const curve_sample<T> &s0) const {
     float u = (interpt - s0.t) / (t - s0.t);
     T ret = val * u + s0.val * (1.f - u);
     return ret;
   }
 };
 
+// Samples of a value over game time.  Only the last retention seconds are
+// kept, up to max_samples, so sampling before that gives the oldest value
+// kept.
 template<typename T>
 class Curve {
 public:
-  Curve(const T &start);
+  explicit Curve(
+      const T &start,
+      float retention = CURVE_RETENTION,
+      size_t max_samples = CURVE_MAX_SAMPLES);
+  // Replaces any samples after t
   void addKeyframe(float t, const T &val);
+  // Forgets all samples, keeping their memory
+  void reset(const T &start);
 
   T linearSample(float t) const;
-  T stepSample(float t) const;
+  // Like linearSample, but past horizon, the newest time there is data
+  // for, keeps going along the last segment for at most limit seconds, if
+  // that segment ends at horizon.  Curves that end before horizon hold
+  // their value.
+  T extrapolatedSample(float t, float horizon, float limit) const;
+  const T &stepSample(float t) const;
 
   const curve_sample<T>& back() const {
     return data_.back();
   }
-  
+  size_t size() const {
+    return data_.size();
+  }
+  // Samples there is memory for
+  size_t capacity() const {
+    return data_.capacity();
+  }
+
 private:
-  std::vector<curve_sample<T>> data_;
+  // Index of the first sample after t, or size()
+  size_t upperBound(float t) const;
+
+  float retention_;
+  RingBuffer<curve_sample<T>> data_;
+  // Whether the first sample is the starting value rather than data
+  bool hasStart_;
 };
 
 typedef Curve<float> FloatCurve;
@@ -42,54 +78,82 @@ typedef Curve<glm::vec2> Vec2Curve;
 typedef Curve<glm::vec3> Vec3Curve;
 
 template<typename T>
-Curve<T>::Curve(const T &start) {
-  addKeyframe(0, start);
+Curve<T>::Curve(const T &start, float retention, size_t max_samples)
+  : retention_(retention),
+    data_(max_samples),
+    hasStart_(true) {
+  data_.push_back(curve_sample<T>(0, start));
+}
+
+template<typename T>
+void Curve<T>::reset(const T &start) {
+  data_.clear();
+  data_.push_back(curve_sample<T>(0, start));
+  hasStart_ = true;
 }
 
 template<typename T>
 void Curve<T>::addKeyframe(float t, const T &val) {
   invariant(t >= 0, "only non-negative times allowed");
-  for (int i = data_.size() - 1; i >= 0; i--) {
-    if (data_[i].t > t) {
-      data_.resize(i, curve_sample<T>(0, T()));
-      break;
+  data_.truncate(upperBound(t));
+  if (data_.size() == data_.maxSize()) {
+    hasStart_ = false;
+  }
+  data_.push_back(curve_sample<T>(t, val));
+  // Keep one sample at or before the cutoff to interpolate from
+  const float cutoff = t - retention_;
+  while (data_.size() > 1 && data_[1].t <= cutoff) {
+    data_.pop_front();
+    hasStart_ = false;
+  }
+}
+
+template<typename T>
+size_t Curve<T>::upperBound(float t) const {
+  size_t lo = 0;
+  size_t hi = data_.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (t < data_[mid].t) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
     }
   }
-  data_.emplace_back(t, val);
+  return lo;
 }
 
 template<typename T>
 T Curve<T>::linearSample(float t) const {
-  invariant(t >= 0, "only non-negative times allowed");
   if (t >= data_.back().t) {
     return data_.back().val;
   }
-  // need two samples at t0 and t1 such that t0 < t < t1
-  // find index of sample t1
-  size_t i = 1;
-  for (; i < data_.size(); i++) {
-    if (t < data_[i].t) {
-      break;
-    }
+  // need two samples at t0 and t1 such that t0 <= t < t1
+  size_t i = upperBound(t);
+  if (i == 0) {
+    return data_.front().val;
   }
-  // samples are now t0 @ (i-1), t @ (i)
-  auto s0 = data_[i - 1];
-  auto s1 = data_[i];
-  return s1.interpolateFrom(t, s0);
+  return data_[i].interpolateFrom(t, data_[i - 1]);
 }
 
 template<typename T>
-T Curve<T>::stepSample(float t) const {
-  invariant(t >= 0, "only non-negative times allowed");
-  // need two samples at t0 and t1 such that t0 < t < t1
-  // find index of sample t1
-  size_t i = 1;
-  for (; i < data_.size(); i++) {
-    if (t < data_[i].t) {
-      break;
-    }
+T Curve<T>::extrapolatedSample(float t, float horizon, float limit) const {
+  const auto &s1 = data_.back();
+  const size_t samples = data_.size() - (hasStart_ ? 1 : 0);
+  if (t <= horizon || s1.t < horizon || samples < 2) {
+    return linearSample(t);
+  }
+  const auto &s0 = data_[data_.size() - 2];
+  if (s0.t >= s1.t) {
+    return s1.val;
   }
-  return data_[i-1].val;
+  return s1.interpolateFrom(std::min(t, horizon + limit), s0);
+}
+
+template<typename T>
+const T &Curve<T>::stepSample(float t) const {
+  size_t i = upperBound(t);
+  return data_[i == 0 ? 0 : i - 1].val;
 }
 }; // rts
 
@@ -126,7 +126,7 @@ Effect * makeOnDamageEffect(
     Renderer::get()->getEffectManager()->addEffect(
         makeCannedParticleEffect("effects.teleport", start, end, glm::vec3(0.f)));
   } else if (name == "snipe") {
-    auto eid = must_have_idx(params, "eid").asString();
+    auto eid = toID(must_have_idx(params, "eid"));
     auto *entity = Game::get()->getEntity(eid);
     if (!entity) {
       return;
@@ -146,12 +146,15 @@ Effect * makeOnDamageEffect(
           shot_pos,
           glm::normalize(shot_pos - pos)));
   } else if (name == "heal_target") {
-    auto eid = must_have_idx(params, "eid").asString();
+    auto eid = toID(must_have_idx(params, "eid"));
     auto *entity = Game::get()->getEntity(eid);
+    if (!entity) {
+      return;
+    }
 		entity->addExtraEffect(
         makeTextureBelowEffect(entity, 3.5f, "heal_icon", 2.f));
   } else if (name == "on_damage") {
-    auto eid = params["eid"].asString();
+    auto eid = toID(params["eid"]);
     auto *entity = Game::get()->getEntity(eid);
     if (!entity) {
       return;
@@ -59,6 +59,11 @@ Effect *makeParticleEffect(
     Renderer::get()->getRenderTime(),
     [=](float t) -> void {
       auto particle = particle_func(t);
+      if (!Renderer::get()->getFrustum().intersectsSphere(
+            particle.pos,
+            glm::length(particle.size))) {
+        return;
+      }
 
       glm::mat4 transform(1.f);
       if (particle.billboard_type == ParticleInfo::SPHERICAL) {
@@ -1,6 +1,8 @@
 #include "rts/Game.h"
 #include <algorithm>
+#include <limits>
 #include <sstream>
+#include <thread>
 #include "common/ParamReader.h"
 #include "common/util.h"
 #include "rts/GameEntity.h"
@@ -12,11 +14,21 @@ namespace rts {
 
 Game* Game::instance_ = nullptr;
 
+// Longest wait for messages before checking whether the game is over
+static const size_t MAX_READ_WAIT_MILLIS = 100;
+// Decoded messages waiting for the render thread
+static const size_t MAX_QUEUED_UPDATES = 256;
+// Most held renders applied in one frame
+static const size_t MAX_RENDERS_PER_FRAME = 8;
+// Most removed entities kept for reuse
+static const size_t MAX_POOLED_ENTITIES = 256;
+
 Game::Game(Map *map, const std::vector<Player *> &players, RenderProvider render_provider, ActionFunc action_func)
   : map_(map),
     players_(players),
     renderProvider_(render_provider),
     actionFunc_(action_func),
+    updates_(MAX_QUEUED_UPDATES),
     running_(false),
     elapsedTime_(0.f) {
   std::set<int> team_ids;
@@ -44,219 +56,201 @@ Game::Game(Map *map, const std::vector<Player *> &players, RenderProvider render
 }
 
 Game::~Game() {
+  for (auto *entity : entityPool_) {
+    delete entity;
+  }
   delete map_;
   instance_ = nullptr;
 
 }
   
-UIAction UIActionFromJSON(const Json::Value &v) {
-  UIAction uiaction;
-  uiaction.name = must_have_idx(v, "name").asString();
-  uiaction.icon = must_have_idx(v, "icon").asString();
-  auto&& hotkey_str = must_have_idx(v, "hotkey").asString();
-  uiaction.hotkey = !hotkey_str.empty() ? hotkey_str[0] : '\0';
-  uiaction.tooltip = must_have_idx(v, "tooltip").asString();
-  uiaction.targeting = static_cast<UIAction::TargetingType>(
-      must_have_idx(v, "targeting").asInt());
-  uiaction.range = must_have_idx(v, "range").asFloat();
-  uiaction.radius = must_have_idx(v, "radius").asFloat();
-  uiaction.state = static_cast<UIAction::ActionState>(
-      must_have_idx(v, "state").asInt());
-  uiaction.cooldown = must_have_idx(v, "cooldown").asFloat();
-
-  return uiaction;
-}
+void Game::handleRender(std::unique_ptr<game_update> update) {
+  double server_time;
+  update->has_server_time = serverClock_ && serverClock_(server_time);
+  update->server_time = update->has_server_time ? server_time : 0.0;
 
-GameEntity::UIPart UIPartFromJSON(const Json::Value &v) {
-  GameEntity::UIPart ret;
-  ret.health = toVec2(must_have_idx(v, "health"));
-  ret.name = must_have_idx(v, "name").asString();
-  ret.tooltip = must_have_idx(v, "tooltip").asString();
-  for (auto &&json_upgrade : must_have_idx(v, "upgrades")) {
-    GameEntity::UIPartUpgrade upgrade;
-    upgrade.name = must_have_idx(json_upgrade, "name").asString();
-    upgrade.part = ret.name;
-    ret.upgrades.push_back(upgrade);
-  }
-  return ret;
+  // The server sends later renders as changes from this one
+  const Json::Value &tick = update->message.tick;
+  if (!tick.isNull()) {
+    Json::Value ack;
+    ack["type"] = "ack";
+    ack["tick"] = tick;
+    ack["strings"] = strings_.size();
+    actionFunc_(ack);
+  }
+  publish(std::move(update));
 }
 
-GameEntity::UIInfo UIInfoFromJSON(const Json::Value &v) {
-  GameEntity::UIInfo ret;
-  if (v.isMember("minimap_icon")) {
-    ret.minimap_icon = v["minimap_icon"].asString();
-  }
-  if (v.isMember("mana")) {
-    ret.mana = toVec2(v["mana"]);
-  }
-  if (v.isMember("retreat")) {
-    ret.retreat = v["retreat"].asBool();
-  }
-  if (v.isMember("capture")) {
-    ret.capture = toVec2(v["capture"]);
-  }
-  if (v.isMember("capture_pid")) {
-    ret.capture_pid = toID(v["capture_pid"]);
-  }
-  if (v.isMember("path")) {
-    for (auto &&pt : v["path"]) {
-      ret.path.push_back(glm::vec3(toVec2(pt), 0.));
-    }
+void Game::publish(std::unique_ptr<game_update> update) {
+  // The render thread drains the queue every frame, so it is only full if
+  // rendering stalls
+  while (!updates_.push(update) && running_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
-  if (v.isMember("parts")) {
-    for (auto &&json_part : v["parts"]) {
-      ret.parts.push_back(UIPartFromJSON(json_part));
-    }
-  }
-  if (v.isMember("hotkey")) {
-    auto&& hotkeystr = v["hotkey"].asString();
-    ret.hotkey = hotkeystr.empty() ? '\0' : hotkeystr[0];
-  }
-  if (v.isMember("extra")) {
-    ret.extra = v["extra"];
-  }
-  return ret;
 }
 
-void renderEntityFromJSON(GameEntity *e, const Json::Value &v) {
+// Sets the sampled fields on e, taking the samples
+static void apply_entity_snapshot(GameEntity *e, entity_snapshot &snapshot) {
   invariant(e, "must have entity to render to");
-  if (v.isMember("alive")) {
-    for (auto &sample : v["alive"]) {
-      e->setAlive(sample[0].asFloat(), sample[1].asBool());
-    }
+  for (auto &sample : snapshot.alive) {
+    e->setAlive(sample.first, sample.second);
   }
-  if (v.isMember("model")) {
-    for (auto &sample : v["model"]) {
-      e->setModelName(sample[1].asString());
-    }
+  for (auto &sample : snapshot.model) {
+    e->setModelName(std::move(sample.second));
   }
-  if (v.isMember("properties")) {
-    for (auto &sample : v["properties"]) {
-      for (auto &prop : sample[1]) {
-        e->addProperty(prop.asInt());
-      }
-    }
+  e->addProperties(snapshot.properties);
+  for (auto &sample : snapshot.pid) {
+    e->setPlayerID(sample.first, sample.second);
   }
-  if (v.isMember("pid")) {
-    for (auto &sample : v["pid"]) {
-      e->setPlayerID(sample[0].asFloat(), toID(sample[1]));
-    }
+  for (auto &sample : snapshot.tid) {
+    e->setTeamID(sample.first, sample.second);
   }
-  if (v.isMember("tid")) {
-    for (auto &sample : v["tid"]) {
-      e->setTeamID(sample[0].asFloat(), toID(sample[1]));
-    }
+  for (auto &sample : snapshot.pos) {
+    e->setPosition(sample.first, sample.second);
   }
-  if (v.isMember("pos")) {
-    for (auto &sample : v["pos"]) {
-      e->setPosition(sample[0].asFloat(), toVec2(sample[1]));
-    }
+  for (auto &sample : snapshot.size) {
+    e->setSize(sample.first, sample.second);
   }
-  if (v.isMember("size")) {
-    for (auto &sample : v["size"]) {
-      e->setSize(sample[0].asFloat(), toVec3(sample[1]));
-    }
+  for (auto &sample : snapshot.angle) {
+    e->setAngle(sample.first, sample.second);
   }
-  if (v.isMember("angle")) {
-    for (auto &sample : v["angle"]) {
-      e->setAngle(sample[0].asFloat(), sample[1].asFloat());
-    }
+  for (auto &sample : snapshot.sight) {
+    e->setSight(sample.first, sample.second);
   }
-  if (v.isMember("sight")) {
-    for (auto &sample : v["sight"]) {
-      e->setSight(sample[0].asFloat(), sample[1].asFloat());
-    }
+  for (auto &sample : snapshot.speed) {
+    e->setSpeed(sample.first, sample.second);
   }
-  if (v.isMember("visible")) {
-    for (auto &sample : v["visible"]) {
-      float t = sample[0].asFloat();
-      VisibilitySet set;
-      for (auto pid : sample[1]) {
-        set.insert(toID(pid));
-      }
-      e->setVisibilitySet(t, set);
-    }
+  for (auto &sample : snapshot.visible) {
+    e->setVisibilitySet(sample.first, sample.second);
   }
-  if (v.isMember("actions")) {
-    for (auto &sample : v["actions"]) {
-      float t = sample[0].asFloat();
-
-      std::vector<UIAction> actions;
-      for (auto &action_json : sample[1]) {
-        auto uiaction = UIActionFromJSON(action_json);
-        uiaction.owner_id = e->getGameID();
-        actions.push_back(uiaction);
-      }
-      if (!actions.empty()) {
-        e->setActions(t, actions);
-      }
+  for (auto &sample : snapshot.actions) {
+    if (!sample.second.empty()) {
+      e->setActions(sample.first, sample.second);
     }
   }
-  if (v.isMember("ui_info")) {
-    for (auto &&sample : v["ui_info"]) {
-      const float t = sample[0].asFloat();
-      GameEntity::UIInfo uiinfo = UIInfoFromJSON(sample[1]);
-      e->setUIInfo(t, uiinfo);
-    }
+  for (auto &sample : snapshot.ui_info) {
+    e->setUIInfo(sample.first, std::move(sample.second));
   }
 }
 
-void Game::handleRenderMessage(const Json::Value &v) {
-  auto entities = must_have_idx(v, "entities");
-  invariant(entities.isObject(), "should have entities array");
-  auto entity_keys = entities.getMemberNames();
-  for (auto &eid : entity_keys) {
-    // find or create GameEntity corresponding to the
-    auto it = game_to_render_id.find(eid);
-    GameEntity *entity = nullptr;
-    if (it == game_to_render_id.end()) {
-      id_t new_id = Renderer::get()->newEntityID();
-      auto game_entity = new GameEntity(new_id);
-      game_entity->setGameID(eid);
-      Renderer::get()->spawnEntity(game_entity);
-      game_to_render_id[eid] = new_id;
-      entity = game_entity;
+void Game::applyRender(render_snapshot &render) {
+  for (auto &entity_render : render.entities) {
+    auto *entity = spawnEntity(entity_render.game_id);
+    apply_entity_snapshot(entity, entity_render);
+    const float death_t = entity->getDeathTime();
+    if (death_t != std::numeric_limits<float>::infinity()) {
+      deadEntities_[entity_render.game_id] = death_t;
     } else {
-      entity = GameEntity::cast(Renderer::get()->getEntity(it->second));
+      deadEntities_.erase(entity_render.game_id);
     }
-    renderEntityFromJSON(entity, entities[eid]);
   }
 
-  auto events = must_have_idx(v, "events");
-  invariant(events.isArray(), "events must be array");
-  for (auto&& event : events) {
+  for (auto&& event : render.events) {
     add_effect(
         must_have_idx(event, "name").asString(),
         must_have_idx(event, "params"));
   }
 
-  auto players = must_have_idx(v, "players");
-  invariant(players.isArray(), "players must be array");
-  for (int i = 0; i < players.size(); i++) {
-    auto player = players[i];
-    id_t pid = toID(must_have_idx(player, "pid"));
-    requisition_[pid] = must_have_idx(player, "req").asFloat();
-    power_[pid] = must_have_idx(player, "power").asFloat();
+  for (auto &player : render.players) {
+    requisition_[player.pid] = player.requisition;
+    power_[player.pid] = player.power;
+  }
+  for (auto &team : render.teams) {
+    victoryPoints_[team.tid] = team.victory_points;
   }
 
-  auto teams = must_have_idx(v, "teams");
-  for (int i = 0; i < teams.size(); i++) {
-    auto team = teams[i];
-    id_t tid = toID(must_have_idx(team, "tid"));
-    victoryPoints_[tid] = must_have_idx(team, "vps").asFloat();
+  handleChats(render.chats);
+  Renderer::get()->setSnapshotHorizon(render.t);
+}
+
+GameEntity * Game::spawnEntity(id_t game_id) {
+  auto it = game_to_render_id.find(game_id);
+  if (it != game_to_render_id.end()) {
+    return GameEntity::cast(Renderer::get()->getEntity(it->second));
+  }
+  GameEntity *entity = nullptr;
+  if (entityPool_.empty()) {
+    entity = new GameEntity();
+  } else {
+    entity = entityPool_.back();
+    entityPool_.pop_back();
+    entity->reset();
+  }
+  entity->setGameID(game_id);
+  game_to_render_id[game_id] = Renderer::get()->spawnEntity(entity);
+  return entity;
+}
+
+void Game::reapEntities(float render_t) {
+  for (auto it = deadEntities_.begin(); it != deadEntities_.end(); ) {
+    if (render_t < it->second + CURVE_RETENTION) {
+      it++;
+      continue;
+    }
+    auto render_it = game_to_render_id.find(it->first);
+    auto *entity = GameEntity::cast(
+        Renderer::get()->releaseEntity(render_it->second));
+    game_to_render_id.erase(render_it);
+    if (entityPool_.size() < MAX_POOLED_ENTITIES) {
+      entityPool_.push_back(entity);
+    } else {
+      delete entity;
+    }
+    it = deadEntities_.erase(it);
   }
+}
 
-  auto chats = must_have_idx(v, "chats");
-  for (int i = 0; i < chats.size(); i++) {
-    auto json_chat = chats[i];
-    auto chat = ChatMessage(
-        toID(must_have_idx(json_chat, "pid")),
-        must_have_idx(json_chat, "msg").asString(),
-        Clock::now());
-    chatListener_(chat);
+void Game::playout() {
+  std::unique_ptr<game_update> update;
+  while (updates_.pop(update)) {
+    const std::string &type = update->message.type;
+    render_snapshot &render = update->message.render;
+    if (type == "start") {
+      Renderer::get()->setGameTime(0.f);
+      Renderer::get()->setTimeMultiplier(1.f);
+    } else if (type == "chat") {
+      handleChats(render.chats);
+    } else if (update->has_server_time) {
+      const float t = render.t;
+      const float dt = render.dt;
+      renderBuffer_.push(t, dt, update->server_time, std::move(render));
+    } else {
+      applyRender(render);
+      snapRenderTime(render.t, render.dt);
+    }
+  }
+
+  double server_time;
+  if (renderBuffer_.getClock().hasSnapshot()
+      && serverClock_
+      && serverClock_(server_time)) {
+    updateRenderTime(server_time);
+  }
+  // Catching up after a stall is spread over several frames
+  const float render_t = Renderer::get()->getGameTime();
+  render_snapshot render;
+  for (size_t i = 0; i < MAX_RENDERS_PER_FRAME; i++) {
+    if (!renderBuffer_.pop(render_t, render)) {
+      break;
+    }
+    applyRender(render);
   }
-  const float t = must_have_idx(v, "t").asFloat();
-  const float dt = must_have_idx(v, "dt").asFloat();
+  reapEntities(render_t);
+}
+
+void Game::updateRenderTime(double server_time) {
+  float render_t = Renderer::get()->getGameTime();
+  const float rate = renderBuffer_.getClock().correct(render_t, server_time);
+  if (render_t != Renderer::get()->getGameTime()) {
+    LOG(WARNING) << "Render time jumped from "
+      << Renderer::get()->getGameTime() << " to " << render_t
+      << " (server " << server_time << ")\n";
+    Renderer::get()->setGameTime(render_t);
+  }
+  Renderer::get()->setTimeMultiplier(rate);
+}
+
+void Game::snapRenderTime(float t, float dt) {
   const float render_t = Renderer::get()->getGameTime();
   if (render_t + dt > t) {
     LOG(WARNING) << "Renderer is ahead of game: " << render_t << " vs " << t << '\n';
@@ -268,20 +262,32 @@ void Game::handleRenderMessage(const Json::Value &v) {
   }
 }
 
-void Game::renderFromJSON(const Json::Value &msgs) {
-  invariant(msgs.isArray(), "json messages must be array");
-  invariant(msgs.size() > 0, "messges must be nonempty");
-  for (auto msg : msgs) {
-    auto type = must_have_idx(msg, "type").asString();
+void Game::handleChats(const Json::Value &chats) {
+  for (int i = 0; i < chats.size(); i++) {
+    auto json_chat = chats[i];
+    auto chat = ChatMessage(
+        toID(must_have_idx(json_chat, "pid")),
+        must_have_idx(json_chat, "msg").asString(),
+        Clock::now());
+    chatListener_(chat);
+  }
+}
+
+void Game::readMessages(const std::string &batch) {
+  JsonCursor cursor(batch);
+  cursor.beginArray();
+  while (cursor.nextElement()) {
+    std::unique_ptr<game_update> update(new game_update);
+    decode_message(cursor, strings_, update->message);
+    const std::string type = update->message.type;
     if (type == "render") {
-      handleRenderMessage(msg);
-    } else if (type == "start") {
-      Renderer::get()->setGameTime(0.f);
-      Renderer::get()->setTimeMultiplier(1.f);
+      handleRender(std::move(update));
+    } else if (type == "chat" || type == "start") {
+      // Chats are sent apart from renders when those may be dropped
+      publish(std::move(update));
     } else if (type == "game_over") {
       // TODO(zack/connor): do more here
-      auto winning_team = toID(must_have_idx(msg, "winning_team"));
-      LOG(DEBUG) << "Winning team : " << winning_team << '\n';
+      LOG(DEBUG) << "Winning team : " << update->message.winning_team << '\n';
       running_ = false;
     } else {
       invariant_violation("unknown message type: " + type);
@@ -297,15 +303,20 @@ void Game::addAction(id_t pid, const Json::Value &v) {
 
 void Game::run() {
   running_ = true;
+  std::string batch;
   while (running_) {
-    auto messages = renderProvider_();
-
-    auto engine_lock = Renderer::get()->lockEngine();
-    renderFromJSON(messages);
+    if (!renderProvider_(MAX_READ_WAIT_MILLIS, batch)) {
+      continue;
+    }
+    try {
+      readMessages(batch);
+    } catch (network_exception &e) {
+      LOG(WARNING) << "Dropping malformed messages: " << e.what() << '\n';
+    }
   }
 }
 
-GameEntity * Game::getEntity(const std::string &game_id) {
+GameEntity * Game::getEntity(id_t game_id) {
   auto it = game_to_render_id.find(game_id);
   if (it == game_to_render_id.end()) {
     return nullptr;
@@ -313,7 +324,7 @@ GameEntity * Game::getEntity(const std::string &game_id) {
   return GameEntity::cast(Renderer::get()->getEntity(it->second));
 }
 
-const GameEntity * Game::getEntity(const std::string &game_id) const {
+const GameEntity * Game::getEntity(id_t game_id) const {
   auto it = game_to_render_id.find(game_id);
   if (it == game_to_render_id.end()) {
     return nullptr;
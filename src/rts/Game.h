@@ -1,12 +1,19 @@
 #ifndef SRC_RTS_GAME_H_
 #define SRC_RTS_GAME_H_
 
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <glm/glm.hpp>
 #include "common/Clock.h"
 #include "common/Logger.h"
+#include "common/JitterBuffer.h"
+#include "common/SPSCQueue.h"
+#include "common/StringTable.h"
 #include "rts/GameScript.h"
+#include "rts/RenderSnapshot.h"
 
 namespace rts {
 
@@ -17,9 +24,10 @@ struct ChatMessage;
 
 class Game {
  public:
-  // Should return a json array of json object messages
-  // each message should have the 'type' field set at a minimum
-  typedef std::function<Json::Value(void)> RenderProvider;
+  // Should set the string to the next batch of messages: json text of an
+  // array of objects, each with the 'type' field set at a minimum.  Waits
+  // at most the given milliseconds, returning false if nothing arrived.
+  typedef std::function<bool(size_t, std::string &)> RenderProvider;
   typedef std::function<void(const Json::Value&)> ActionFunc;
   explicit Game(
       Map *map,
@@ -30,7 +38,10 @@ class Game {
 
   static Game* get() { return nullthrows(instance_); }
 
+  // Reads and decodes messages until the game ends, on its own thread
   void run();
+  // Applies what run has decoded, on the render thread, once per frame
+  void playout();
   void addAction(id_t pid, const Json::Value &v);
 
   const Map * getMap() const {
@@ -40,8 +51,8 @@ class Game {
     return elapsedTime_;
   }
 
-  GameEntity * getEntity(const std::string &game_id);
-  const GameEntity * getEntity(const std::string &game_id) const;
+  GameEntity * getEntity(id_t game_id);
+  const GameEntity * getEntity(id_t game_id) const;
   const Player * getPlayer(id_t pid) const;
   const std::vector<Player *>& getPlayers() const { return players_; }
 
@@ -49,21 +60,65 @@ class Game {
   float getPower(id_t pid) const;
   float getVictoryPoints(id_t tid) const;
 
+  // Sets t to the server's clock now, returning false if it isn't known
+  // yet.  See Connection::getRemoteTime.
+  typedef std::function<bool(double &)> ServerClock;
+  // With a server clock, renders are held in a jitter buffer and played out
+  // at render time.  Without one, they are applied as they arrive, and
+  // render time is corrected only when it falls outside the last two.
+  void setServerClock(ServerClock clock) {
+    serverClock_ = clock;
+  }
+
   typedef std::function<void(const ChatMessage &)> ChatListener;
   void setChatListener(ChatListener listener) {
     chatListener_ = listener;
   }
 
  private:
-  void renderFromJSON(const Json::Value &v);
-  void handleRenderMessage(const Json::Value &v);
+  // Decodes a batch of messages from the server and hands them on
+  void readMessages(const std::string &batch);
+  struct game_update;
+  void handleRender(std::unique_ptr<game_update> update);
+  // Hands a decoded message to the render thread
+  void publish(std::unique_ptr<game_update> update);
+  void handleChats(const Json::Value &chats);
+  void applyRender(render_snapshot &render);
+  // Finds or makes the entity for a game id
+  GameEntity * spawnEntity(id_t game_id);
+  // Removes entities that have been dead longer than render time can go
+  // back, keeping them to reuse.
+  void reapEntities(float render_t);
+  // Slews the render clock toward the server's timeline
+  void updateRenderTime(double server_time);
+  // Jumps the render time back between the last two renders if it is
+  // outside them
+  void snapRenderTime(float t, float dt);
 
   Map *map_;
-  std::map<std::string, id_t> game_to_render_id;
+  // game id => render id, looked up for every entity in each render and
+  // by the selection code each frame
+  std::unordered_map<id_t, id_t> game_to_render_id;
+  // game id => death time, of the entities that have died
+  std::map<id_t, float> deadEntities_;
+  // Removed entities, to reuse with their memory
+  std::vector<GameEntity *> entityPool_;
   std::vector<Player *> players_;
   RenderProvider renderProvider_;
   ActionFunc actionFunc_;
-  bool running_;
+  ServerClock serverClock_;
+  // A message decoded by run, waiting for playout
+  struct game_update {
+    server_message message;
+    // The server's clock when a render arrived, if known
+    bool has_server_time;
+    double server_time;
+  };
+  SPSCQueue<std::unique_ptr<game_update>> updates_;
+  JitterBuffer<render_snapshot> renderBuffer_;
+  // Names, icons and tooltips, defined by the server as they are first used
+  StringTable strings_;
+  std::atomic<bool> running_;
   // pid => float
   std::map<id_t, float> requisition_;
   std::map<id_t, float> power_;
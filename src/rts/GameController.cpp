@@ -5,6 +5,7 @@
 #include <glm/gtx/norm.hpp>
 #include "common/util.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
 #include "rts/ActionWidget.h"
 #include "rts/ActorPanelWidget.h"
 #include "rts/CommandWidget.h"
@@ -95,7 +96,8 @@ GameController::GameController(LocalPlayer *player, ActionFunc actionFunc)
     visDataLength_(0),
     order_(),
     zoom_(0.f),
-    action_() {
+    action_(),
+    lastJSUpdateT_(-1.f) {
   gameScript_ = new GameScript();
 }
 
@@ -196,8 +198,8 @@ void GameController::onCreate() {
         Json::Value order;
         order["type"] = OrderTypes::UPGRADE;
         order["entity"] = toJson(player_->getSelection());
-        order["part"] = upgrade.part;
-        order["upgrade"] = upgrade.name;
+        order["part"] = upgrade.part.str();
+        order["upgrade"] = upgrade.name.str();
 
         attemptIssueOrder(order);
       });
@@ -298,10 +300,9 @@ void GameController::onCreate() {
   for (int i = 0; i < collision_objects.size(); i++) {
     Json::Value collision_object_def = collision_objects[i];
 
-    id_t eid = Renderer::get()->newEntityID();
     glm::vec2 pos = toVec2(collision_object_def["pos"]);
     glm::vec2 size = toVec2(collision_object_def["size"]);
-    ModelEntity *obj = new ModelEntity(eid);
+    ModelEntity *obj = new ModelEntity();
     obj->setSize(0.f, glm::vec3(size, 0.f));
     obj->setPosition(0.f, glm::vec3(pos, 0.1f));
     obj->setAngle(0.f, collision_object_def["angle"].asFloat());
@@ -364,13 +365,31 @@ void GameController::renderExtra(float dt) {
     }
   }
 
+  // Paths of selected units.  These are drawn here rather than with the
+  // entity overlays, which are culled with their entity, because a path
+  // can reach the screen when its unit is off it.
+  for (auto game_id : player_->getSelection()) {
+    const GameEntity *e = Game::get()->getEntity(game_id);
+    if (!e || !e->isVisible()) {
+      continue;
+    }
+    // TODO(zack): remove z hack
+    const auto zhack = glm::vec3(0, 0, 0.05f);
+    auto prev = e->getPosition(t) + zhack;
+    for (auto target : e->getUIInfo(t).path) {
+      target += zhack;
+      renderLineColor(prev, target, glm::vec4(1.f));
+      prev = target;
+    }
+  }
+
   // Get vp infomation
   std::vector<VPInfo> vp_infos;
-  for (auto it : Renderer::get()->getEntities()) {
-    if (it.second->hasProperty(GameEntity::P_ACTOR)) {
-      auto ui_info = ((GameEntity *)it.second)->getUIInfo(t);
+  for (auto *entity : Renderer::get()->getEntities()) {
+    if (entity->hasProperty(GameEntity::P_ACTOR)) {
+      const auto &ui_info = ((GameEntity *)entity)->getUIInfo(t);
       if (ui_info.extra.isMember("vp_status")) {
-        auto vp_status = ui_info.extra["vp_status"];
+        const auto &vp_status = ui_info.extra["vp_status"];
         auto owner_json = must_have_idx(vp_status, "owner");
         auto capper_json = must_have_idx(vp_status, "capper");
         float cap_fact = ui_info.capture[1] ?
@@ -474,37 +493,83 @@ std::string GameController::getCursorTexture() const {
   return texname;
 }
 
-void GameController::updateVisibility(float t) {
+void GameController::updateJSController(float t) {
   ENTER_GAMESCRIPT(gameScript_);
   v8::TryCatch try_catch;
   auto js_controller = getJSController();
   auto js_entities = v8::Array::New();
-  for (auto &pair : Renderer::get()->getEntities()) {
-    auto *game_entity = GameEntity::cast(pair.second);
+  std::vector<GameEntity *> owned_entities;
+  for (auto *entity : Renderer::get()->getEntities()) {
+    auto *game_entity = GameEntity::cast(entity);
     if (!game_entity) continue;
     game_entity->setVisible(
         game_entity->getAlive(t)
         && game_entity->isVisibleTo(t, player_->getPlayerID()));
-    if (!game_entity->getAlive(t)) {
+    if (!game_entity->getAlive(t)
+        || game_entity->getPlayerID(t) != player_->getPlayerID()) {
+      game_entity->clearPrediction();
       continue;
     }
 
     // TODO(zack): this needs to be kept in sync with JS and is brittle
-    if (game_entity->getPlayerID(t) == player_->getPlayerID()) {
-      auto js_ent = v8::Object::New();
-      js_ent->Set(v8::String::New("sight"), v8::Number::New(game_entity->getSight(t)));
-      js_ent->Set(v8::String::New("pos"), vec2ToJS(game_entity->getPosition2(t)));
-      js_entities->Set(js_entities->Length(), js_ent);
+    auto js_ent = v8::Object::New();
+    js_ent->Set(
+        v8::String::New("id"),
+        v8::Number::New(game_entity->getGameID()));
+    js_ent->Set(v8::String::New("sight"), v8::Number::New(game_entity->getSight(t)));
+    js_ent->Set(
+        v8::String::New("pos"),
+        vec2ToJS(game_entity->getServerPosition2(t)));
+    js_ent->Set(v8::String::New("size"), vec2ToJS(game_entity->getSize2(t)));
+    js_ent->Set(
+        v8::String::New("angle"),
+        v8::Number::New(game_entity->getServerAngle(t)));
+    js_ent->Set(
+        v8::String::New("speed"),
+        v8::Number::New(game_entity->getSpeed(t)));
+    js_ent->Set(
+        v8::String::New("mobile"),
+        v8::Boolean::New(game_entity->hasProperty(GameEntity::P_MOBILE)));
+    const auto &path = game_entity->getUIInfo(t).path;
+    if (!path.empty()) {
+      js_ent->Set(
+          v8::String::New("path_end"),
+          vec2ToJS(glm::vec2(path.back())));
     }
+    js_entities->Set(js_entities->Length(), js_ent);
+    owned_entities.push_back(game_entity);
   }
 
+  // Render time can be moved back to resync with the server
+  const float dt = lastJSUpdateT_ < 0.f
+    ? 0.f
+    : std::max(t - lastJSUpdateT_, 0.f);
+  lastJSUpdateT_ = t;
+
   auto js_update_func = v8::Handle<v8::Function>::Cast(
     js_controller->Get(v8::String::New("update")));
-  const int argc = 1;
-  v8::Handle<v8::Value> argv[] = { js_entities };
+  const int argc = 2;
+  v8::Handle<v8::Value> argv[] = { js_entities, v8::Number::New(dt) };
   auto ret = js_update_func->Call(js_controller, argc, argv);
   checkJSResult(ret, try_catch, "ui_update");
 
+  // Show predicted units where the UI expects them to be
+  auto predictions = v8::Handle<v8::Object>::Cast(ret);
+  auto pos_str = v8::String::New("pos");
+  auto angle_str = v8::String::New("angle");
+  for (auto *game_entity : owned_entities) {
+    auto js_eid = v8::Number::New(game_entity->getGameID())->ToString();
+    if (!predictions->Has(js_eid)) {
+      game_entity->clearPrediction();
+      continue;
+    }
+    auto prediction = v8::Handle<v8::Object>::Cast(predictions->Get(js_eid));
+    game_entity->setPrediction(
+        t,
+        jsToVec2(v8::Handle<v8::Array>::Cast(prediction->Get(pos_str))),
+        prediction->Get(angle_str)->NumberValue());
+  }
+
   size_t len = visDim_.x * visDim_.y;
   uint8_t *data = new uint8_t[len];
   for (auto i = 0; i < len; i++) {
@@ -516,8 +581,9 @@ void GameController::updateVisibility(float t) {
 }
 
 void GameController::frameUpdate(float dt) {
+  Game::get()->playout();
   float t = Renderer::get()->getGameTime();
-  updateVisibility(t);
+  updateJSController(t);
   // Remove done highlights
   for (size_t i = 0; i < highlights_.size(); ) {
     if (highlights_[i].remaining <= 0.f) {
@@ -568,27 +634,25 @@ void GameController::frameUpdate(float dt) {
     Renderer::get()->updateCamera(delta);
   }
 
-  // Deselect dead entities
-  std::set<std::string> newsel;
-  for (auto game_id : player_->getSelection()) {
+  // Deselect dead entities, including from control groups, as reaped
+  // entities can no longer be looked up
+  const id_t player_id = player_->getPlayerID();
+  player_->filterSelections([=](id_t game_id) {
     const GameEntity *e = Game::get()->getEntity(game_id);
-    if (e && e->getPlayerID(t) == player_->getPlayerID() && e->getAlive(t)) {
-      newsel.insert(game_id);
-    }
-  }
-  player_->setSelection(newsel);
-  if (!action_.name.empty() && !newsel.count(action_.owner_id)) {
+    return e && e->getPlayerID(t) == player_id && e->getAlive(t);
+  });
+  if (!action_.name.empty() && !player_->isSelected(action_.owner_id)) {
     action_.name.clear();
   }
 
   // update hotkey groups
-  for (auto pair : Renderer::get()->getEntities()) {
-    auto *ge = GameEntity::cast(pair.second);
+  for (auto *entity : Renderer::get()->getEntities()) {
+    auto *ge = GameEntity::cast(entity);
     if (!ge) {
       continue;
     }
     if (ge->getPlayerID(t) == player_->getPlayerID() && ge->getUIInfo(t).hotkey) {
-      std::set<std::string> hotkey_sel;
+      std::set<id_t> hotkey_sel;
       hotkey_sel.insert(ge->getGameID());
       player_->addSavedSelection(ge->getUIInfo(t).hotkey, hotkey_sel);
     }
@@ -612,7 +676,7 @@ void GameController::mouseDown(const glm::vec2 &screenCoord, int button) {
     return;
   }
   Json::Value order;
-  std::set<std::string> newSelect = player_->getSelection();
+  std::set<id_t> newSelect = player_->getSelection();
   const float t = Renderer::get()->getGameTime();
 
   glm::vec3 loc = Renderer::get()->screenToTerrain(screenCoord);
@@ -628,22 +692,22 @@ void GameController::mouseDown(const glm::vec2 &screenCoord, int button) {
       order["entity"] = toJson(player_->getSelection());
       order["target"] = toJson(loc);
       if (entity && entity->getTeamID(t) != player_->getTeamID()) {
-        order["target_id"] = entity->getGameID();
+        order["target_id"] = toJson(entity->getGameID());
       }
       order_.clear();
     } else if (!action_.name.empty()) {
       if (!newSelect.count(action_.owner_id)) {
         return;
       }
-      std::set<std::string> ids(&action_.owner_id, (&action_.owner_id)+1);
+      std::set<id_t> ids(&action_.owner_id, (&action_.owner_id)+1);
       if (action_.targeting == UIAction::TargetingType::NONE) {
         order["type"] = OrderTypes::ACTION;
         order["entity"] = toJson(ids);
-        order["action"] = action_.name;
+        order["action"] = action_.name.str();
       } else if (action_.targeting == UIAction::TargetingType::LOCATION) {
         order["type"] = OrderTypes::ACTION;
         order["entity"] = toJson(ids);
-        order["action"] = action_.name;
+        order["action"] = action_.name.str();
         order["target"] = toJson(glm::vec2(loc));
       } else if (action_.targeting == UIAction::TargetingType::ENEMY) {
         if (!entity
@@ -654,8 +718,8 @@ void GameController::mouseDown(const glm::vec2 &screenCoord, int button) {
         }
         order["type"] = OrderTypes::ACTION;
         order["entity"] = toJson(ids);
-        order["action"] = action_.name;
-        order["target_id"] = entity->getGameID();
+        order["action"] = action_.name.str();
+        order["target_id"] = toJson(entity->getGameID());
         highlightEntity(entity->getID());
       } else if (action_.targeting == UIAction::TargetingType::ALLY) {
         if (!entity
@@ -666,14 +730,14 @@ void GameController::mouseDown(const glm::vec2 &screenCoord, int button) {
         }
         order["type"] = OrderTypes::ACTION;
         order["entity"] = toJson(ids);
-        order["action"] = action_.name;
-        order["target_id"] = entity->getGameID();
+        order["action"] = action_.name.str();
+        order["target_id"] = toJson(entity->getGameID());
         highlightEntity(entity->getID());
       } else if (action_.targeting == UIAction::TargetingType::PATHABLE) {
         // TODO(zack): check if location is pathable
         order["type"] = OrderTypes::ACTION;
         order["entity"] = toJson(ids);
-        order["action"] = action_.name;
+        order["action"] = action_.name.str();
         order["target"] = toJson(glm::vec2(loc));
       } else {
         invariant_violation("Unsupported targeting type");
@@ -711,6 +775,16 @@ void GameController::attemptIssueOrder(Json::Value order) {
     action["type"] = ActionTypes::ORDER;
     action["order"] = order;
     actionFunc_(player_->getPlayerID(), action);
+
+    ENTER_GAMESCRIPT(gameScript_);
+    v8::TryCatch try_catch;
+    auto js_controller = getJSController();
+    auto js_order_func = v8::Handle<v8::Function>::Cast(
+      js_controller->Get(v8::String::New("order")));
+    const int argc = 1;
+    v8::Handle<v8::Value> argv[] = { jsonToJS(order) };
+    auto ret = js_order_func->Call(js_controller, argc, argv);
+    checkJSResult(ret, try_catch, "ui_order");
   }
 }
 
@@ -740,7 +814,7 @@ Json::Value GameController::handleRightClick(
         order["type"] = OrderTypes::ATTACK;
       }
       order["entity"] = toJson(player_->getSelection());
-      order["target_id"] = entity->getGameID();
+      order["target_id"] = toJson(entity->getGameID());
     // If we have a selection, and they didn't click on the current
     // selection, move them to target
     } else if (!player_->getSelection().empty()
@@ -769,7 +843,7 @@ void GameController::mouseUp(const glm::vec2 &screenCoord, int button) {
         screenCoord,
         player_->getPlayerID());
 
-      std::set<std::string> new_selection;
+      std::set<id_t> new_selection;
       if (shift_) {
         new_selection = player_->getSelection();
       }
@@ -822,8 +896,10 @@ void GameController::keyPress(const KeyEvent &ev) {
         if (saved_selection == player_->getSelection()) {
           auto game_id = *(saved_selection.begin());
           auto entity = Game::get()->getEntity(game_id);
-          glm::vec3 pos = entity->getPosition(t);
-          Renderer::get()->setCameraLookAt(pos);
+          if (entity) {
+            glm::vec3 pos = entity->getPosition(t);
+            Renderer::get()->setCameraLookAt(pos);
+          }
         }
       }
       player_->setSelection(saved_selection);
@@ -849,7 +925,7 @@ void GameController::keyPress(const KeyEvent &ev) {
         order_.clear();
         action_.name.clear();
       } else {
-        player_->setSelection(std::set<std::string>());
+        player_->setSelection(std::set<id_t>());
       }
     } else if (key == INPUT_KEY_LEFT_SHIFT || key == INPUT_KEY_RIGHT_SHIFT) {
       shift_ = true;
@@ -893,7 +969,7 @@ void GameController::keyPress(const KeyEvent &ev) {
       } else {
         auto sel = player_->getSelection().begin();
         auto actor = Game::get()->getEntity(*sel);
-        auto actions = actor->getActions();
+        auto actions = actor ? actor->getActions() : std::vector<UIAction>();
         for (auto &action : actions) {
           if (action.hotkey && action.hotkey == tolower(key)) {
             handleUIAction(action);
@@ -974,21 +1050,23 @@ std::set<GameEntity *> GameController::selectEntities(
   Rect dragRect(center, size, 0.f);
   bool onlySelectUnits = false;
 
-  for (const auto &pair : Renderer::get()->getEntities()) {
-    auto e = pair.second;
-    // Must be an actor owned by the passed player
-    if (!e->hasProperty(GameEntity::P_ACTOR) && e->isVisible()) {
-      continue;
-    }
-    auto ge = (GameEntity *) e;
-    if (ge->getPlayerID(t) == pid
-        && boxInBox(dragRect, ge->getRect(t))) {
-      boxedEntities.insert(ge);
-      if (ge->hasProperty(GameEntity::P_UNIT)) {
-        onlySelectUnits = true;
-      }
-    }
-  }
+  Renderer::get()->findEntitiesIn(
+      center - size / 2.f,
+      center + size / 2.f,
+      [&](ModelEntity *e) {
+        // Must be an actor owned by the passed player
+        if (!e->hasProperty(GameEntity::P_ACTOR) && e->isVisible()) {
+          return;
+        }
+        auto ge = (GameEntity *) e;
+        if (ge->getPlayerID(t) == pid
+            && boxInBox(dragRect, ge->getRect(t))) {
+          boxedEntities.insert(ge);
+          if (ge->hasProperty(GameEntity::P_UNIT)) {
+            onlySelectUnits = true;
+          }
+        }
+      });
   std::set<GameEntity *> ret;
   for (const auto &e : boxedEntities) {
     if (!onlySelectUnits || e->hasProperty(GameEntity::P_UNIT)) {
@@ -1015,6 +1093,16 @@ void renderHealthBar(
     const std::vector<GameEntity::UIPart> &parts,
     const GameEntity *actor,
     const Player *player) {
+  static Param<glm::vec4> bgColor("hud.actor_health.bg_color");
+  static Param<glm::vec4> enemyColor("hud.actor_health.enemy_color");
+  static Param<glm::vec4> disabledBgColor(
+      "hud.actor_health.disabled_bg_color");
+  static Param<glm::vec4> localColor("hud.actor_health.local_color");
+  static Param<glm::vec4> teamColor("hud.actor_health.team_color");
+  static Param<float> flashDuration("hud.actor_health.flash_duration");
+  static Param<glm::vec4> flashColor("hud.actor_health.flash_color");
+  static Param<glm::vec4> separatorColor(
+      "hud.actor_health.separator_color");
   const float t = Renderer::get()->getGameTime();
   float current_health = 0.f;
   float total_health = 0.f;
@@ -1026,8 +1114,8 @@ void renderHealthBar(
   glm::vec2 bottom_left = center - size / 2.f;
 
   if (actor->getTeamID(t) != player->getTeamID()) {
-    auto bgcolor = vec4Param("hud.actor_health.bg_color");
-    auto color = vec4Param("hud.actor_health.enemy_color");
+    auto bgcolor = bgColor.get();
+    auto color = enemyColor.get();
     float factor = glm::clamp(current_health / total_health, 0.f, 1.f);
 
     drawRect(bottom_left, size, bgcolor);
@@ -1055,18 +1143,18 @@ void renderHealthBar(
     s += max_health;
 
     glm::vec4 bgcolor = health > 0
-      ? vec4Param("hud.actor_health.bg_color")
-      : vec4Param("hud.actor_health.disabled_bg_color");
+      ? bgColor.get()
+      : disabledBgColor.get();
     glm::vec4 healthBarColor;
     if (actor->getPlayerID(t) == player->getPlayerID()) {
-      healthBarColor = vec4Param("hud.actor_health.local_color");
+      healthBarColor = localColor.get();
     } else {
-      healthBarColor = vec4Param("hud.actor_health.team_color");
+      healthBarColor = teamColor.get();
     }
     float timeSinceDamage = Clock::secondsSince(actor->getLastTookDamage(i++));
     // TODO flash the specific bar, not the entire thingy
-    if (timeSinceDamage < fltParam("hud.actor_health.flash_duration")) {
-      healthBarColor = vec4Param("hud.actor_health.flash_color");
+    if (timeSinceDamage < flashDuration.get()) {
+      healthBarColor = flashColor.get();
     }
     drawRectCenter(total_center, total_size, bgcolor);
     // Green on top for current health
@@ -1076,7 +1164,7 @@ void renderHealthBar(
       drawLine(
           glm::vec2(p.x, p.y),
           glm::vec2(p.x, p.y + size.y),
-          vec4Param("hud.actor_health.separator_color"));
+          separatorColor.get());
     }
     first = false;
   }
@@ -1094,7 +1182,22 @@ void renderEntity(
   auto pos = e->getPosition(t);
   auto transform = glm::translate(glm::mat4(1.f), pos);
   record_section("renderActorInfo");
-  // TODO(zack): only render for actors currently on screen/visible
+  static Param<glm::vec3> selectedColor("colors.selected");
+  static Param<glm::vec3> targetedColor("colors.targeted");
+  static Param<float> highlightThickness("ui.highlight.thickness");
+  static Param<glm::vec2> hotkeyPos("hud.actor_hotkey.pos");
+  static Param<float> hotkeyFontSize("hud.actor_hotkey.font_size");
+  static Param<glm::vec2> capDim("hud.actor_cap.dim");
+  static Param<glm::vec2> capPos("hud.actor_cap.pos");
+  static Param<glm::vec4> capColor("hud.actor_cap.color");
+  static Param<glm::vec2> healthPos("hud.actor_health.pos");
+  static Param<glm::vec2> healthDim("hud.actor_health.dim");
+  static Param<glm::vec4> manaColor("hud.actor_mana.color");
+  static Param<glm::vec2> manaDim("hud.actor_mana.dim");
+  static Param<glm::vec2> manaPos("hud.actor_mana.pos");
+  static Param<glm::vec2> retreatDim("hud.actor_retreat.dim");
+  static Param<glm::vec2> retreatPos("hud.actor_retreat.pos");
+  static Param<std::string> retreatTexture("hud.actor_retreat.texture");
   auto entitySize = e->getSize2(t);
   auto circleTransform = glm::scale(
       glm::translate(
@@ -1105,14 +1208,14 @@ void renderEntity(
     // A bit of a hack here...
     renderCircleColor(
         circleTransform,
-        glm::vec4(vec3Param("colors.selected"), 1.f),
-        fltParam("ui.highlight.thickness"));
+        glm::vec4(selectedColor.get(), 1.f),
+        highlightThickness.get());
   } else if (entityHighlights.find(e->getID()) != entityHighlights.end()) {
     // A bit of a hack here...
     renderCircleColor(
         circleTransform,
-        glm::vec4(vec3Param("colors.targeted"), 1.f),
-        fltParam("ui.highlight.thickness"));
+        glm::vec4(targetedColor.get(), 1.f),
+        highlightThickness.get());
   }
 
   glDisable(GL_DEPTH_TEST);
@@ -1123,7 +1226,7 @@ void renderEntity(
   auto resolution = Renderer::get()->getResolution();
   auto coord = (glm::vec2(ndc.x, -ndc.y) / 2.f + 0.5f) * resolution;
   auto actor = (const GameEntity *)e;
-  const auto ui_info = actor->getUIInfo(t);
+  const auto &ui_info = actor->getUIInfo(t);
 
   // Hotkey
   if (actor->getPlayerID(t) == localPlayer->getPlayerID()
@@ -1133,38 +1236,39 @@ void renderEntity(
     s.push_back(ui_info.hotkey);
     FontManager::get()->drawString(
         s,
-        coord + vec2Param("hud.actor_hotkey.pos"),
-        fltParam("hud.actor_hotkey.font_size"));
+        coord + hotkeyPos.get(),
+        hotkeyFontSize.get());
   }
 
   // Cap status
   if (ui_info.capture[1]) {
     float capFact = glm::max(ui_info.capture[0] / ui_info.capture[1], 0.f);
-    glm::vec2 size = vec2Param("hud.actor_cap.dim");
-    glm::vec2 pos = coord - vec2Param("hud.actor_cap.pos");
+    glm::vec2 size = capDim.get();
+    glm::vec2 pos = coord - capPos.get();
     // Black underneath
     drawRectCenter(pos, size, glm::vec4(0, 0, 0, 1));
     pos.x -= size.x * (1.f - capFact) / 2.f;
     size.x *= capFact;
-    const glm::vec4 cap_color = vec4Param("hud.actor_cap.color");
+    const glm::vec4 cap_color = capColor.get();
     drawRectCenter(pos, size, cap_color);
   }
 
   if (!ui_info.parts.empty()) {
-    glm::vec2 center = coord - vec2Param("hud.actor_health.pos");
-    glm::vec2 size = vec2Param("hud.actor_health.dim");
+    glm::vec2 center = coord - healthPos.get();
+    glm::vec2 size = healthDim.get();
     renderHealthBar(center, size, ui_info.parts, actor, localPlayer);
   }
 
-  if (ui_info.mana[1]) {
+  const glm::vec2 mana = actor->getMana(t);
+  if (mana[1]) {
     // Display the mana bar
-    glm::vec4 manaBarColor = vec4Param("hud.actor_mana.color");
+    glm::vec4 manaBarColor = manaColor.get();
 
     float manaFact = glm::max(
         0.f,
-        ui_info.mana[0] / ui_info.mana[1]);
-    glm::vec2 size = vec2Param("hud.actor_mana.dim");
-    glm::vec2 pos = coord - vec2Param("hud.actor_mana.pos");
+        mana[0] / mana[1]);
+    glm::vec2 size = manaDim.get();
+    glm::vec2 pos = coord - manaPos.get();
     // black underneath for max mana
     drawRectCenter(pos, size, glm::vec4(0, 0, 0, 1));
     // mana color on top
@@ -1174,26 +1278,14 @@ void renderEntity(
   }
 
   if (ui_info.retreat) {
-    glm::vec2 size = vec2Param("hud.actor_retreat.dim");
-    glm::vec2 pos = coord - vec2Param("hud.actor_retreat.pos");
-    std::string texname = strParam("hud.actor_retreat.texture");
+    glm::vec2 size = retreatDim.get();
+    glm::vec2 pos = coord - retreatPos.get();
+    std::string texname = retreatTexture.get();
     auto tex = ResourceManager::get()->getTexture(texname);
     drawTextureCenter(pos, size, tex);
   }
 
   glEnable(GL_DEPTH_TEST);
-  // Render path if selected
-  if (localPlayer->isSelected(actor->getGameID())) {
-    const auto &pathQueue = ui_info.path;
-    // TODO(zack): remove z hack
-    const auto zhack = glm::vec3(0, 0, 0.05f);
-    auto prev = pos + zhack;
-    for (auto target : pathQueue) {
-      target += zhack;
-      renderLineColor(prev, target, glm::vec4(1.f));
-      prev = target;
-    }
-  }
 }
 
 void GameController::updateMapShader(Shader *shader) const {
@@ -1220,9 +1312,9 @@ void GameController::handleUIAction(const UIAction &action) {
     player_action["type"] = ActionTypes::ORDER;
     Json::Value order;
     order["type"] = OrderTypes::ACTION;
-    std::set<std::string> ids(&action.owner_id, (&action.owner_id)+1);
+    std::set<id_t> ids(&action.owner_id, (&action.owner_id)+1);
     order["entity"] = toJson(ids);
-    order["action"] = action.name;
+    order["action"] = action.name.str();
     player_action["order"] = order;
     actionFunc_(player_->getPlayerID(), player_action);
     // No extra params
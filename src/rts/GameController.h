@@ -80,9 +80,12 @@ class GameController : public Controller {
   size_t visDataLength_;
   glm::ivec2 visDim_;
   GLuint visTex_;
+  // Render time of the last JS controller update
+  float lastJSUpdateT_;
 
   v8::Handle<v8::Object> getJSController();
-  void updateVisibility(float t);
+  // Updates visibility and unit prediction in the JS controller
+  void updateJSController(float t);
   void minimapUpdateCamera(const glm::vec2 &screenCoord);
   void handleUIAction(const UIAction &action);
   // returns null if no acceptable entity near click
@@ -1,4 +1,5 @@
 #include "rts/GameEntity.h"
+#include <limits>
 #include "common/Checksum.h"
 #include "common/Collision.h"
 #include "common/ParamReader.h"
@@ -7,17 +8,16 @@
 #include "rts/Map.h"
 #include "rts/Player.h"
 
-static const uint32_t P_GAMEENTITY = 293013864;
-
 namespace rts {
 
-template<>
-GameEntity::UIInfo curve_sample<GameEntity::UIInfo>::interpolateFrom(float interpt, const curve_sample<GameEntity::UIInfo> &s0) {
-  float u = (interpt - s0.t) / (t - s0.t);
+// Set on every GameEntity, for cast
+static const property_mask P_GAMEENTITY = 1ull << 63;
 
-  GameEntity::UIInfo ret = s0.val;
-  ret.mana = val.mana * u + s0.val.mana * (1.f - u);
-  return ret;
+// Shared by all entities without UI info yet
+static const GameEntity::UIInfoPtr &empty_ui_info() {
+  static const GameEntity::UIInfoPtr empty =
+    std::make_shared<const GameEntity::UIInfo>();
+  return empty;
 }
 
 GameEntity* GameEntity::cast(ModelEntity *e) {
@@ -34,29 +34,48 @@ const GameEntity* GameEntity::cast(const ModelEntity *e) {
   return GameEntity::cast((ModelEntity*) e);
 }
 
-GameEntity::GameEntity(id_t id) : ModelEntity(id),
-    gameID_(),
+GameEntity::GameEntity() : ModelEntity(),
+    gameID_(NO_ENTITY),
     playerCurve_(NO_PLAYER),
     teamCurve_(NO_PLAYER),
     aliveCurve_(false),
-    uiInfoCurve_(UIInfo()),
     visibilityCurve_(VisibilitySet()),
-    sight_(0.f) {
+    uiInfoCurve_(empty_ui_info()),
+    uiInfoHash_(empty_ui_info()->hash()),
+    manaCurve_(glm::vec2(0.f)),
+    properties_(P_GAMEENTITY),
+    sight_(0.f),
+    speed_(0.f) {
 }
 
 GameEntity::~GameEntity() {
 }
 
-bool GameEntity::hasProperty(uint32_t property) const {
-  if (property == P_GAMEENTITY) {
-    return true;
-  }
-  return properties_.count(property);
+void GameEntity::reset() {
+  ModelEntity::reset();
+  gameID_ = NO_ENTITY;
+  playerCurve_.reset(NO_PLAYER);
+  teamCurve_.reset(NO_PLAYER);
+  aliveCurve_.reset(false);
+  uiInfoCurve_.reset(empty_ui_info());
+  uiInfoHash_ = empty_ui_info()->hash();
+  manaCurve_.reset(glm::vec2(0.f));
+  visibilityCurve_.reset(VisibilitySet());
+  lastTookDamage_.clear();
+  clearProperties();
+  sight_ = 0.f;
+  speed_ = 0.f;
+  actions_.clear();
+}
+
+void GameEntity::clearProperties() {
+  properties_ = P_GAMEENTITY;
 }
 
 void GameEntity::preRender(float t) {
   const Player *player = Game::get()->getPlayer(getPlayerID(t));
-  auto color = player ? player->getColor() : ::vec3Param("global.defaultColor");
+  static Param<glm::vec3> defaultColor("global.defaultColor");
+  auto color = player ? player->getColor() : defaultColor.get();
   setColor(color);
 
   bool visible = isVisible() && getAlive(t);
@@ -92,8 +111,9 @@ bool GameEntity::getAlive(float t) const {
   return aliveCurve_.stepSample(t);
 }
 
-GameEntity::UIInfo GameEntity::getUIInfo(float t) const {
-return uiInfoCurve_.linearSample(t);
+float GameEntity::getDeathTime() const {
+  const auto &last = aliveCurve_.back();
+  return last.val ? std::numeric_limits<float>::infinity() : last.t;
 }
 
 void GameEntity::setPlayerID(float t, id_t pid) {
@@ -110,15 +130,74 @@ void GameEntity::setAlive(float t, bool alive) {
   aliveCurve_.addKeyframe(t, alive);
 }
 
-void GameEntity::setUIInfo(float t, const UIInfo &ui_info) {
-  uiInfoCurve_.addKeyframe(t, ui_info);
+void GameEntity::setUIInfo(float t, UIInfo ui_info) {
+  manaCurve_.addKeyframe(t, ui_info.mana);
+  const uint32_t hash = ui_info.hash();
+  const UIInfoPtr &newest = uiInfoCurve_.back().val;
+  if (hash == uiInfoHash_ && ui_info.sameAs(*newest)) {
+    uiInfoCurve_.addKeyframe(t, newest);
+  } else {
+    uiInfoCurve_.addKeyframe(
+        t,
+        std::make_shared<const UIInfo>(std::move(ui_info)));
+    uiInfoHash_ = hash;
+  }
 }
 
 void GameEntity::setTookDamage(int part_idx) {
   lastTookDamage_[part_idx] = Clock::now();
 }
 
-GameEntity::UIInfo::UIInfo()
-  : mana(0.f), retreat(false), capture(0.f), capture_pid(NO_PLAYER), hotkey('\0') {
+uint32_t GameEntity::UIInfo::hash() const {
+  Checksum checksum;
+  for (const auto &part : parts) {
+    checksum.process(part.name.str())
+      .process(part.health)
+      .process(part.tooltip.str());
+    for (const auto &upgrade : part.upgrades) {
+      checksum.process(upgrade.name.str());
+    }
+    checksum.process(part.upgrades.size());
+  }
+  checksum.process(parts.size())
+    .process(retreat)
+    .process(capture)
+    .process(capture_pid)
+    .process(hotkey)
+    .process(minimap_icon.str())
+    .process(extra);
+  for (const auto &pt : path) {
+    checksum.process(pt);
+  }
+  return checksum.getChecksum();
+}
+
+bool GameEntity::UIInfo::sameAs(const UIInfo &rhs) const {
+  if (parts.size() != rhs.parts.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < parts.size(); i++) {
+    const UIPart &a = parts[i];
+    const UIPart &b = rhs.parts[i];
+    if (a.name != b.name
+        || a.health != b.health
+        || a.tooltip != b.tooltip
+        || a.upgrades.size() != b.upgrades.size()) {
+      return false;
+    }
+    for (size_t j = 0; j < a.upgrades.size(); j++) {
+      if (a.upgrades[j].part != b.upgrades[j].part
+          || a.upgrades[j].name != b.upgrades[j].name) {
+        return false;
+      }
+    }
+  }
+  return retreat == rhs.retreat
+    && capture == rhs.capture
+    && capture_pid == rhs.capture_pid
+    && hotkey == rhs.hotkey
+    && minimap_icon == rhs.minimap_icon
+    && extra == rhs.extra
+    && path == rhs.path;
 }
 };  // rts
@@ -1,6 +1,7 @@
 #ifndef SRC_RTS_ENTITY_H_
 #define SRC_RTS_ENTITY_H_
 
+#include <memory>
 #include <string>
 #include <queue>
 #include <glm/glm.hpp>
@@ -20,56 +21,82 @@ class GameEntity : public ModelEntity {
  public:
   static GameEntity* cast(ModelEntity *e);
   static const GameEntity* cast(const ModelEntity *e);
-  explicit GameEntity(id_t id);
+  GameEntity();
   virtual ~GameEntity();
 
-  static const uint32_t P_TARGETABLE = 463132888;
-  static const uint32_t P_CAPPABLE = 815586235;
-  static const uint32_t P_ACTOR = 913794634;
-  static const uint32_t P_MOBILE = 1122719651;
-  static const uint32_t P_UNIT = 118468328;
+  // Makes this a new entity, for reusing dead ones
+  void reset();
+
+  static const property_mask P_TARGETABLE = 1 << 1;
+  static const property_mask P_CAPPABLE = 1 << 2;
+  static const property_mask P_ACTOR = 1 << 3;
+  static const property_mask P_MOBILE = 1 << 4;
+  static const property_mask P_UNIT = 1 << 5;
 
   struct UIPartUpgrade {
-    std::string part;
-    std::string name;
+    InternedString part;
+    InternedString name;
     // TODO resources and tooltip
   };
   struct UIPart {
-    std::string name;
+    InternedString name;
     glm::vec2 health;
-    std::string tooltip;
+    InternedString tooltip;
     std::vector<UIPartUpgrade> upgrades;
   };
 
+  // Samples are shared between keyframes and never change once set
   struct UIInfo {
     std::vector<UIPart> parts;
+    // Read with getMana, which interpolates between samples
     glm::vec2 mana;
     bool retreat;
     glm::vec2 capture;
     id_t capture_pid;
     char hotkey;
-    std::string minimap_icon;
+    InternedString minimap_icon;
     Json::Value extra;
     std::vector<glm::vec3> path;
 
-    UIInfo();
+    UIInfo()
+      : mana(0.f),
+        retreat(false),
+        capture(0.f),
+        capture_pid(NO_PLAYER),
+        hotkey('\0') {
+    }
+
+    // Of everything but mana, which changes too often to share samples
+    uint32_t hash() const;
+    bool sameAs(const UIInfo &rhs) const;
   };
+  typedef std::shared_ptr<const UIInfo> UIInfoPtr;
 
-  virtual bool hasProperty(uint32_t property) const final override;
+  virtual bool hasProperty(property_mask property) const final override {
+    return (properties_ & property) != 0;
+  }
 
-  const std::string& getGameID() const {
+  id_t getGameID() const {
     return gameID_;
   }
   Clock::time_point getLastTookDamage(uint32_t part) const;
   const std::vector<UIAction> &getActions() const {
     return actions_;
   }
-  UIInfo getUIInfo(float t) const;
+  // Valid until the next setUIInfo
+  const UIInfo &getUIInfo(float t) const {
+    return *uiInfoCurve_.stepSample(t);
+  }
+  glm::vec2 getMana(float t) const {
+    return manaCurve_.linearSample(t);
+  }
 
   // The player that owns this entity, or NO_PLAYER
   id_t getPlayerID(float t) const;
   id_t getTeamID(float t) const;
   bool getAlive(float t) const;
+  // When this entity last died, or infinity if it is alive
+  float getDeathTime() const;
 
   float getSight(float t) const {
     return sight_;
@@ -77,25 +104,31 @@ class GameEntity : public ModelEntity {
   void setSight(float t, float sight) {
     sight_ = sight;
   }
+  // Top speed, for predicting movement
+  float getSpeed(float t) const {
+    return speed_;
+  }
+  void setSpeed(float t, float speed) {
+    speed_ = speed;
+  }
 
-  void setGameID(const std::string &id) {
+  void setGameID(id_t id) {
     gameID_ = id;
   }
   void setAlive(float t, bool alive);
   void setPlayerID(float t, id_t pid);
   void setTeamID(float t, id_t tid);
-  void setUIInfo(float t, const UIInfo &ui_info);
+  // Reuses the newest sample if ui_info is the same
+  void setUIInfo(float t, UIInfo ui_info);
   void setActions(float t, const std::vector<UIAction> &actions) {
     actions_ = actions;
   }
   void setTookDamage(int part_idx);
 
-  void addProperty(uint32_t property) {
-    properties_.insert(property);
-  }
-  void clearProperties() {
-    properties_.clear();
+  void addProperties(property_mask properties) {
+    properties_ |= properties;
   }
+  void clearProperties();
 
   bool isVisibleTo(float t, id_t pid) const;
   void setVisibilitySet(float t, const VisibilitySet &map);
@@ -104,19 +137,22 @@ class GameEntity : public ModelEntity {
   virtual void preRender(float t) final override;
 
  private:
-  std::string gameID_;
+  id_t gameID_;
   Curve<id_t> playerCurve_;
   Curve<id_t> teamCurve_;
   Curve<bool> aliveCurve_;
   Curve<VisibilitySet> visibilityCurve_;
-  Curve<UIInfo> uiInfoCurve_;
+  Curve<UIInfoPtr> uiInfoCurve_;
+  // Hash of the newest sample in uiInfoCurve_
+  uint32_t uiInfoHash_;
+  Curve<glm::vec2> manaCurve_;
 
   // TODO(zack): kill this
   std::map<uint32_t, Clock::time_point> lastTookDamage_;
 
-  std::set<uint32_t> properties_;
+  property_mask properties_;
   float sight_;
-  UIInfo uiInfo_;
+  float speed_;
   std::vector<UIAction> actions_;
 };
 };  // namespace rts
@@ -5,6 +5,7 @@
 #include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 #include "common/Collision.h"
+#include "common/Trace.h"
 #include "common/util.h"
 #include "rts/Game.h"
 #include "rts/Map.h"
@@ -90,6 +91,34 @@ static void jsLog(const FunctionCallbackInfo<Value> &args) {
   args.GetReturnValue().SetUndefined();
 }
 
+static void jsTraceBegin(const FunctionCallbackInfo<Value> &args) {
+  invariant(args.Length() == 1, "void runtime.trace.begin(string name)");
+  auto tracer = Tracer::get();
+  if (tracer->isEnabled()) {
+    HandleScope scope(args.GetIsolate());
+    tracer->begin(*String::AsciiValue(args[0]), "js");
+  }
+  args.GetReturnValue().SetUndefined();
+}
+
+static void jsTraceEnd(const FunctionCallbackInfo<Value> &args) {
+  Tracer::get()->end("js");
+  args.GetReturnValue().SetUndefined();
+}
+
+static Handle<Object> getTraceObject() {
+  HandleScope scope(Isolate::GetCurrent());
+  auto trace = Object::New();
+  trace->Set(
+      String::New("begin"),
+      FunctionTemplate::New(jsTraceBegin)->GetFunction());
+  trace->Set(
+      String::New("end"),
+      FunctionTemplate::New(jsTraceEnd)->GetFunction());
+
+  return scope.Close(trace);
+}
+
 static void jsPointInOBB2(const FunctionCallbackInfo<Value> &args) {
   invariant(args.Length() == 4, "bool pointInOBB2(p, center, size, angle)");
   HandleScope scope(args.GetIsolate());
@@ -260,6 +289,9 @@ v8::Local<v8::Value> GameScript::init(
   runtime_object->Set(
       String::New("eval"),
       FunctionTemplate::New(runtimeEval)->GetFunction());
+  runtime_object->Set(
+      String::New("trace"),
+      getTraceObject());
   getContext()->Global()->Set(
       String::New("runtime"),
       runtime_object);
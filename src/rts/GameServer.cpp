@@ -1,13 +1,53 @@
 #include "rts/GameServer.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <v8-profiler.h>
+#include "common/Checksum.h"
+#include "common/Clock.h"
+#include "common/Exception.h"
 #include "common/Logger.h"
+#include "common/Metrics.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
+#include "common/Trace.h"
 #include "common/util.h"
+#include "rts/Replay.h"
 
 namespace rts {
 
+// Snapshot blobs are this header followed by the encoded js state.
+struct snapshot_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t tick;
+  uint32_t size;
+  checksum_t checksum;
+};
+const uint32_t SNAPSHOT_MAGIC = 0x53535452;  // 'RTSS'
+const uint32_t SNAPSHOT_VERSION = 2;
+
 GameServer::GameServer()
-  : running_(false) {
+  : running_(false),
+    tick_(0),
+    replay_(nullptr),
+    slowTickThreshold_(0.f) {
   script_ = new GameScript();
+
+  auto metrics = MetricsRegistry::get();
+  actionCounter_ = metrics->counter(
+      "rts_game_actions_total",
+      "Player actions applied to the simulation");
+  updateTime_ = metrics->histogram(
+      "rts_game_update_seconds",
+      "Time spent in the javascript simulation update",
+      1e-6,
+      10000000);
+  renderSize_ = metrics->histogram(
+      "rts_game_render_bytes",
+      "Size of the game script's render each tick, before delta encoding",
+      1.0,
+      1 << 24);
 }
 
 GameServer::~GameServer() {
@@ -59,7 +99,73 @@ v8::Handle<v8::Object> GameServer::getGameObject() {
   return v8::Handle<v8::Object>::Cast(obj);
 }
 
-void GameServer::start(const Json::Value &game_def) {
+v8::Handle<v8::Value> GameServer::callGameFunction(
+    const char *name,
+    int argc,
+    v8::Handle<v8::Value> argv[]) {
+  using namespace v8;
+  HandleScope scope(script_->getIsolate());
+  auto game_object = getGameObject();
+
+  TryCatch try_catch;
+  Handle<Function> func = Handle<Function>::Cast(
+      game_object->Get(String::New(name)));
+  auto ret = func->Call(game_object, argc, argv);
+  checkJSResult(ret, try_catch, std::string(name) + ":");
+  return scope.Close(ret);
+}
+
+std::string GameServer::getSnapshot() {
+  using namespace v8;
+  ENTER_GAMESCRIPT(script_);
+  auto js_snapshot = callGameFunction("getSnapshot", 0, nullptr);
+  std::string payload = *String::Utf8Value(js_snapshot);
+
+  snapshot_header header;
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.tick = tick_;
+  header.size = payload.size();
+  header.checksum = Checksum().process(payload).getChecksum();
+
+  std::string blob(sizeof(header), '\0');
+  memcpy(&blob[0], &header, sizeof(header));
+  blob += payload;
+  return blob;
+}
+
+void GameServer::restore(
+    const Json::Value &game_def,
+    const std::string &snapshot) {
+  using namespace v8;
+  snapshot_header header;
+  if (snapshot.size() < sizeof(header)) {
+    throw file_exception("snapshot too short");
+  }
+  memcpy(&header, &snapshot[0], sizeof(header));
+  if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+    throw file_exception("not a snapshot or unsupported snapshot version");
+  }
+  std::string payload = snapshot.substr(sizeof(header));
+  if (payload.size() != header.size
+      || Checksum().process(payload).getChecksum() != header.checksum) {
+    throw file_exception("corrupt snapshot");
+  }
+
+  script_->init("game-main");
+  ENTER_GAMESCRIPT(script_);
+  const int argc = 2;
+  Handle<Value> argv[argc] = {
+    jsonToJS(game_def),
+    String::New(payload.c_str(), payload.size()),
+  };
+  callGameFunction("restore", argc, argv);
+
+  tick_ = header.tick;
+  running_ = true;
+}
+
+void GameServer::start(const Json::Value &game_def, uint32_t seed) {
   using namespace v8;
   script_->init("game-main");
   ENTER_GAMESCRIPT(script_);
@@ -67,9 +173,10 @@ void GameServer::start(const Json::Value &game_def) {
   auto game_object = getGameObject();
 
   TryCatch try_catch;
-  const int argc = 1;
+  const int argc = 2;
   Handle<Value> argv[argc] = {
     jsonToJS(game_def),
+    Integer::NewFromUnsigned(seed),
   };
   Handle<Function> game_init_method = Handle<Function>::Cast(
       game_object->Get(String::New("init")));
@@ -79,11 +186,91 @@ void GameServer::start(const Json::Value &game_def) {
   running_ = true;
 }
 
+// Writes the sampled stacks from profile as nested trace events.  Samples
+// have no timestamps of their own, so they are spread evenly over the
+// profiled interval [start, end].
+static void trace_cpu_profile(
+    const v8::CpuProfile *profile,
+    uint64_t start,
+    uint64_t end) {
+  using namespace v8;
+  const int nsamples = profile->GetSamplesCount();
+  if (nsamples == 0) {
+    return;
+  }
+
+  // Nodes only link to their children, so find each node's parent first
+  std::map<const CpuProfileNode *, const CpuProfileNode *> parents;
+  std::vector<const CpuProfileNode *> pending(1, profile->GetTopDownRoot());
+  while (!pending.empty()) {
+    auto node = pending.back();
+    pending.pop_back();
+    for (int i = 0; i < node->GetChildrenCount(); i++) {
+      auto child = node->GetChild(i);
+      parents[child] = node;
+      pending.push_back(child);
+    }
+  }
+
+  auto tracer = Tracer::get();
+  auto close_frame = [&](const CpuProfileNode *node, uint64_t from, uint64_t to) {
+    std::string name = *String::Utf8Value(node->GetFunctionName());
+    Json::Value args;
+    args["url"] = *String::Utf8Value(node->GetScriptResourceName());
+    args["line"] = node->GetLineNumber();
+    tracer->complete(
+        name.empty() ? "(anonymous)" : name,
+        "v8.cpu",
+        from,
+        to - from,
+        args);
+  };
+
+  // Frames currently open, outermost first
+  std::vector<std::pair<const CpuProfileNode *, uint64_t>> open;
+  for (int i = 0; i <= nsamples; i++) {
+    uint64_t ts = start + (end - start) * i / nsamples;
+    std::vector<const CpuProfileNode *> stack;
+    if (i < nsamples) {
+      for (auto node = profile->GetSample(i);
+           parents.find(node) != parents.end();
+           node = parents[node]) {
+        stack.push_back(node);
+      }
+      std::reverse(stack.begin(), stack.end());
+    }
+
+    size_t common = 0;
+    while (common < open.size() && common < stack.size()
+        && open[common].first == stack[common]) {
+      common++;
+    }
+    while (open.size() > common) {
+      close_frame(open.back().first, open.back().second, ts);
+      open.pop_back();
+    }
+    for (size_t j = common; j < stack.size(); j++) {
+      open.push_back(std::make_pair(stack[j], ts));
+    }
+  }
+}
+
 Json::Value GameServer::update(float dt) {
   using namespace v8;
+  TraceSection update_section("GameServer::update", "server");
+  record_section("GameServer::update");
   ENTER_GAMESCRIPT(script_);
   auto game_object = getGameObject();
 
+  auto tracer = Tracer::get();
+  CpuProfiler *cpu_profiler = nullptr;
+  uint64_t profile_start = 0;
+  if (slowTickThreshold_ > 0.f && tracer->isEnabled()) {
+    cpu_profiler = script_->getIsolate()->GetCpuProfiler();
+    cpu_profiler->StartCpuProfiling(String::New("tick"), true);
+    profile_start = tracer->now();
+  }
+
   // Don't allow new actions during this time
   std::unique_lock<std::mutex> actionLock(actionMutex_);
   // Do actions
@@ -94,13 +281,24 @@ Json::Value GameServer::update(float dt) {
         jsonToJS(action));
 
   }
+  if (replay_) {
+    replay_->writeTick(tick_, actions_);
+  }
+  actionCounter_->inc(actions_.size());
   actions_.clear();
   // Allow more actions
   actionLock.unlock();
 
   // Update javascript, passing player input
-  updateJS(js_player_inputs, dt);
+  {
+    record_section("updateJS");
+    auto update_start = Clock::now();
+    updateJS(js_player_inputs, dt);
+    updateTime_->record(Clock::secondsSince(update_start));
+  }
+  tick_++;
 
+  record_section("js render");
   TryCatch try_catch;
   Handle<Function> game_render_function = Handle<Function>::Cast(
       game_object->Get(String::New("render")));
@@ -110,6 +308,19 @@ Json::Value GameServer::update(float dt) {
 
   Handle<String> js_render_result = Handle<String>::Cast(js_render_result_ret);
   std::string encoded_render = *String::Utf8Value(js_render_result);
+  renderSize_->recordUnits(encoded_render.size());
+
+  if (cpu_profiler) {
+    auto profile = cpu_profiler->StopCpuProfiling(String::New("tick"));
+    uint64_t profile_end = tracer->now();
+    if (profile_end - profile_start > 1e6 * slowTickThreshold_) {
+      trace_cpu_profile(profile, profile_start, profile_end);
+    }
+    const_cast<CpuProfile *>(profile)->Delete();
+  }
+
+  TraceSection parse_section("parse render", "server");
+  record_section("parse render");
 
   Json::Value json_render;
   Json::Reader reader;
@@ -118,6 +329,13 @@ Json::Value GameServer::update(float dt) {
         << reader.getFormattedErrorMessages() << '\n';
       invariant_violation("error parsing game render json");
   }
+
+  // Clients acknowledge renders by tick
+  for (auto &message : json_render) {
+    if (message["type"] == "render") {
+      message["tick"] = toJson(static_cast<uint64_t>(tick_));
+    }
+  }
   return json_render;
 }
 };
\ No newline at end of file
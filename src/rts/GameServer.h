@@ -2,11 +2,17 @@
 #define SRC_RTS_GAMESERVER_H_
 #include "rts/GameScript.h"
 #include <mutex>
+#include <string>
 #include <vector>
 #include "rts/PlayerAction.h"
 
+class Counter;
+class Histogram;
+
 namespace rts {
 
+class ReplayWriter;
+
 class GameServer {
  public:
   GameServer();
@@ -18,15 +24,53 @@ class GameServer {
 
   // Can possibly block, but should never block long
   void addAction(const PlayerAction &act);
-  void start(const Json::Value &game_def);
+  // seed seeds the script's random numbers, a game plays out the same for
+  // the same game def, seed and actions.
+  void start(const Json::Value &game_def, uint32_t seed);
+  // Returns the messages for this tick.  Render messages carry the full state
+  // of every entity, and the tick number for clients to acknowledge.
   Json::Value update(float dt);
 
+  // Returns a blob containing the full simulation state.  Call between
+  // updates.
+  std::string getSnapshot();
+  // Alternative to start, resumes the game from a snapshot blob.  Throws
+  // file_exception if the blob is corrupt.
+  void restore(const Json::Value &game_def, const std::string &snapshot);
+
+  // If set, the actions fed to each update are recorded.  Does not take
+  // ownership.
+  void setReplayWriter(ReplayWriter *writer) {
+    replay_ = writer;
+  }
+  // While tracing, run each update under the V8 cpu profiler and write the
+  // sampled stacks of updates slower than threshold seconds to the trace.
+  // A threshold of 0 disables profiling.
+  void setSlowTickProfiling(float threshold) {
+    slowTickThreshold_ = threshold;
+  }
+  // Number of updates run so far.
+  size_t getTick() const {
+    return tick_;
+  }
+
  private:
   v8::Handle<v8::Object> getGameObject();
+  v8::Handle<v8::Value> callGameFunction(
+      const char *name,
+      int argc,
+      v8::Handle<v8::Value> argv[]);
   void updateJS(v8::Handle<v8::Array> player_inputs, float dt);
 
   GameScript *script_;
   bool running_;
+  size_t tick_;
+  ReplayWriter *replay_;
+  float slowTickThreshold_;
+
+  Counter *actionCounter_;
+  Histogram *updateTime_;
+  Histogram *renderSize_;
 
   std::mutex actionMutex_;
   std::vector<PlayerAction> actions_;
@@ -11,13 +11,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
-#include "common/Clock.h"
 #include "common/Exception.h"
 #include "common/Logger.h"
 #include "common/NavMesh.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
 #include "common/util.h"
 #include "rts/ResourceManager.h"
+#include "rts/Shader.h"
 #define STBI_HEADER_FILE_ONLY
 #include "stb_image.c"
 
@@ -27,6 +28,18 @@ static GLFWwindow *glfw_window;
 static MatrixStack viewStack;
 static MatrixStack projStack;
 static glm::vec2 screenRes;
+// Counts swapped frames
+static uint32_t frameNumber = 0;
+// Whether models can keep their vertex setup in a vertex array object
+static bool useVertexArrays = false;
+
+// Every program gets the same attribute locations, so one vertex array
+// object per model works with any of them
+enum VertexAttrib {
+  ATTRIB_POSITION = 0,
+  ATTRIB_NORMAL = 1,
+  ATTRIB_TEXCOORD = 2,
+};
 
 static struct {
   GLuint colorProgram;
@@ -54,6 +67,8 @@ struct Mesh {
 struct Model {
   glm::mat4 transform;
   GLuint buffer;
+  // 0 without vertex array objects
+  GLuint vertexArray;
   vert_p4n4t2 *verts;
   size_t nverts;
 
@@ -123,6 +138,7 @@ glm::vec2 initEngine() {
 
   LOG(INFO) << "GLSL Version: " <<
       glGetString(GL_SHADING_LANGUAGE_VERSION) << '\n';
+  useVertexArrays = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
   LOG(DEBUG) << "Resolution: " << screenRes << '\n';
 
   initialized = true;
@@ -147,6 +163,7 @@ void teardownEngine() {
 
 void swapBuffers() {
   glfwSwapBuffers(glfw_window);
+  frameNumber++;
 }
 
 void renderCircleColor(
@@ -181,7 +198,8 @@ void renderCircleColor(
   glLineWidth(width);
 
   // RENDER
-  glDrawArrays(GL_LINE_LOOP, 0, intParam("engine.circle_segments"));
+  static Param<int> circleSegments("engine.circle_segments");
+  glDrawArrays(GL_LINE_LOOP, 0, circleSegments.get());
 
   // Clean up
   if (!wasEnabled) {
@@ -329,92 +347,62 @@ void renderHexagonProgram(const glm::mat4 &modelMatrix) {
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void renderMesh(
+// Points the vertex attributes at the model's buffer
+static void setModelAttribs(const Model *m) {
+  glBindBuffer(GL_ARRAY_BUFFER, m->buffer);
+  glEnableVertexAttribArray(ATTRIB_POSITION);
+  glEnableVertexAttribArray(ATTRIB_NORMAL);
+  glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+  glVertexAttribPointer(ATTRIB_POSITION, 4, GL_FLOAT, GL_FALSE,
+      sizeof(struct vert_p4n4t2), (void*) (0));
+  glVertexAttribPointer(ATTRIB_NORMAL,   4, GL_FLOAT, GL_FALSE,
+      sizeof(struct vert_p4n4t2), (void*) (4 * sizeof(float)));
+  glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE,
+      sizeof(struct vert_p4n4t2), (void*) (8 * sizeof(float)));
+}
+
+static void clearModelAttribs() {
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glDisableVertexAttribArray(ATTRIB_POSITION);
+  glDisableVertexAttribArray(ATTRIB_NORMAL);
+  glDisableVertexAttribArray(ATTRIB_TEXCOORD);
+}
+
+void renderModel(
     const glm::mat4 &modelMatrix,
     const Model *m,
-    size_t start,
-    size_t end) {
+    Shader *shader) {
   record_section("renderModel");
-  GLuint program;
-  glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*) &program);
-  if (!program) {
-    LOG(WARNING) << "No active program on call to " << __FUNCTION__
-      << "\n";
-    return;
+  const Shader::Locations &locations = shader->getLocations();
+
+  // Lighting only changes between frames
+  if (shader->firstUseInFrame(frameNumber)) {
+    static Param<glm::vec3> lightPos("renderer.lightPos");
+    static Param<glm::vec3> ambient("renderer.light.ambient");
+    static Param<glm::vec3> diffuse("renderer.light.diffuse");
+    static Param<glm::vec3> specular("renderer.light.specular");
+    glUniform3fv(locations.lightPos, 1, glm::value_ptr(lightPos.get()));
+    glUniform3fv(locations.ambientColor, 1, glm::value_ptr(ambient.get()));
+    glUniform3fv(locations.diffuseColor, 1, glm::value_ptr(diffuse.get()));
+    glUniform3fv(locations.specularColor, 1, glm::value_ptr(specular.get()));
   }
 
-  glPolygonMode(GL_FRONT_AND_BACK, GL_LINES);
   const glm::mat4 projMatrix = projStack.current();
   const glm::mat4 modelViewMatrix =
       viewStack.current() * modelMatrix * m->transform;
   const glm::mat4 normalMatrix = glm::transpose(glm::inverse(modelViewMatrix));
-
-  // Uniform locations
-  GLuint modelViewUniform = glGetUniformLocation(program, "modelViewMatrix");
-  GLuint projectionUniform = glGetUniformLocation(program, "projectionMatrix");
-  GLuint normalUniform = glGetUniformLocation(program, "normalMatrix");
-  // Attributes
-  GLuint positionAttrib = glGetAttribLocation(program, "position");
-  GLuint normalAttrib   = glGetAttribLocation(program, "normal");
-  GLuint texcoordAttrib = glGetAttribLocation(program, "texcoord");
-  // Enable program and set up values
-  glUniformMatrix4fv(modelViewUniform, 1, GL_FALSE,
+  glUniformMatrix4fv(locations.modelViewMatrix, 1, GL_FALSE,
       glm::value_ptr(modelViewMatrix));
-  glUniformMatrix4fv(projectionUniform, 1, GL_FALSE,
+  glUniformMatrix4fv(locations.projectionMatrix, 1, GL_FALSE,
       glm::value_ptr(projMatrix));
-  glUniformMatrix4fv(normalUniform, 1, GL_FALSE,
+  glUniformMatrix4fv(locations.normalMatrix, 1, GL_FALSE,
       glm::value_ptr(normalMatrix));
 
-  // Lighting
-  auto lightPos = vec3Param("renderer.lightPos");
-  GLuint lightPosUniform = glGetUniformLocation(program, "lightPos");
-  glUniform3fv(lightPosUniform, 1, glm::value_ptr(lightPos));
-  GLuint ambientUniform = glGetUniformLocation(program, "ambientColor");
-  GLuint diffuseUniform = glGetUniformLocation(program, "diffuseColor");
-  GLuint specularUniform = glGetUniformLocation(program, "specularColor");
-  glUniform3fv(ambientUniform, 1, glm::value_ptr(vec3Param("renderer.light.ambient")));
-  glUniform3fv(diffuseUniform, 1, glm::value_ptr(vec3Param("renderer.light.diffuse")));
-  glUniform3fv(specularUniform, 1, glm::value_ptr(vec3Param("renderer.light.specular")));
-
-  // Bind data
-  glBindBuffer(GL_ARRAY_BUFFER, m->buffer);
-  glEnableVertexAttribArray(positionAttrib);
-  glEnableVertexAttribArray(normalAttrib);
-  glEnableVertexAttribArray(texcoordAttrib);
-  glVertexAttribPointer(positionAttrib, 4, GL_FLOAT, GL_FALSE,
-      sizeof(struct vert_p4n4t2), (void*) (0));
-  glVertexAttribPointer(normalAttrib,   4, GL_FLOAT, GL_FALSE,
-      sizeof(struct vert_p4n4t2), (void*) (4 * sizeof(float)));
-  glVertexAttribPointer(texcoordAttrib, 2, GL_FLOAT, GL_FALSE,
-      sizeof(struct vert_p4n4t2), (void*) (8 * sizeof(float)));
-
-  // Check endpoints and expand -1 to end
-  if (end == -1) {
-    end = m->nverts;
-  }
-  invariant(start < end, "out of order endpoints");
-  // Draw
-  glDrawArrays(GL_TRIANGLES, start, end - start);
-
-  // Clean up
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glDisableVertexAttribArray(positionAttrib);
-  glDisableVertexAttribArray(normalAttrib);
-  glDisableVertexAttribArray(texcoordAttrib);
-}
-
-void renderModel(
-    const glm::mat4 &modelMatrix,
-    const Model *m) {
-  GLuint program;
-  glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*) &program);
-  if (!program) {
-    LOG(WARNING) << "No active program on call to " << __FUNCTION__
-      << "\n";
-    return;
+  if (m->vertexArray) {
+    glBindVertexArray(m->vertexArray);
+  } else {
+    setModelAttribs(m);
   }
-  GLuint useTextureUniform = glGetUniformLocation(program, "useTexture");
-  GLuint textureUniform = glGetUniformLocation(program, "texture");
 
   for (int i = 0; i < m->meshes.size(); i++) {
     const auto &mesh = m->meshes[i];
@@ -423,16 +411,23 @@ void renderModel(
       ? nullptr
       : m->materials[mesh.material_index];
     // Default to no texture
-    glUniform1i(useTextureUniform, 0);
+    glUniform1i(locations.useTexture, 0);
     if (material && material->texture) {
-      glUniform1i(useTextureUniform, 1);
+      glUniform1i(locations.useTexture, 1);
       glActiveTexture(GL_TEXTURE0);
       glEnable(GL_TEXTURE);
       glBindTexture(GL_TEXTURE_2D, material->texture);
-      glUniform1i(textureUniform, 0);
+      glUniform1i(locations.texture, 0);
     }
 
-    renderMesh(modelMatrix, m, mesh.start, mesh.end);
+    invariant(mesh.start < mesh.end, "out of order endpoints");
+    glDrawArrays(GL_TRIANGLES, mesh.start, mesh.end - mesh.start);
+  }
+
+  if (m->vertexArray) {
+    glBindVertexArray(0);
+  } else {
+    clearModelAttribs();
   }
 }
 
@@ -696,6 +691,9 @@ GLuint linkProgram(GLuint vert, GLuint frag) {
 
   glAttachShader(program, vert);
   glAttachShader(program, frag);
+  glBindAttribLocation(program, ATTRIB_POSITION, "position");
+  glBindAttribLocation(program, ATTRIB_NORMAL, "normal");
+  glBindAttribLocation(program, ATTRIB_TEXCOORD, "texcoord");
 
   glLinkProgram(program);
 
@@ -865,6 +863,14 @@ Model * loadModel(const std::string &objFile) {
       GL_ARRAY_BUFFER,
       ret->verts,
       ret->nverts * sizeof(vert_p4n4t2));
+  ret->vertexArray = 0;
+  if (useVertexArrays) {
+    glGenVertexArrays(1, &ret->vertexArray);
+    glBindVertexArray(ret->vertexArray);
+    setModelAttribs(ret);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
 
   delete ret->verts;
   ret->verts = 0;
@@ -899,6 +905,9 @@ void freeModel(Model *mesh) {
     delete material;
   }
 
+  if (mesh->vertexArray) {
+    glDeleteVertexArrays(1, &mesh->vertexArray);
+  }
   glDeleteBuffers(1, &mesh->buffer);
   delete mesh->verts;
   delete mesh;
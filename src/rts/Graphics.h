@@ -11,6 +11,7 @@
 
 struct Model;
 struct Material;
+class Shader;
 struct DepthField {
   GLuint texture;
   float minDist;
@@ -67,10 +68,11 @@ void renderCircleColor(
 void renderRectangleProgram(const glm::mat4 &modelMatrix);
 void renderHexagonProgram(const glm::mat4 &model);
 void renderHexagonColor(const glm::mat4 &model, const glm::vec4 &color);
-// Uses the currently bound program
+// shader must be the active program
 void renderModel(
     const glm::mat4 &modelMatrix,
-    const Model *mesh);
+    const Model *mesh,
+    Shader *shader);
 
 void renderBones(const glm::mat4 &modelMatrix, const Model *mesh);
 void renderNavMesh(
@@ -1,16 +1,36 @@
 #include "rts/Lobby.h"
 #include <json/json.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
 #define BOOST_FILESYSTEM_NO_DEPRECATED
 #include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 #include "common/kissnet.h"
 #include "common/FPSCalculator.h"
+#include "common/Metrics.h"
 #include "common/NetConnection.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
+#include "common/SnapshotDiffer.h"
+#include "common/StringTable.h"
+#include "common/Trace.h"
+#include "common/UDPConnection.h"
 #include "rts/GameServer.h"
+#include "rts/Replay.h"
 
 namespace rts {
 
+// Smallest change in entity position, size, etc that is sent to clients
+const double RENDER_QUANTUM = 1.0 / 256.0;
+
 Json::Value get_map_definition(const std::string &map_name) {
   std::string full_path = "maps/" + map_name + ".map";
   std::ifstream file(full_path.c_str());
@@ -64,51 +84,515 @@ Json::Value get_map_definition(const std::string &map_name) {
    */
 }
 
-void game_server_loop(Json::Value game_def, std::vector<NetConnectionPtr> connections) {
+void intern_field(Json::Value &v, const char *field, StringTable &strings) {
+  if (v.isMember(field)) {
+    v[field] = strings.intern(v[field].asString());
+  }
+}
+
+// Replaces the names, icons and tooltips in entity renders with string ids.
+void intern_render_strings(Json::Value &render, StringTable &strings) {
+  for (auto &message : render) {
+    if (message["type"] != "render") {
+      continue;
+    }
+    for (auto &entity : must_have_idx(message, "entities")) {
+      if (entity.isMember("ui_info")) {
+        Json::Value &ui_info = entity["ui_info"];
+        intern_field(ui_info, "minimap_icon", strings);
+        for (auto &part : ui_info["parts"]) {
+          intern_field(part, "name", strings);
+          intern_field(part, "tooltip", strings);
+          for (auto &upgrade : part["upgrades"]) {
+            intern_field(upgrade, "name", strings);
+          }
+        }
+      }
+      for (auto &action : entity["actions"]) {
+        intern_field(action, "name", strings);
+        intern_field(action, "icon", strings);
+        intern_field(action, "tooltip", strings);
+      }
+    }
+  }
+}
+
+void configure_entity_differ(SnapshotDiffer &differ) {
+  const char *quantized_fields[] = {"pos", "size", "angle", "sight"};
+  for (auto field : quantized_fields) {
+    differ.setQuantum(field, RENDER_QUANTUM);
+  }
+  differ.setRemovedValue("alive", false);
+}
+
+// Replaces the full entity states in each render message with a delta from
+// what the client last acknowledged, and the tick that delta is against.
+// Adds the strings the client doesn't have yet, starting at known_strings.
+Json::Value encode_render(
+    const Json::Value &render,
+    DeltaEncoder &encoder,
+    const StringTable &strings,
+    uint32_t known_strings) {
+  Json::Value ret = render;
+  for (auto &message : ret) {
+    if (message["type"] != "render") {
+      continue;
+    }
+    int64_t baseline_tick;
+    message["entities"] = encoder.encode(
+        toTick(must_have_idx(message, "tick")),
+        must_have_idx(message, "t").asFloat(),
+        must_have_idx(message, "entities"),
+        baseline_tick);
+    message["baseline"] = toJson(baseline_tick);
+    if (known_strings < strings.size()) {
+      message["strings"]["first"] = known_strings;
+      message["strings"]["values"] = strings.getDefinitions(known_strings);
+    }
+  }
+  return ret;
+}
+
+// Snapshots go on the sequenced channel, where a newer one replaces any that
+// haven't gone out yet.  Everything else, including the chats pulled out of
+// the snapshots, must arrive and goes first on the reliable channel.
+void send_render(Connection &conn, Json::Value &render) {
+  Json::Value reliable(Json::arrayValue);
+  Json::Value sequenced(Json::arrayValue);
+  for (auto &message : render) {
+    if (message["type"] != "render") {
+      reliable.append(Json::Value());
+      reliable[reliable.size() - 1].swap(message);
+      continue;
+    }
+    Json::Value &chats = message["chats"];
+    if (!chats.empty()) {
+      Json::Value chat_message;
+      chat_message["type"] = "chat";
+      chat_message["chats"].swap(chats);
+      reliable.append(chat_message);
+      chats = Json::Value(Json::arrayValue);
+    }
+    sequenced.append(Json::Value());
+    sequenced[sequenced.size() - 1].swap(message);
+  }
+  if (!reliable.empty()) {
+    conn.sendPacket(reliable, NET_CHANNEL_RELIABLE);
+  }
+  if (!sequenced.empty()) {
+    conn.sendPacket(sequenced, NET_CHANNEL_SEQUENCED);
+  }
+}
+
+// Waits for the client's hello on udp_conn and tells it over tcp_conn which
+// transport the game is played on.  Falls back to TCP if no hello arrives in
+// time, e.g. when UDP is blocked.
+ConnectionPtr choose_transport(
+    NetConnectionPtr tcp_conn,
+    UDPConnectionPtr udp_conn) {
+  if (!udp_conn) {
+    return tcp_conn;
+  }
+  ConnectionPtr ret = tcp_conn;
+  try {
+    auto hello = udp_conn->readNext(
+        1000 * fltParam("network.handshake.timeout"));
+    if (hello["type"] == "hello") {
+      ret = udp_conn;
+    }
+  } catch (std::exception &e) {
+    LOG(WARNING) << "No UDP hello from "
+      << tcp_conn->getSocket()->getHostname() << ": " << e.what()
+      << ", falling back to TCP\n";
+  }
+  if (ret != udp_conn) {
+    udp_conn->stop();
+  }
+
+  Json::Value transport;
+  transport["type"] = "transport";
+  transport["name"] = ret == udp_conn ? "udp" : "tcp";
+  tcp_conn->sendPacket(transport);
+  return ret;
+}
+
+// Sends conn its game def, with pid as the local player.  If UDP is offered,
+// opens the player's UDP port, named in the game def, and returns its
+// connection.
+UDPConnectionPtr send_game_def(
+    NetConnectionPtr conn,
+    id_t pid,
+    const Json::Value &game_def) {
+  // Each client gets its own UDP port, so the socket tells clients apart
+  const bool offer_udp = !hasParam("network.transport")
+    || strParam("network.transport") == "udp";
+  auto personalized_game_def = game_def;
+  personalized_game_def["local_player_id"] = toJson(pid);
+  UDPConnectionPtr udp_conn;
+  if (offer_udp) {
+    auto udp_sock = kissnet::udp_socket::create();
+    udp_sock->bind("0");
+    personalized_game_def["udp_port"] = udp_sock->getLocalPort();
+    udp_conn.reset(new UDPConnection(udp_sock));
+    if (hasParam("local.link_impairment")) {
+      // Clients seed their end with odd numbers
+      udp_conn->setLinkSimulator(make_link_simulator(
+          getParam("local.link_impairment"),
+          2 * pid));
+    }
+  }
+  conn->sendPacket(personalized_game_def);
+  return udp_conn;
+}
+
+// Lets players whose connection dropped back into the running game.  Accepts
+// on the lobby's socket on its own thread, and gives a client named like a
+// dropped player that player's pid and the same handshake as in the lobby.
+class RejoinListener {
+ public:
+  RejoinListener(kissnet::tcp_socket_ptr sock, const Json::Value &game_def)
+    : sock_(sock),
+      gameDef_(game_def),
+      running_(true) {
+    thread_ = std::thread(std::bind(&RejoinListener::acceptFunc, this));
+  }
+  ~RejoinListener() {
+    running_ = false;
+    thread_.join();
+  }
+
+  // Lets a client rejoin as pid
+  void addDropped(id_t pid) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    dropped_.insert(pid);
+  }
+  // Returns a player that rejoined since the last call, if any
+  bool pop(id_t &pid, ConnectionPtr &conn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (rejoined_.empty()) {
+      return false;
+    }
+    pid = rejoined_.front().first;
+    conn = rejoined_.front().second;
+    rejoined_.pop_front();
+    return true;
+  }
+
+ private:
+  // Returns the dropped player named name, or NO_PLAYER
+  id_t claim(const std::string &name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto &&player_def : must_have_idx(gameDef_, "player_defs")) {
+      const id_t pid = toID(must_have_idx(player_def, "pid"));
+      if (dropped_.count(pid) && player_def["name"] == name) {
+        dropped_.erase(pid);
+        return pid;
+      }
+    }
+    return NO_PLAYER;
+  }
+
+  void acceptFunc() {
+    kissnet::socket_set sockets;
+    sockets.add_read_socket(sock_);
+    while (running_) {
+      double timeout = 0.1;
+      if (sockets.poll_sockets(timeout).empty()) {
+        continue;
+      }
+      NetConnectionPtr conn(new NetConnection(sock_->accept()));
+      id_t pid = NO_PLAYER;
+      try {
+        auto player_def = conn->readNext(500);
+        pid = claim(must_have_idx(player_def, "name").asString());
+        if (pid == NO_PLAYER) {
+          LOG(WARNING) << "No dropped player to rejoin as from "
+            << conn->getSocket()->getHostname() << '\n';
+          conn->stop();
+          continue;
+        }
+        auto game_conn = choose_transport(
+            conn,
+            send_game_def(conn, pid, gameDef_));
+        tcpConns_[pid] = conn;
+        std::unique_lock<std::mutex> lock(mutex_);
+        rejoined_.push_back(std::make_pair(pid, game_conn));
+      } catch (std::exception &e) {
+        LOG(WARNING) << "Rejoin failed: " << e.what() << '\n';
+        conn->stop();
+        if (pid != NO_PLAYER) {
+          addDropped(pid);
+        }
+      }
+    }
+  }
+
+  kissnet::tcp_socket_ptr sock_;
+  const Json::Value gameDef_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+  std::mutex mutex_;
+  // Guarded by mutex_
+  std::set<id_t> dropped_;
+  std::deque<std::pair<id_t, ConnectionPtr>> rejoined_;
+  // Only used by the accept thread.  Kept open like the lobby's.
+  std::map<id_t, NetConnectionPtr> tcpConns_;
+};
+
+std::string get_local_server_param(const std::string &name) {
+  std::string param = "local.server." + name;
+  return hasParam(param) ? strParam(param) : std::string();
+}
+
+// Snapshot files are the game def on a single line, followed by the snapshot
+// blob from GameServer::getSnapshot.
+void write_snapshot_file(
+    const std::string &filename,
+    const Json::Value &game_def,
+    const std::string &snapshot) {
+  namespace fs = boost::filesystem;
+  // Write to a temporary file and move it into place, so a crash mid write
+  // never leaves a truncated snapshot behind.
+  std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary);
+    if (!file) {
+      throw file_exception("Unable to open snapshot file " + tmp_filename);
+    }
+    Json::FastWriter writer;
+    file << writer.write(game_def);
+    file.write(snapshot.c_str(), snapshot.size());
+  }
+  fs::rename(tmp_filename, filename);
+}
+
+void read_snapshot_file(
+    const std::string &filename,
+    Json::Value &game_def,
+    std::string &snapshot) {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file) {
+    throw file_exception("Unable to open snapshot file " + filename);
+  }
+  std::string line;
+  Json::Reader reader;
+  if (!std::getline(file, line) || !reader.parse(line, game_def)) {
+    throw file_exception("Corrupt snapshot file " + filename);
+  }
+  snapshot.assign(
+      std::istreambuf_iterator<char>(file),
+      std::istreambuf_iterator<char>());
+}
+
+void game_server_loop(
+    Json::Value game_def,
+    std::vector<ConnectionPtr> connections,
+    const std::string &resume_snapshot,
+    RejoinListener &rejoins) {
   const float simrate = fltParam("game.simrate");
   const float simdt = 1.f / simrate;
 
   GameServer server;
-  server.start(game_def);
+  std::string trace_file = get_local_server_param("trace_file");
+  if (!trace_file.empty()) {
+    Tracer::get()->open(trace_file);
+    if (hasParam("local.server.profile_slow_ticks")
+        && intParam("local.server.profile_slow_ticks")) {
+      server.setSlowTickProfiling(0.5 * simdt);
+    }
+  }
+  // Resumed games carry on with the random state in their snapshot
+  const uint32_t seed = std::random_device()();
+  std::unique_ptr<ReplayWriter> replay;
+  std::string replay_file = get_local_server_param("replay_file");
+  // Replays start from tick 0, so resumed games are not recorded.
+  if (!replay_file.empty() && resume_snapshot.empty()) {
+    replay.reset(new ReplayWriter(replay_file));
+    replay->writeHeader(game_def, seed, simdt);
+    server.setReplayWriter(replay.get());
+  }
+  if (resume_snapshot.empty()) {
+    server.start(game_def, seed);
+  } else {
+    server.restore(game_def, resume_snapshot);
+    LOG(INFO) << "Resumed game at tick " << server.getTick() << '\n';
+  }
+
+  // Each client gets entity changes since the last render it acknowledged
+  SnapshotDiffer entity_differ;
+  configure_entity_differ(entity_differ);
+  std::vector<std::unique_ptr<DeltaEncoder>> encoders;
+  for (size_t i = 0; i < connections.size(); i++) {
+    encoders.emplace_back(new DeltaEncoder(entity_differ));
+  }
+  // Strings [0, n) of the table are known to each client
+  StringTable strings;
+  std::vector<uint32_t> known_strings(connections.size(), 0);
+
+  std::string snapshot_file = get_local_server_param("snapshot_file");
+  const int snapshot_interval = hasParam("local.server.snapshot_interval")
+    ? intParam("local.server.snapshot_interval")
+    : 0;
+
+  auto metrics = MetricsRegistry::get();
+  auto tick_time = metrics->histogram(
+      "rts_server_tick_seconds",
+      "Time to read input, simulate, send and snapshot one tick",
+      1e-6,
+      10000000);
+  auto send_time = metrics->histogram(
+      "rts_server_send_seconds",
+      "Time to send one tick's render to all players",
+      1e-6,
+      10000000);
+  auto late_ticks = metrics->counter(
+      "rts_server_late_ticks_total",
+      "Ticks that started after their scheduled time");
+  metrics->gauge("rts_server_players", "Connected players")
+    ->set(connections.size());
+  auto game_tick = metrics->gauge("rts_server_tick", "Current game tick");
+  // Connections are in pid order
+  std::vector<Counter *> player_bytes_sent;
+  std::vector<size_t> last_player_bytes_sent;
+  for (size_t i = 0; i < connections.size(); i++) {
+    player_bytes_sent.push_back(metrics->counter(
+        "rts_server_player_bytes_sent_total",
+        "Bytes sent to each player",
+        {{"pid", std::to_string(STARTING_PID + i)}}));
+    last_player_bytes_sent.push_back(connections[i]->getBytesSent());
+  }
+  std::string metrics_file = get_local_server_param("metrics_file");
+  const float metrics_interval = hasParam("local.server.metrics_interval")
+    ? fltParam("local.server.metrics_interval")
+    : 10.f;
 
   FPSCalculator updateTimer(10);
   Clock::time_point start = Clock::now();
+  // Clients sync to this clock, which reads about the game time of the render
+  // being sent: tick n's render is sent at start + n * simdt, and shows the
+  // game after n + 1 ticks.
+  const double start_game_time = (server.getTick() + 1) * simdt;
+  auto game_clock = [=]() {
+    return start_game_time
+      + std::chrono::duration<double>(Clock::now() - start).count();
+  };
+  for (auto &conn : connections) {
+    conn->setClock(game_clock);
+  }
+  // Dropped players are skipped until they rejoin
+  std::vector<bool> dropped(connections.size(), false);
   Clock::time_point last_net_stat = start;
+  Clock::time_point last_metrics_write = start;
   size_t last_bytes_down = 0, last_bytes_up = 0;
 	int tick_count = 0;
   float average_tick_duration = 0.f;
   while (server.isRunning()) {
     auto tick_start_time = Clock::now();
+    id_t rejoined_pid;
+    ConnectionPtr rejoined_conn;
+    while (rejoins.pop(rejoined_pid, rejoined_conn)) {
+      // Starts over like a new client, with a full baseline and all strings
+      const size_t i = rejoined_pid - STARTING_PID;
+      connections[i] = rejoined_conn;
+      connections[i]->setClock(game_clock);
+      encoders[i]->reset();
+      known_strings[i] = 0;
+      last_player_bytes_sent[i] = connections[i]->getBytesSent();
+      dropped[i] = false;
+      LOG(INFO) << "Player " << rejoined_pid << " rejoined at tick "
+        << server.getTick() << '\n';
+    }
+    for (size_t i = 0; i < connections.size(); i++) {
+      if (!dropped[i] && !connections[i]->running()) {
+        dropped[i] = true;
+        rejoins.addDropped(STARTING_PID + i);
+        LOG(WARNING) << "Player " << STARTING_PID + i << " dropped at tick "
+          << server.getTick() << '\n';
+      }
+    }
+
     // TODO(zack): add actions here
-    for (auto &&conn : connections) {
-      auto actions = conn->drainQueue();
+    for (size_t i = 0; i < connections.size(); i++) {
+      auto actions = connections[i]->drainQueue();
       for (auto&& action : actions) {
-        server.addAction(action);
+        if (action["type"] == "ack") {
+          encoders[i]->ack(toTick(must_have_idx(action, "tick")));
+          known_strings[i] = std::max(
+              known_strings[i],
+              std::min(
+                must_have_idx(action, "strings").asUInt(),
+                strings.size()));
+        } else {
+          server.addAction(action);
+        }
       }
     }
 
     auto render_start_time = Clock::now();
     auto render = server.update(simdt);
+    intern_render_strings(render, strings);
     auto render_duration = Clock::secondsSince(render_start_time);
     if (render_duration > 0.5 * simdt) {
       LOG(WARNING) << "long update time: " << render_duration << '\n';
     }
 
     auto send_start_time = Clock::now();
-    for (auto&& conn : connections) {
-      conn->sendPacket(render);
+    {
+      TraceSection send_section("send", "server");
+      record_section("send");
+      for (size_t i = 0; i < connections.size(); i++) {
+        if (dropped[i]) {
+          continue;
+        }
+        auto client_render = encode_render(
+            render,
+            *encoders[i],
+            strings,
+            known_strings[i]);
+        try {
+          send_render(*connections[i], client_render);
+        } catch (kissnet::socket_exception &e) {
+          // Noticed as dropped next tick
+          LOG(WARNING) << "Unable to send to player " << STARTING_PID + i
+            << ": " << e.what() << '\n';
+          connections[i]->stop();
+        }
+      }
     }
     auto send_duration = Clock::secondsSince(send_start_time);
+    send_time->record(send_duration);
+    for (size_t i = 0; i < connections.size(); i++) {
+      size_t bytes_sent = connections[i]->getBytesSent();
+      player_bytes_sent[i]->inc(bytes_sent - last_player_bytes_sent[i]);
+      last_player_bytes_sent[i] = bytes_sent;
+    }
     if (send_duration > 0.5 * simdt) {
       LOG(WARNING) << "long send time: " << send_duration << '\n';
     }
 
+    if (!snapshot_file.empty() && snapshot_interval > 0
+        && server.getTick() % snapshot_interval == 0) {
+      TraceSection snapshot_section("snapshot", "server");
+      record_section("snapshot");
+      auto snapshot_start_time = Clock::now();
+      write_snapshot_file(snapshot_file, game_def, server.getSnapshot());
+      auto snapshot_duration = Clock::secondsSince(snapshot_start_time);
+      if (snapshot_duration > 0.5 * simdt) {
+        LOG(WARNING) << "long snapshot time: " << snapshot_duration << '\n';
+      }
+    }
+
     auto tick_duration = Clock::secondsSince(tick_start_time);
     average_tick_duration = average_tick_duration * 0.95 + tick_duration * 0.05;
+    tick_time->record(tick_duration);
+    game_tick->set(server.getTick());
 
     // handle framerate
 		tick_count++;
 		float delay = simdt * tick_count - Clock::secondsSince(start);
+    if (delay < 0.f) {
+      late_ticks->inc();
+    }
     std::chrono::milliseconds delayms(static_cast<int>(1000 * delay));
     std::this_thread::sleep_for(delayms);
 
@@ -131,9 +615,26 @@ void game_server_loop(Json::Value game_def, std::vector<NetConnectionPtr> connec
       std::cout << "Downstream rate: " << down_bytes_per_second / 1024.f << " KB/s\n";
       std::cout << "Upstream rate: " << up_bytes_per_second / 1024.f << " KB/s\n";
       std::cout << "Average tick computation time: " << average_tick_duration << " s/tick\n";
+      if (Profiler::get()->isEnabled()) {
+        std::cout << Profiler::get()->report();
+      }
       last_net_stat = Clock::now();
     }
+    if (!metrics_file.empty()
+        && Clock::secondsSince(last_metrics_write) > metrics_interval) {
+      try {
+        metrics->writePrometheusFile(metrics_file);
+      } catch (file_exception &e) {
+        LOG(ERROR) << "Unable to write metrics: " << e.what() << '\n';
+      }
+      last_metrics_write = Clock::now();
+    }
+  }
+
+  if (replay) {
+    replay->close(server.getTick());
   }
+  Tracer::get()->close();
 }
 
 void lobby_main(std::string listen_port, size_t num_players, size_t num_dummy_players, std::string map_name) {
@@ -193,12 +694,28 @@ void lobby_main(std::string listen_port, size_t num_players, size_t num_dummy_pl
   game_def["map_def"] = get_map_definition(map_name);
   game_def["vps_to_win"] = fltParam("global.pointsToWin");
 
+  // When resuming, the players are assumed to reconnect in the same order, so
+  // they are assigned the same pids as in the original game.
+  std::string resume_snapshot;
+  std::string resume_file = get_local_server_param("resume_file");
+  if (!resume_file.empty()) {
+    read_snapshot_file(resume_file, game_def, resume_snapshot);
+  }
+
+  std::map<id_t, UDPConnectionPtr> pid_to_udp;
+  for (auto &pair : pid_to_conn) {
+    pid_to_udp[pair.first] = send_game_def(pair.second, pair.first, game_def);
+  }
+
+  // The TCP connections stay open, but are only used when UDP isn't
+  std::vector<ConnectionPtr> game_conns;
   for (auto &pair : pid_to_conn) {
-    auto personalized_game_def = game_def;
-    personalized_game_def["local_player_id"] = toJson(pair.first);
-    pair.second->sendPacket(personalized_game_def);
+    game_conns.push_back(
+        choose_transport(pair.second, pid_to_udp[pair.first]));
   }
 
-  game_server_loop(game_def, conns);
+  // Players that drop reconnect to the same port
+  RejoinListener rejoins(server_sock, game_def);
+  game_server_loop(game_def, game_conns, resume_snapshot, rejoins);
 }
 };
\ No newline at end of file
@@ -1,7 +1,24 @@
+#include <cstdint>
 #include <string>
+#include <json/json.h>
+
+class DeltaEncoder;
+class SnapshotDiffer;
+class StringTable;
 
 namespace rts {
 
 void lobby_main(std::string listen_port, size_t num_players, size_t num_dummy_players, std::string map_name);
 
-};
\ No newline at end of file
+// Replaces the names, icons and tooltips in entity renders with string ids.
+void intern_render_strings(Json::Value &render, StringTable &strings);
+// Sets how entity renders are diffed for clients
+void configure_entity_differ(SnapshotDiffer &differ);
+// Encodes the messages of a tick for one client, as they are sent to it.
+Json::Value encode_render(
+    const Json::Value &render,
+    DeltaEncoder &encoder,
+    const StringTable &strings,
+    uint32_t known_strings);
+
+};
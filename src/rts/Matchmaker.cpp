@@ -1,9 +1,12 @@
 #include "rts/Matchmaker.h"
 #include <boost/algorithm/string.hpp>
 #include <sstream>
+#include "common/Exception.h"
 #include "common/kissnet.h"
+#include "common/Logger.h"
 #include "common/NetConnection.h"
 #include "common/ParamReader.h"
+#include "common/UDPConnection.h"
 #include "common/util.h"
 #include "rts/Game.h"
 #include "rts/Lobby.h"
@@ -123,15 +126,64 @@ Game* Matchmaker::connectToServer(const std::string &addr, const std::string &po
   }
 
 
+  // Game messages are decoded as they are read, see Game::readMessages.
+  // Everything before them is a single object.
+  client_conn->setRawBatches(true);
+
+  // The server offers UDP, and tells us whether our hello got through
+  ConnectionPtr game_conn = client_conn;
+  if (game_def.isMember("udp_port")) {
+    auto udp_sock = kissnet::udp_socket::create();
+    udp_sock->bind("0");
+    udp_sock->connect(
+        client_conn->getSocket()->getHostname(),
+        game_def["udp_port"].asString());
+    UDPConnectionPtr udp_conn(new UDPConnection(udp_sock));
+    udp_conn->setRawBatches(true);
+    if (hasParam("local.link_impairment")) {
+      udp_conn->setLinkSimulator(make_link_simulator(
+          getParam("local.link_impairment"),
+          2 * local_pid + 1));
+    }
+    Json::Value hello;
+    hello["type"] = "hello";
+    udp_conn->sendPacket(hello);
+
+    auto transport = client_conn->readNext();
+    if (must_have_idx(transport, "name") == "udp") {
+      game_conn = udp_conn;
+    } else {
+      LOG(WARNING) << "Server didn't get UDP hello, playing over TCP\n";
+      udp_conn->stop();
+    }
+  }
+
+  // Acks only matter until a newer one is sent
   auto action_func = [=](const Json::Value &v) {
-    client_conn->sendPacket(v);
+    game_conn->sendPacket(
+        v,
+        v["type"] == "ack" ? NET_CHANNEL_SEQUENCED : NET_CHANNEL_RELIABLE);
   };
-  auto render_provider = [=]() -> Json::Value {
-    // TODO(zack): handle exceptions here
-    return client_conn->readNext();
+  // Holds client_conn so the TCP connection stays open as long as the game
+  auto render_provider = [game_conn, client_conn](
+      size_t millis,
+      std::string &batch) {
+    // TODO(zack): handle network exceptions here
+    try {
+      batch = game_conn->readNextBatch(millis);
+      return true;
+    } catch (timeout_exception &e) {
+      return false;
+    }
   };
 
-  return new Game(map, players, render_provider, action_func);
+  // Render time follows the server's clock
+  game_conn->setPingInterval(fltParam("network.ping_interval"));
+  Game *game = new Game(map, players, render_provider, action_func);
+  game->setServerClock([game_conn](double &t) {
+    return game_conn->getRemoteTime(t);
+  });
+  return game;
 }
 
 Game* Matchmaker::doSinglePlayerSetup() {
@@ -93,13 +93,21 @@ void MinimapWidget::render(float dt) {
   
   const LocalPlayer *localPlayer = (LocalPlayer *)Game::get()->getPlayer(localPlayerID_);
   id_t teamID_ = localPlayer->getTeamID();
+
+  static Param<glm::vec3> defaultColor("global.defaultColor");
+  static Param<glm::vec3> neutralColor("colors.minimap.neutral");
+  static Param<glm::vec3> localSelectedColor("colors.minimap.local_selected");
+  static Param<glm::vec3> localColor("colors.minimap.local");
+  static Param<glm::vec3> allyColor("colors.minimap.ally");
+  static Param<glm::vec3> enemyColor("colors.minimap.enemy");
+  const glm::vec2 actorSize = glm::vec2(fltParam(name_ + ".actorSize"));
     
   // render actors
-  for (const auto &pair : Renderer::get()->getEntities()) {
-    if (!pair.second->hasProperty(GameEntity::P_ACTOR)) {
+  for (const ModelEntity *entity : Renderer::get()->getEntities()) {
+    if (!entity->hasProperty(GameEntity::P_ACTOR)) {
       continue;
     }
-    const GameEntity *e = (const GameEntity *)pair.second;
+    const GameEntity *e = (const GameEntity *)entity;
     if (!e->isVisible()) {
       continue;
     }
@@ -107,22 +115,21 @@ void MinimapWidget::render(float dt) {
     const Player *player = Game::get()->getPlayer(e->getPlayerID(t));
     glm::vec3 pcolor; 
     if (colorScheme == 0) {
-      pcolor = player ? player->getColor() : vec3Param("global.defaultColor");
+      pcolor = player ? player->getColor() : defaultColor.get();
     } else {
       if (!player) { //no player
-        pcolor =  vec3Param("colors.minimap.neutral");
+        pcolor =  neutralColor.get();
       } else if (localPlayer->isSelected(e->getGameID())) { //selected
-        pcolor = vec3Param("colors.minimap.local_selected");
+        pcolor = localSelectedColor.get();
       } else if (player->getPlayerID() == localPlayerID_) { //local player
-        pcolor = vec3Param("colors.minimap.local");
+        pcolor = localColor.get();
       } else if (player->getTeamID() == teamID_) { //on same team
-        pcolor = vec3Param("colors.minimap.ally");
+        pcolor = allyColor.get();
       } else { //enemy
-        pcolor = vec3Param("colors.minimap.enemy");
+        pcolor = enemyColor.get();
       }
     }
-    std::string icon_name = e->getUIInfo(t).minimap_icon;
-    glm::vec2 actorSize = glm::vec2(fltParam(name_ + ".actorSize"));
+    InternedString icon_name = e->getUIInfo(t).minimap_icon;
     if (!icon_name.empty()) {
       drawTextureCenter(
           pos,
@@ -2,15 +2,22 @@
 #include "rts/ModelEntity.h"
 #include "common/ParamReader.h"
 #include "rts/Map.h"
+#include "rts/Renderer.h"
 #include "rts/ResourceManager.h"
 
 namespace rts {
 
-ModelEntity::ModelEntity(id_t id)
-  : id_(id),
+// Seconds a moving entity keeps moving when its next position is late
+const float MAX_EXTRAPOLATION = 0.25f;
+
+ModelEntity::ModelEntity()
+  : id_(NO_ENTITY),
     posCurve_(glm::vec3(0.f)),
     angleCurve_(0.f),
     sizeCurve_(glm::vec3(0.f)),
+    predicted_(false),
+    predictedPosCurve_(glm::vec3(0.f)),
+    predictedAngleCurve_(0.f),
     color_(0.f),
     scale_(1.f),
     visible_(true) {
@@ -19,6 +26,19 @@ ModelEntity::ModelEntity(id_t id)
 ModelEntity::~ModelEntity() {
 }
 
+void ModelEntity::reset() {
+  invariant(id_ == NO_ENTITY, "cannot reset a spawned entity");
+  posCurve_.reset(glm::vec3(0.f));
+  angleCurve_.reset(0.f);
+  sizeCurve_.reset(glm::vec3(0.f));
+  clearPrediction();
+  visible_ = true;
+  meshName_.clear();
+  color_ = glm::vec3(0.f);
+  scale_ = glm::vec3(1.f);
+  renderFuncs_.clear();
+}
+
 
 glm::vec2 ModelEntity::getSize2(float t) const {
   return glm::vec2(getSize3(t));
@@ -47,6 +67,20 @@ void ModelEntity::setAngle(float t, float angle) {
 	angleCurve_.addKeyframe(t, angle);
 }
 
+void ModelEntity::setPrediction(float t, const glm::vec2 &pos, float angle) {
+  predicted_ = true;
+  predictedPosCurve_.addKeyframe(t, glm::vec3(pos, 0.f));
+  predictedAngleCurve_.addKeyframe(t, angle);
+}
+void ModelEntity::clearPrediction() {
+  if (!predicted_) {
+    return;
+  }
+  predicted_ = false;
+  predictedPosCurve_.reset(glm::vec3(0.f));
+  predictedAngleCurve_.reset(0.f);
+}
+
 bool ModelEntity::isVisible() const {
   return visible_;
 }
@@ -91,9 +125,10 @@ void ModelEntity::render(float t) {
   meshShader->uniform3f("baseColor", color_);
   // TODO(zack): add 'extra shader setup' hook here
   Model * mesh = ResourceManager::get()->getModel(meshName_);
-  ::renderModel(transform, mesh);
+  ::renderModel(transform, mesh, meshShader);
 
-  if (fltParam("local.debug.renderBoundingBox")) {
+  static Param<float> renderBoundingBox("local.debug.renderBoundingBox");
+  if (renderBoundingBox.get()) {
     auto shader = ResourceManager::get()->getShader("color");
     shader->makeActive();
     shader->uniform4f("color", glm::vec4(0.8f, 0.3f, 0.3f, 0.6f));
@@ -103,7 +138,8 @@ void ModelEntity::render(float t) {
         glm::scale(
           glm::translate(glm::mat4(1.f), pos),
           0.5f * getSize3(t)),
-        ResourceManager::get()->getModel("cube"));
+        ResourceManager::get()->getModel("cube"),
+        shader);
   }
 
   // Now render additional effects
@@ -134,10 +170,30 @@ glm::vec2 ModelEntity::getPosition2(float t) const {
 }
 
 glm::vec3 ModelEntity::getPosition(float t) const {
-  return posCurve_.linearSample(t);
+  if (predicted_) {
+    return predictedPosCurve_.linearSample(t);
+  }
+  return posCurve_.extrapolatedSample(
+      t,
+      Renderer::get()->getSnapshotHorizon(),
+      MAX_EXTRAPOLATION);
 }
 
 float ModelEntity::getAngle(float t) const {
+  if (predicted_) {
+    return predictedAngleCurve_.linearSample(t);
+  }
+  return angleCurve_.linearSample(t);
+}
+
+glm::vec2 ModelEntity::getServerPosition2(float t) const {
+  return glm::vec2(posCurve_.extrapolatedSample(
+      t,
+      Renderer::get()->getSnapshotHorizon(),
+      MAX_EXTRAPOLATION));
+}
+
+float ModelEntity::getServerAngle(float t) const {
   return angleCurve_.linearSample(t);
 }
 
@@ -10,18 +10,22 @@
 namespace rts {
 
 typedef std::function<bool(float)> RenderFunction;
+// Entity properties, one bit each.  The scripts and the wire use hashed
+// ids instead, see property_from_id in rts/RenderSnapshot.h.
+typedef uint64_t property_mask;
 
 class ModelEntity {
 public:
-  ModelEntity(id_t id);
+  ModelEntity();
   virtual ~ModelEntity();
 
-  static const uint32_t P_COLLIDABLE = 983556954;
+  static const property_mask P_COLLIDABLE = 1 << 0;
 
+  // NO_ENTITY until spawned in the renderer
   id_t getID() const {
     return id_;
   }
-  virtual bool hasProperty(uint32_t property) const {
+  virtual bool hasProperty(property_mask property) const {
     return false;
   }
 
@@ -31,11 +35,14 @@ public:
   // Returns this entities height
   float getHeight(float t) const;
 
-  // Interpolation functions
+  // Interpolation functions, these follow the prediction if there is one
   glm::vec2 getPosition2(float t) const;
   glm::vec3 getPosition(float t) const;
   glm::vec2 getDirection(float t);
   float getAngle(float t) const;
+  // Where the server last put this entity, ignoring any prediction
+  glm::vec2 getServerPosition2(float t) const;
+  float getServerAngle(float t) const;
   glm::mat4 getTransform(float t) const;
   const Rect getRect(float t) const;
   bool isVisible() const;
@@ -47,6 +54,14 @@ public:
 
   void setSize(float t, const glm::vec3 &size);
 
+  // Predicted samples are shown instead of the server's until the
+  // prediction is cleared.
+  void setPrediction(float t, const glm::vec2 &pos, float angle);
+  void clearPrediction();
+  bool hasPrediction() const {
+    return predicted_;
+  }
+
   // Graphics setters
   void setModelName(const std::string &meshName);
   void setModelName(std::string &&meshName);
@@ -58,14 +73,24 @@ public:
   void render(float t);
 
 protected:
+  // Makes this a new entity, keeping the memory it has.  Must not be
+  // spawned.
+  void reset();
   virtual void preRender(float t) { }
 
 private:
+  // Assigns ids
+  friend class Renderer;
+
   id_t id_;
   Vec3Curve posCurve_;
 	FloatCurve angleCurve_;
   Vec3Curve sizeCurve_;
 
+  bool predicted_;
+  Vec3Curve predictedPosCurve_;
+  FloatCurve predictedAngleCurve_;
+
   bool visible_;
 
   std::string meshName_;
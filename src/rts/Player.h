@@ -75,34 +75,54 @@ class LocalPlayer : public Player {
     return true;
   }
 
-  void setSelection(const std::set<std::string> &selection) {
+  void setSelection(const std::set<id_t> &selection) {
     selection_ = selection;
   }
-  bool isSelected(const std::string &game_id) const {
+  bool isSelected(id_t game_id) const {
     return selection_.find(game_id) != selection_.end();
   }
-  const std::set<std::string>& getSelection() const {
+  const std::set<id_t>& getSelection() const {
     return selection_;
   }
 
-  virtual void addSavedSelection(char hotkey, const std::set<std::string> &sel) {
+  virtual void addSavedSelection(char hotkey, const std::set<id_t> &sel) {
     savedSelections_[hotkey] = sel;
   }
-  const std::map<char, std::set<std::string>> getSavedSelections() const {
+  const std::map<char, std::set<id_t>> getSavedSelections() const {
     return savedSelections_;
   }
-  std::set<std::string> getSavedSelection(char hotkey) const {
+  std::set<id_t> getSavedSelection(char hotkey) const {
     auto it = savedSelections_.find(hotkey);
     if (it == savedSelections_.end()) {
-      return std::set<std::string>();
+      return std::set<id_t>();
     }
     return it->second;
   }
+  // Removes the ids keep returns false for from the selection and from
+  // every saved selection
+  template<class F>
+  void filterSelections(F keep) {
+    filterSelection(selection_, keep);
+    for (auto &pair : savedSelections_) {
+      filterSelection(pair.second, keep);
+    }
+  }
 
 
  private:
-  std::set<std::string> selection_;
-  std::map<char, std::set<std::string>> savedSelections_;
+  template<class F>
+  static void filterSelection(std::set<id_t> &selection, F keep) {
+    for (auto it = selection.begin(); it != selection.end(); ) {
+      if (keep(*it)) {
+        ++it;
+      } else {
+        selection.erase(it++);
+      }
+    }
+  }
+
+  std::set<id_t> selection_;
+  std::map<char, std::set<id_t>> savedSelections_;
 };
 
 class DummyPlayer : public Player {
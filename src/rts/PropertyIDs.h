@@ -0,0 +1,34 @@
+#ifndef SRC_RTS_PROPERTYIDS_H_
+#define SRC_RTS_PROPERTYIDS_H_
+#include <cstdint>
+
+namespace rts {
+
+// The hashed ids the scripts give entity properties, as defined in
+// EntityProperties in scripts/constants.js.  Renders send these, and
+// PropertyIDsTest checks that both sides agree.
+const uint32_t P_CAPPABLE_ID    = 815586235;
+const uint32_t P_TARGETABLE_ID  = 463132888;
+const uint32_t P_ACTOR_ID       = 913794634;
+const uint32_t P_COLLIDABLE_ID  = 983556954;
+const uint32_t P_MOBILE_ID      = 1122719651;
+const uint32_t P_UNIT_ID        = 118468328;
+
+struct script_property_id {
+  const char *name;
+  uint32_t id;
+};
+
+// By their name in scripts/constants.js
+const script_property_id SCRIPT_PROPERTY_IDS[] = {
+  {"P_CAPPABLE", P_CAPPABLE_ID},
+  {"P_TARGETABLE", P_TARGETABLE_ID},
+  {"P_ACTOR", P_ACTOR_ID},
+  {"P_COLLIDABLE", P_COLLIDABLE_ID},
+  {"P_MOBILE", P_MOBILE_ID},
+  {"P_UNIT", P_UNIT_ID},
+};
+
+};  // rts
+
+#endif  // SRC_RTS_PROPERTYIDS_H_
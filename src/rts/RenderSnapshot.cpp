@@ -0,0 +1,778 @@
+#include "rts/RenderSnapshot.h"
+#include <cstdlib>
+#include <map>
+#include "common/Exception.h"
+#include "common/util.h"
+#include "rts/PropertyIDs.h"
+
+namespace rts {
+
+struct property_id {
+  uint32_t id;
+  property_mask property;
+};
+
+// The properties the client checks
+static const property_id PROPERTY_IDS[] = {
+  {P_COLLIDABLE_ID, ModelEntity::P_COLLIDABLE},
+  {P_TARGETABLE_ID, GameEntity::P_TARGETABLE},
+  {P_CAPPABLE_ID, GameEntity::P_CAPPABLE},
+  {P_ACTOR_ID, GameEntity::P_ACTOR},
+  {P_MOBILE_ID, GameEntity::P_MOBILE},
+  {P_UNIT_ID, GameEntity::P_UNIT},
+};
+
+property_mask property_from_id(uint32_t id) {
+  for (const auto &property_id : PROPERTY_IDS) {
+    if (property_id.id == id) {
+      return property_id.property;
+    }
+  }
+  return 0;
+}
+
+// Entities are keyed by game id in renders, JSON keys are strings
+static id_t game_id_from_key(const std::string &key) {
+  char *end;
+  const id_t game_id = strtoull(key.c_str(), &end, 10);
+  if (key.empty() || *end != '\0' || game_id == NO_ENTITY) {
+    throw network_exception("bad entity id " + key);
+  }
+  return game_id;
+}
+
+static UIAction UIActionFromJSON(const Json::Value &v, const StringTable &strings) {
+  UIAction uiaction;
+  uiaction.name = strings.get(must_have_idx(v, "name"));
+  uiaction.icon = strings.get(must_have_idx(v, "icon"));
+  auto&& hotkey_str = must_have_idx(v, "hotkey").asString();
+  uiaction.hotkey = !hotkey_str.empty() ? hotkey_str[0] : '\0';
+  uiaction.tooltip = strings.get(must_have_idx(v, "tooltip"));
+  uiaction.targeting = static_cast<UIAction::TargetingType>(
+      must_have_idx(v, "targeting").asInt());
+  uiaction.range = must_have_idx(v, "range").asFloat();
+  uiaction.radius = must_have_idx(v, "radius").asFloat();
+  uiaction.state = static_cast<UIAction::ActionState>(
+      must_have_idx(v, "state").asInt());
+  uiaction.cooldown = must_have_idx(v, "cooldown").asFloat();
+
+  return uiaction;
+}
+
+static GameEntity::UIPart UIPartFromJSON(
+    const Json::Value &v,
+    const StringTable &strings) {
+  GameEntity::UIPart ret;
+  ret.health = toVec2(must_have_idx(v, "health"));
+  ret.name = strings.get(must_have_idx(v, "name"));
+  ret.tooltip = strings.get(must_have_idx(v, "tooltip"));
+  for (auto &&json_upgrade : must_have_idx(v, "upgrades")) {
+    GameEntity::UIPartUpgrade upgrade;
+    upgrade.name = strings.get(must_have_idx(json_upgrade, "name"));
+    upgrade.part = ret.name;
+    ret.upgrades.push_back(upgrade);
+  }
+  return ret;
+}
+
+static GameEntity::UIInfo UIInfoFromJSON(
+    const Json::Value &v,
+    const StringTable &strings) {
+  GameEntity::UIInfo ret;
+  if (v.isMember("minimap_icon")) {
+    ret.minimap_icon = strings.get(v["minimap_icon"]);
+  }
+  if (v.isMember("mana")) {
+    ret.mana = toVec2(v["mana"]);
+  }
+  if (v.isMember("retreat")) {
+    ret.retreat = v["retreat"].asBool();
+  }
+  if (v.isMember("capture")) {
+    ret.capture = toVec2(v["capture"]);
+  }
+  if (v.isMember("capture_pid")) {
+    ret.capture_pid = toID(v["capture_pid"]);
+  }
+  if (v.isMember("path")) {
+    for (auto &&pt : v["path"]) {
+      ret.path.push_back(glm::vec3(toVec2(pt), 0.));
+    }
+  }
+  if (v.isMember("parts")) {
+    for (auto &&json_part : v["parts"]) {
+      ret.parts.push_back(UIPartFromJSON(json_part, strings));
+    }
+  }
+  if (v.isMember("hotkey")) {
+    auto&& hotkeystr = v["hotkey"].asString();
+    ret.hotkey = hotkeystr.empty() ? '\0' : hotkeystr[0];
+  }
+  if (v.isMember("extra")) {
+    ret.extra = v["extra"];
+  }
+  return ret;
+}
+
+static void decode_entity(
+    id_t game_id,
+    const Json::Value &v,
+    const StringTable &strings,
+    entity_snapshot &e) {
+  e.game_id = game_id;
+  if (v.isMember("alive")) {
+    for (auto &sample : v["alive"]) {
+      e.alive.emplace_back(sample[0].asFloat(), sample[1].asBool());
+    }
+  }
+  if (v.isMember("model")) {
+    for (auto &sample : v["model"]) {
+      e.model.emplace_back(sample[0].asFloat(), sample[1].asString());
+    }
+  }
+  if (v.isMember("properties")) {
+    for (auto &sample : v["properties"]) {
+      for (auto &prop : sample[1]) {
+        e.properties |= property_from_id(prop.asUInt());
+      }
+    }
+  }
+  if (v.isMember("pid")) {
+    for (auto &sample : v["pid"]) {
+      e.pid.emplace_back(sample[0].asFloat(), toID(sample[1]));
+    }
+  }
+  if (v.isMember("tid")) {
+    for (auto &sample : v["tid"]) {
+      e.tid.emplace_back(sample[0].asFloat(), toID(sample[1]));
+    }
+  }
+  if (v.isMember("pos")) {
+    for (auto &sample : v["pos"]) {
+      e.pos.emplace_back(sample[0].asFloat(), toVec2(sample[1]));
+    }
+  }
+  if (v.isMember("size")) {
+    for (auto &sample : v["size"]) {
+      e.size.emplace_back(sample[0].asFloat(), toVec3(sample[1]));
+    }
+  }
+  if (v.isMember("angle")) {
+    for (auto &sample : v["angle"]) {
+      e.angle.emplace_back(sample[0].asFloat(), sample[1].asFloat());
+    }
+  }
+  if (v.isMember("sight")) {
+    for (auto &sample : v["sight"]) {
+      e.sight.emplace_back(sample[0].asFloat(), sample[1].asFloat());
+    }
+  }
+  if (v.isMember("speed")) {
+    for (auto &sample : v["speed"]) {
+      e.speed.emplace_back(sample[0].asFloat(), sample[1].asFloat());
+    }
+  }
+  if (v.isMember("visible")) {
+    for (auto &sample : v["visible"]) {
+      VisibilitySet set;
+      for (auto pid : sample[1]) {
+        set.insert(toID(pid));
+      }
+      e.visible.emplace_back(sample[0].asFloat(), std::move(set));
+    }
+  }
+  if (v.isMember("actions")) {
+    for (auto &sample : v["actions"]) {
+      std::vector<UIAction> actions;
+      for (auto &action_json : sample[1]) {
+        auto uiaction = UIActionFromJSON(action_json, strings);
+        uiaction.owner_id = game_id;
+        actions.push_back(uiaction);
+      }
+      e.actions.emplace_back(sample[0].asFloat(), std::move(actions));
+    }
+  }
+  if (v.isMember("ui_info")) {
+    for (auto &&sample : v["ui_info"]) {
+      e.ui_info.emplace_back(
+          sample[0].asFloat(),
+          UIInfoFromJSON(sample[1], strings));
+    }
+  }
+}
+
+void decode_render(
+    const Json::Value &v,
+    StringTable &strings,
+    render_snapshot &snapshot) {
+  if (v.isMember("strings")) {
+    const Json::Value &defs = v["strings"];
+    strings.define(
+        must_have_idx(defs, "first").asUInt(),
+        must_have_idx(defs, "values"));
+  }
+  snapshot.t = must_have_idx(v, "t").asFloat();
+  snapshot.dt = must_have_idx(v, "dt").asFloat();
+
+  const Json::Value &entities = must_have_idx(v, "entities");
+  invariant(entities.isObject(), "should have entities array");
+  snapshot.entities.resize(entities.size());
+  size_t i = 0;
+  for (auto it = entities.begin(); it != entities.end(); it++, i++) {
+    decode_entity(
+        game_id_from_key(it.key().asString()),
+        *it,
+        strings,
+        snapshot.entities[i]);
+  }
+
+  snapshot.events = must_have_idx(v, "events");
+  invariant(snapshot.events.isArray(), "events must be array");
+
+  const Json::Value &players = must_have_idx(v, "players");
+  invariant(players.isArray(), "players must be array");
+  for (auto &&player : players) {
+    player_snapshot p;
+    p.pid = toID(must_have_idx(player, "pid"));
+    p.requisition = must_have_idx(player, "req").asFloat();
+    p.power = must_have_idx(player, "power").asFloat();
+    snapshot.players.push_back(p);
+  }
+
+  for (auto &&team : must_have_idx(v, "teams")) {
+    team_snapshot s;
+    s.tid = toID(must_have_idx(team, "tid"));
+    s.victory_points = must_have_idx(team, "vps").asFloat();
+    snapshot.teams.push_back(s);
+  }
+
+  snapshot.chats = must_have_idx(v, "chats");
+}
+
+render_snapshot::render_snapshot()
+  : t(0.f),
+    dt(0.f),
+    events(Json::arrayValue),
+    chats(Json::arrayValue) {
+}
+
+server_message::server_message()
+  : winning_team(NO_TEAM) {
+}
+
+// State of one pass of decode_message
+struct message_reader {
+  message_reader(JsonCursor &c, const StringTable &s)
+    : cursor(c),
+      strings(s),
+      unresolved(false) {
+  }
+
+  JsonCursor &cursor;
+  const StringTable &strings;
+  // Set when a string id isn't defined yet
+  bool unresolved;
+  // Reused for every key
+  std::string key;
+};
+
+// Skips what is left of the current array
+static void finish_array(JsonCursor &cursor) {
+  while (cursor.nextElement()) {
+    cursor.skipValue();
+  }
+}
+
+static InternedString read_string_id(message_reader &r) {
+  const uint64_t id = r.cursor.readUInt64();
+  if (id >= r.strings.size()) {
+    r.unresolved = true;
+    return InternedString();
+  }
+  return r.strings.get(id);
+}
+
+static char read_hotkey(message_reader &r) {
+  r.cursor.readString(r.key);
+  return r.key.empty() ? '\0' : r.key[0];
+}
+
+static glm::vec2 read_vec2(JsonCursor &cursor) {
+  glm::vec2 ret;
+  cursor.beginArray();
+  for (int i = 0; i < 2 && cursor.nextElement(); i++) {
+    ret[i] = cursor.readFloat();
+  }
+  finish_array(cursor);
+  return ret;
+}
+
+static glm::vec3 read_vec3(JsonCursor &cursor) {
+  glm::vec3 ret;
+  cursor.beginArray();
+  for (int i = 0; i < 3 && cursor.nextElement(); i++) {
+    ret[i] = cursor.readFloat();
+  }
+  finish_array(cursor);
+  return ret;
+}
+
+// Reads [[t, value], ...], with read_value reading each value
+template<typename T, typename F>
+static void read_samples(
+    message_reader &r,
+    typename entity_samples<T>::type &samples,
+    F read_value) {
+  JsonCursor &cursor = r.cursor;
+  cursor.beginArray();
+  while (cursor.nextElement()) {
+    cursor.beginArray();
+    if (!cursor.nextElement()) {
+      continue;
+    }
+    const float t = cursor.readFloat();
+    if (cursor.nextElement()) {
+      samples.emplace_back(t, read_value());
+    }
+    finish_array(cursor);
+  }
+}
+
+static UIAction read_action(message_reader &r) {
+  UIAction uiaction = UIAction();
+  JsonCursor &cursor = r.cursor;
+  cursor.beginObject();
+  while (cursor.nextKey(r.key)) {
+    if (r.key == "name") {
+      uiaction.name = read_string_id(r);
+    } else if (r.key == "icon") {
+      uiaction.icon = read_string_id(r);
+    } else if (r.key == "hotkey") {
+      uiaction.hotkey = read_hotkey(r);
+    } else if (r.key == "tooltip") {
+      uiaction.tooltip = read_string_id(r);
+    } else if (r.key == "targeting") {
+      uiaction.targeting = static_cast<UIAction::TargetingType>(
+          cursor.readUInt64());
+    } else if (r.key == "range") {
+      uiaction.range = cursor.readFloat();
+    } else if (r.key == "radius") {
+      uiaction.radius = cursor.readFloat();
+    } else if (r.key == "state") {
+      uiaction.state = static_cast<UIAction::ActionState>(
+          cursor.readUInt64());
+    } else if (r.key == "cooldown") {
+      uiaction.cooldown = cursor.readFloat();
+    } else {
+      cursor.skipValue();
+    }
+  }
+  return uiaction;
+}
+
+static GameEntity::UIPart read_part(message_reader &r) {
+  GameEntity::UIPart ret;
+  JsonCursor &cursor = r.cursor;
+  cursor.beginObject();
+  while (cursor.nextKey(r.key)) {
+    if (r.key == "health") {
+      ret.health = read_vec2(cursor);
+    } else if (r.key == "name") {
+      ret.name = read_string_id(r);
+    } else if (r.key == "tooltip") {
+      ret.tooltip = read_string_id(r);
+    } else if (r.key == "upgrades") {
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        GameEntity::UIPartUpgrade upgrade;
+        cursor.beginObject();
+        while (cursor.nextKey(r.key)) {
+          if (r.key == "name") {
+            upgrade.name = read_string_id(r);
+          } else {
+            cursor.skipValue();
+          }
+        }
+        ret.upgrades.push_back(upgrade);
+      }
+    } else {
+      cursor.skipValue();
+    }
+  }
+  // The name may come after the upgrades
+  for (auto &upgrade : ret.upgrades) {
+    upgrade.part = ret.name;
+  }
+  return ret;
+}
+
+static GameEntity::UIInfo read_ui_info(message_reader &r) {
+  GameEntity::UIInfo ret;
+  JsonCursor &cursor = r.cursor;
+  cursor.beginObject();
+  while (cursor.nextKey(r.key)) {
+    if (r.key == "minimap_icon") {
+      ret.minimap_icon = read_string_id(r);
+    } else if (r.key == "mana") {
+      ret.mana = read_vec2(cursor);
+    } else if (r.key == "retreat") {
+      ret.retreat = cursor.readBool();
+    } else if (r.key == "capture") {
+      ret.capture = read_vec2(cursor);
+    } else if (r.key == "capture_pid") {
+      ret.capture_pid = cursor.readUInt64();
+    } else if (r.key == "path") {
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        ret.path.push_back(glm::vec3(read_vec2(cursor), 0.));
+      }
+    } else if (r.key == "parts") {
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        ret.parts.push_back(read_part(r));
+      }
+    } else if (r.key == "hotkey") {
+      ret.hotkey = read_hotkey(r);
+    } else if (r.key == "extra") {
+      cursor.readValue(ret.extra);
+    } else {
+      cursor.skipValue();
+    }
+  }
+  return ret;
+}
+
+static void read_entity(message_reader &r, entity_snapshot &e) {
+  JsonCursor &cursor = r.cursor;
+  cursor.beginObject();
+  while (cursor.nextKey(r.key)) {
+    if (r.key == "alive") {
+      read_samples<bool>(r, e.alive, [&]() {
+        return cursor.readBool();
+      });
+    } else if (r.key == "model") {
+      read_samples<std::string>(r, e.model, [&]() {
+        return cursor.readString();
+      });
+    } else if (r.key == "properties") {
+      // Properties are only ever added, so the sample times don't matter
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        cursor.beginArray();
+        if (!cursor.nextElement()) {
+          continue;
+        }
+        cursor.skipValue();
+        if (cursor.nextElement()) {
+          cursor.beginArray();
+          while (cursor.nextElement()) {
+            e.properties |= property_from_id(
+                cursor.readUInt64());
+          }
+          finish_array(cursor);
+        }
+      }
+    } else if (r.key == "pid") {
+      read_samples<id_t>(r, e.pid, [&]() {
+        return cursor.readUInt64();
+      });
+    } else if (r.key == "tid") {
+      read_samples<id_t>(r, e.tid, [&]() {
+        return cursor.readUInt64();
+      });
+    } else if (r.key == "pos") {
+      read_samples<glm::vec2>(r, e.pos, [&]() {
+        return read_vec2(cursor);
+      });
+    } else if (r.key == "size") {
+      read_samples<glm::vec3>(r, e.size, [&]() {
+        return read_vec3(cursor);
+      });
+    } else if (r.key == "angle") {
+      read_samples<float>(r, e.angle, [&]() {
+        return cursor.readFloat();
+      });
+    } else if (r.key == "sight") {
+      read_samples<float>(r, e.sight, [&]() {
+        return cursor.readFloat();
+      });
+    } else if (r.key == "speed") {
+      read_samples<float>(r, e.speed, [&]() {
+        return cursor.readFloat();
+      });
+    } else if (r.key == "visible") {
+      read_samples<VisibilitySet>(r, e.visible, [&]() {
+        VisibilitySet set;
+        cursor.beginArray();
+        while (cursor.nextElement()) {
+          set.insert(cursor.readUInt64());
+        }
+        return set;
+      });
+    } else if (r.key == "actions") {
+      read_samples<std::vector<UIAction>>(r, e.actions, [&]() {
+        std::vector<UIAction> actions;
+        cursor.beginArray();
+        while (cursor.nextElement()) {
+          actions.push_back(read_action(r));
+          actions.back().owner_id = e.game_id;
+        }
+        return actions;
+      });
+    } else if (r.key == "ui_info") {
+      read_samples<GameEntity::UIInfo>(r, e.ui_info, [&]() {
+        return read_ui_info(r);
+      });
+    } else {
+      cursor.skipValue();
+    }
+  }
+}
+
+static void read_message(
+    message_reader &r,
+    StringTable &strings,
+    server_message &message) {
+  JsonCursor &cursor = r.cursor;
+  render_snapshot &render = message.render;
+  cursor.beginObject();
+  while (cursor.nextKey(r.key)) {
+    if (r.key == "type") {
+      cursor.readString(message.type);
+    } else if (r.key == "tick") {
+      cursor.readValue(message.tick);
+    } else if (r.key == "t") {
+      render.t = cursor.readFloat();
+    } else if (r.key == "dt") {
+      render.dt = cursor.readFloat();
+    } else if (r.key == "entities") {
+      cursor.beginObject();
+      while (cursor.nextKey(r.key)) {
+        render.entities.emplace_back();
+        entity_snapshot &e = render.entities.back();
+        e.game_id = game_id_from_key(r.key);
+        read_entity(r, e);
+      }
+    } else if (r.key == "events") {
+      cursor.readValue(render.events);
+    } else if (r.key == "chats") {
+      cursor.readValue(render.chats);
+    } else if (r.key == "players") {
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        player_snapshot p = player_snapshot();
+        cursor.beginObject();
+        while (cursor.nextKey(r.key)) {
+          if (r.key == "pid") {
+            p.pid = cursor.readUInt64();
+          } else if (r.key == "req") {
+            p.requisition = cursor.readFloat();
+          } else if (r.key == "power") {
+            p.power = cursor.readFloat();
+          } else {
+            cursor.skipValue();
+          }
+        }
+        render.players.push_back(p);
+      }
+    } else if (r.key == "teams") {
+      cursor.beginArray();
+      while (cursor.nextElement()) {
+        team_snapshot s = team_snapshot();
+        cursor.beginObject();
+        while (cursor.nextKey(r.key)) {
+          if (r.key == "tid") {
+            s.tid = cursor.readUInt64();
+          } else if (r.key == "vps") {
+            s.victory_points = cursor.readFloat();
+          } else {
+            cursor.skipValue();
+          }
+        }
+        render.teams.push_back(s);
+      }
+    } else if (r.key == "strings") {
+      // Rare, and small
+      Json::Value defs;
+      cursor.readValue(defs);
+      const uint32_t first = must_have_idx(defs, "first").asUInt();
+      if (first > strings.size()) {
+        // Definitions are sent until acked, so this batch came out of order
+        throw network_exception("string definitions skip ids");
+      }
+      strings.define(first, must_have_idx(defs, "values"));
+    } else if (r.key == "winning_team") {
+      message.winning_team = cursor.readUInt64();
+    } else {
+      cursor.skipValue();
+    }
+  }
+}
+
+void decode_message(
+    JsonCursor &cursor,
+    StringTable &strings,
+    server_message &message) {
+  const size_t start = cursor.tell();
+  message_reader reader(cursor, strings);
+  read_message(reader, strings, message);
+  if (reader.unresolved) {
+    cursor.seek(start);
+    message = server_message();
+    message_reader again(cursor, strings);
+    read_message(again, strings, message);
+    if (again.unresolved) {
+      throw network_exception("unknown string id");
+    }
+  }
+}
+
+// Field by field equality, for diff_render.  Overloads for the structs
+// without an operator== are found by argument dependent lookup.
+template<typename T>
+static bool same(const T &a, const T &b) {
+  return a == b;
+}
+
+template<typename T>
+static bool same(const std::pair<float, T> &a, const std::pair<float, T> &b) {
+  return a.first == b.first && same(a.second, b.second);
+}
+
+template<typename T>
+static bool same(const std::vector<T> &a, const std::vector<T> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (!same(a[i], b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool same(const UIAction &a, const UIAction &b) {
+  return a.owner_id == b.owner_id
+    && a.name == b.name
+    && a.hotkey == b.hotkey
+    && a.icon == b.icon
+    && a.tooltip == b.tooltip
+    && a.targeting == b.targeting
+    && a.range == b.range
+    && a.radius == b.radius
+    && a.state == b.state
+    && a.cooldown == b.cooldown;
+}
+
+static bool same(
+    const GameEntity::UIPartUpgrade &a,
+    const GameEntity::UIPartUpgrade &b) {
+  return a.part == b.part && a.name == b.name;
+}
+
+static bool same(const GameEntity::UIPart &a, const GameEntity::UIPart &b) {
+  return a.name == b.name
+    && a.health == b.health
+    && a.tooltip == b.tooltip
+    && same(a.upgrades, b.upgrades);
+}
+
+static bool same(const GameEntity::UIInfo &a, const GameEntity::UIInfo &b) {
+  return same(a.parts, b.parts)
+    && a.mana == b.mana
+    && a.retreat == b.retreat
+    && a.capture == b.capture
+    && a.capture_pid == b.capture_pid
+    && a.hotkey == b.hotkey
+    && a.minimap_icon == b.minimap_icon
+    && a.extra == b.extra
+    && same(a.path, b.path);
+}
+
+static std::string diff_entity(
+    const entity_snapshot &a,
+    const entity_snapshot &b) {
+  if (!same(a.alive, b.alive)) {
+    return "alive";
+  } else if (!same(a.model, b.model)) {
+    return "model";
+  } else if (a.properties != b.properties) {
+    return "properties";
+  } else if (!same(a.pid, b.pid)) {
+    return "pid";
+  } else if (!same(a.tid, b.tid)) {
+    return "tid";
+  } else if (!same(a.pos, b.pos)) {
+    return "pos";
+  } else if (!same(a.size, b.size)) {
+    return "size";
+  } else if (!same(a.angle, b.angle)) {
+    return "angle";
+  } else if (!same(a.sight, b.sight)) {
+    return "sight";
+  } else if (!same(a.speed, b.speed)) {
+    return "speed";
+  } else if (!same(a.visible, b.visible)) {
+    return "visible";
+  } else if (!same(a.actions, b.actions)) {
+    return "actions";
+  } else if (!same(a.ui_info, b.ui_info)) {
+    return "ui_info";
+  }
+  return "";
+}
+
+std::string diff_render(const render_snapshot &a, const render_snapshot &b) {
+  if (a.t != b.t || a.dt != b.dt) {
+    return "t";
+  } else if (a.entities.size() != b.entities.size()) {
+    return "entity count";
+  }
+  // Json::Value objects iterate sorted, so the order can differ
+  std::map<id_t, const entity_snapshot *> b_entities;
+  for (const auto &e : b.entities) {
+    b_entities[e.game_id] = &e;
+  }
+  for (const auto &e : a.entities) {
+    const std::string name = "entity " + std::to_string(e.game_id);
+    auto it = b_entities.find(e.game_id);
+    if (it == b_entities.end()) {
+      return name;
+    }
+    const std::string field = diff_entity(e, *it->second);
+    if (!field.empty()) {
+      return name + " " + field;
+    }
+  }
+
+  if (a.players.size() != b.players.size()) {
+    return "players";
+  }
+  for (size_t i = 0; i < a.players.size(); i++) {
+    const player_snapshot &pa = a.players[i];
+    const player_snapshot &pb = b.players[i];
+    if (pa.pid != pb.pid
+        || pa.requisition != pb.requisition
+        || pa.power != pb.power) {
+      return "player " + std::to_string(pa.pid);
+    }
+  }
+  if (a.teams.size() != b.teams.size()) {
+    return "teams";
+  }
+  for (size_t i = 0; i < a.teams.size(); i++) {
+    if (a.teams[i].tid != b.teams[i].tid
+        || a.teams[i].victory_points != b.teams[i].victory_points) {
+      return "team " + std::to_string(a.teams[i].tid);
+    }
+  }
+  if (a.events != b.events) {
+    return "events";
+  } else if (a.chats != b.chats) {
+    return "chats";
+  }
+  return "";
+}
+
+};  // rts
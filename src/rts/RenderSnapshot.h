@@ -0,0 +1,103 @@
+#ifndef SRC_RTS_RENDERSNAPSHOT_H_
+#define SRC_RTS_RENDERSNAPSHOT_H_
+#include <string>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+#include "common/JsonCursor.h"
+#include "common/StringTable.h"
+#include "rts/GameEntity.h"
+#include "rts/UIAction.h"
+
+namespace rts {
+
+// (t, value) keyframes of one entity field
+template<typename T>
+struct entity_samples {
+  typedef std::vector<std::pair<float, T>> type;
+};
+
+// The fields of an entity a render sent, decoded and ready to apply
+struct entity_snapshot {
+  id_t game_id;
+  entity_samples<bool>::type alive;
+  entity_samples<std::string>::type model;
+  property_mask properties = 0;
+  entity_samples<id_t>::type pid;
+  entity_samples<id_t>::type tid;
+  entity_samples<glm::vec2>::type pos;
+  entity_samples<glm::vec3>::type size;
+  entity_samples<float>::type angle;
+  entity_samples<float>::type sight;
+  entity_samples<float>::type speed;
+  entity_samples<VisibilitySet>::type visible;
+  entity_samples<std::vector<UIAction>>::type actions;
+  entity_samples<GameEntity::UIInfo>::type ui_info;
+};
+
+struct player_snapshot {
+  id_t pid;
+  float requisition;
+  float power;
+};
+
+struct team_snapshot {
+  id_t tid;
+  float victory_points;
+};
+
+// A render message from the server, decoded off the render thread
+struct render_snapshot {
+  render_snapshot();
+
+  float t;
+  float dt;
+  std::vector<entity_snapshot> entities;
+  std::vector<player_snapshot> players;
+  std::vector<team_snapshot> teams;
+  // Effects and chats are few, and kept as sent
+  Json::Value events;
+  Json::Value chats;
+};
+
+// Any message from the server.  Render messages fill in render, chat
+// messages only render.chats.
+struct server_message {
+  std::string type;
+  // Acked back to the server, null if the message has none
+  Json::Value tick;
+  id_t winning_team;
+  render_snapshot render;
+
+  server_message();
+};
+
+// Decodes a render message.  Defines the strings it carries in strings
+// first, and resolves interned strings against that.
+void decode_render(
+    const Json::Value &v,
+    StringTable &strings,
+    render_snapshot &snapshot);
+
+// Decodes the message object at cursor in one pass, without parsing it
+// into a Json::Value first.  A message can use strings it defines itself,
+// and those definitions are written after the entities, so such a message
+// is read a second time.  That only happens when new strings show up.
+// Throws network_exception if the message uses strings that are still
+// undefined, which the batch should be dropped for.
+void decode_message(
+    JsonCursor &cursor,
+    StringTable &strings,
+    server_message &message);
+
+// Returns the first field a and b differ in, or "" if they match.  For
+// checking the decoders against each other.
+std::string diff_render(const render_snapshot &a, const render_snapshot &b);
+
+// Returns the bit of the property with the given hashed id, or 0 for
+// properties the client never checks.
+property_mask property_from_id(uint32_t id);
+
+};  // rts
+
+#endif  // SRC_RTS_RENDERSNAPSHOT_H_
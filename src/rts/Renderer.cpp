@@ -6,10 +6,12 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
 #include <algorithm>
+#include <limits>
 #include "common/Clock.h"
 #include "common/Collision.h"
 #include "common/FPSCalculator.h"
 #include "common/ParamReader.h"
+#include "common/Profiler.h"
 #include "common/util.h"
 #include "rts/Controller.h"
 #include "rts/EffectManager.h"
@@ -22,16 +24,27 @@
 
 namespace rts {
 
+// About the size of a big unit
+static const float ENTITY_GRID_CELL_SIZE = 4.f;
+// Models can be drawn a little outside their entity's bounds
+static const float CULL_MARGIN = 0.5f;
+// How far above an entity its overlay reaches
+static const float OVERLAY_HEIGHT = 1.5f;
+
 Renderer::Renderer()
   : controller_(nullptr),
+    gridTime_(0.f),
+    gridDirty_(true),
+    entityZMin_(0.f),
+    entityZMax_(0.f),
     running_(true),
     camera_(glm::vec3(0.f), 5.f, 0.f, 45.f),
     resolution_(vec2Param("local.resolution")),
     timeMultiplier_(1.f),
+    snapshotHorizon_(std::numeric_limits<float>::infinity()),
     startTime_(Clock::now()),
     lastRender_(Clock::now()),
-    mapSize_(0.f),
-    nextEntityID_(STARTING_EID) {
+    mapSize_(0.f) {
   // TODO(zack): move this to a separate initialize function
   resolution_ = initEngine();
 
@@ -57,6 +70,11 @@ Renderer::Renderer()
   FontManager::get();
 
   effectManager_ = new EffectManager();
+
+  // TODO(zack): read lights from map config
+  setParam("renderer.light.ambient", glm::vec3(0.1f));
+  setParam("renderer.light.diffuse", glm::vec3(1.f));
+  setParam("renderer.light.specular", glm::vec3(1.f));
 }
 
 Renderer::~Renderer() {
@@ -71,11 +89,11 @@ void Renderer::postToMainThread(const PostableFunction &func) {
 }
 
 void Renderer::clearEntities() {
-  for (auto&& pair : entities_) {
-    delete pair.second;
+  for (auto *entity : entities_) {
+    delete entity;
   }
   entities_.clear();
-  nextEntityID_ = STARTING_EID;
+  gridDirty_ = true;
   effectManager_->clear();
 }
 
@@ -96,13 +114,13 @@ void Renderer::clearController() {
 }
 
 void Renderer::startMainloop() {
-  Clock::setThread();
   const float framerate = fltParam("local.framerate");
   float fps = 1.f / framerate;
 
   FPSCalculator updateTimer(64);
   // render loop
   Clock::time_point last = Clock::now();
+  Clock::time_point last_profile_report = last;
   while (running_) {
     std::unique_lock<std::mutex> lock(mutex_);
 
@@ -120,7 +138,13 @@ void Renderer::startMainloop() {
 
     render();
     lock.unlock();
-    Clock::dumpTimes();
+
+    auto profiler = Profiler::get();
+    if (profiler->isEnabled()
+        && Clock::secondsSince(last_profile_report) > 5.f) {
+      std::cout << profiler->report();
+      last_profile_report = Clock::now();
+    }
 
     // Regulate frame rate
     float delay = glm::clamp(2 * fps - Clock::secondsSince(last), 0.f, fps);
@@ -132,19 +156,20 @@ void Renderer::startMainloop() {
 }
 
 void Renderer::render() {
-  Clock::startSection("render");
+  record_section("render");
 
   startRender();
 
   renderMap();
 
-  for (auto &it : entities_) {
-    renderEntity(it.second);
+  cullEntities();
+  for (auto *entity : visibleEntities_) {
+    renderEntity(entity);
   }
   // render overlay second for z ordering issues
   if (entityOverlayRenderer_) {
-    for (auto &it : entities_) {
-      renderEntityOverlay(it.second);
+    for (auto *entity : visibleEntities_) {
+      renderEntityOverlay(entity);
     }
   }
   effectManager_->render(getRenderTime());
@@ -152,6 +177,57 @@ void Renderer::render() {
   endRender();
 }
 
+void Renderer::refreshEntityGrid() const {
+  if (!gridDirty_ && gridTime_ == gameTime_) {
+    return;
+  }
+  record_section("refreshEntityGrid");
+  const glm::vec2 extent = mapSize_ / 2.f;
+  entityGrid_.reset(-extent, extent, ENTITY_GRID_CELL_SIZE);
+  entityZMin_ = 0.f;
+  entityZMax_ = 0.f;
+  for (auto *entity : entities_) {
+    const glm::vec3 pos = entity->getPosition(gameTime_);
+    const glm::vec3 size = entity->getSize3(gameTime_);
+    // Covers the entity at any angle
+    const float radius = glm::length(glm::vec2(size)) / 2.f + CULL_MARGIN;
+    entityGrid_.insert(entity, glm::vec2(pos), glm::vec2(radius));
+    entityZMin_ = std::min(entityZMin_, pos.z);
+    entityZMax_ = std::max(entityZMax_, pos.z + size.z);
+  }
+  entityGrid_.build();
+  gridTime_ = gameTime_;
+  gridDirty_ = false;
+}
+
+void Renderer::cullEntities() {
+  record_section("cullEntities");
+  visibleEntities_.clear();
+  refreshEntityGrid();
+  glm::vec2 min, max;
+  if (!frustum_.groundBounds(
+        entityZMin_,
+        entityZMax_ + OVERLAY_HEIGHT,
+        min,
+        max)) {
+    return;
+  }
+  entityGrid_.query(min, max, [&](ModelEntity *entity) {
+    if (!entity->isVisible()) {
+      return;
+    }
+    // Tall enough for the overlay too
+    const glm::vec3 size = entity->getSize3(gameTime_);
+    const float width = glm::length(glm::vec2(size)) + 2.f * CULL_MARGIN;
+    const float height = size.z + OVERLAY_HEIGHT;
+    const glm::vec3 center = entity->getPosition(gameTime_)
+      + glm::vec3(0.f, 0.f, height / 2.f);
+    if (frustum_.intersectsAABB(center, glm::vec3(width, width, height))) {
+      visibleEntities_.push_back(entity);
+    }
+  });
+}
+
 void Renderer::renderEntity(ModelEntity *entity) {
   record_section("renderEntity");
   if (!entity->isVisible()) {
@@ -229,9 +305,9 @@ void Renderer::startRender() {
   // TODO(zack): read light pos from map config
   auto lightPos = applyMatrix(getViewStack().current(), glm::vec3(-5, -5, 10));
   setParam("renderer.lightPos", lightPos);
-  setParam("renderer.light.ambient", glm::vec3(0.1f));
-  setParam("renderer.light.diffuse", glm::vec3(1.f));
-  setParam("renderer.light.specular", glm::vec3(1.f));
+
+  frustum_ = Frustum(
+      getProjectionStack().current() * getViewStack().current());
 }
 
 void Renderer::endRender() {
@@ -244,10 +320,22 @@ const ModelEntity *Renderer::castRay(
     const glm::vec3 &origin,
     const glm::vec3 &dir,
     std::function<bool(const ModelEntity *)> filter) const {
+  refreshEntityGrid();
+  // Only where the ray is between the bottom and top of the entities
+  glm::vec2 min(-HUGE_VAL);
+  glm::vec2 max(HUGE_VAL);
+  if (dir.z != 0.f) {
+    const float t0 = std::max((entityZMin_ - origin.z) / dir.z, 0.f);
+    const float t1 = std::max((entityZMax_ - origin.z) / dir.z, 0.f);
+    const glm::vec2 p0 = glm::vec2(origin + t0 * dir);
+    const glm::vec2 p1 = glm::vec2(origin + t1 * dir);
+    min = glm::min(p0, p1);
+    max = glm::max(p0, p1);
+  }
+
   float bestTime = HUGE_VAL;
   const ModelEntity *ret = nullptr;
-  for (auto pair : entities_) {
-    auto entity = pair.second;
+  entityGrid_.query(min, max, [&](const ModelEntity *entity) {
     float time = rayAABBIntersection(
       origin,
       dir,
@@ -259,27 +347,31 @@ const ModelEntity *Renderer::castRay(
         ret = entity;
       }
     }
-  }
+  });
 
   return ret;
 }
 
-id_t Renderer::newEntityID() {
-  // this is an atomic variable, safe!
-  return nextEntityID_++;
-}
-
-void Renderer::spawnEntity(ModelEntity *ent) {
+id_t Renderer::spawnEntity(ModelEntity *ent) {
   invariant(ent, "Cannot spawn null entity");
-  invariant(entities_.find(ent->getID()) == entities_.end(),
-      "cannot add spawn entity with already existing ID");
-  entities_[ent->getID()] = (ModelEntity *)ent;
+  invariant(ent->getID() == NO_ENTITY, "cannot spawn entity twice");
+  ent->id_ = entities_.insert(ent);
+  gridDirty_ = true;
+  return ent->id_;
 }
 
 void Renderer::removeEntity(id_t eid) {
-  auto *e = entities_[eid];
+  delete releaseEntity(eid);
+}
+
+ModelEntity * Renderer::releaseEntity(id_t eid) {
+  auto *e = getEntity(eid);
   entities_.erase(eid);
-  delete e;
+  gridDirty_ = true;
+  if (e) {
+    e->id_ = NO_ENTITY;
+  }
+  return e;
 }
 
 void Renderer::updateCamera(const glm::vec3 &delta) {
@@ -1,12 +1,14 @@
 #ifndef SRC_RTS_RENDERER_H_
 #define SRC_RTS_RENDERER_H_
-#include <atomic>
 #include <map>
 #include <mutex>
 #include <set>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include "common/Clock.h"
+#include "common/Collision.h"
+#include "common/SlotMap.h"
+#include "common/SpatialGrid.h"
 #include "common/Types.h"
 #include "rts/Camera.h"
 #ifdef USE_FMOD
@@ -50,28 +52,32 @@ class Renderer {
     return controller_;
   }
 
-  std::map<id_t, ModelEntity *>& getEntities() {
+  // Entity ids are handles into this
+  typedef SlotMap<ModelEntity *> EntityMap;
+  EntityMap& getEntities() {
     return entities_;
   }
-  const std::map<id_t, ModelEntity *>& getEntities() const {
+  const EntityMap& getEntities() const {
     return entities_;
   }
   ModelEntity * getEntity(id_t id) {
-    auto it = entities_.find(id);
-    if (it != entities_.end()) {
-      return it->second;
-    }
-    return nullptr;
+    auto *entity = entities_.find(id);
+    return entity ? *entity : nullptr;
   }
 
+  // Calls f with each entity whose bounds on the ground may overlap the
+  // rect from min to max
+  template <class F>
+  void findEntitiesIn(const glm::vec2 &min, const glm::vec2 &max, F f) const;
   const ModelEntity * castRay(
       const glm::vec3 &origin,
       const glm::vec3 &dir,
       std::function<bool(const ModelEntity *)> filter) const;
-  // Internally synchronized
-  id_t newEntityID();
-  void spawnEntity(ModelEntity *ent);
+  // Takes ownership of ent and gives it an id
+  id_t spawnEntity(ModelEntity *ent);
   void removeEntity(id_t eid);
+  // Removes the entity without deleting it, and returns it
+  ModelEntity * releaseEntity(id_t eid);
   void clearEntities();
 
   float getRenderTime() {
@@ -86,6 +92,18 @@ class Renderer {
   float getGameTime() const {
     return gameTime_;
   }
+  // What the camera sees this frame
+  const Frustum& getFrustum() const {
+    return frustum_;
+  }
+  // Newest game time the entities have data for.  Past it, moving entities
+  // are extrapolated for a short while.
+  void setSnapshotHorizon(float t) {
+    snapshotHorizon_ = t;
+  }
+  float getSnapshotHorizon() const {
+    return snapshotHorizon_;
+  }
   // eventually replace this with a set map geometry or something similar
   void setMapSize(const glm::vec2 &mapSize) {
     mapSize_ = mapSize;
@@ -143,6 +161,11 @@ class Renderer {
   void startRender();
   void endRender();
   void renderMap();
+  // Rebuilds entityGrid_ if it is from another game time or entities have
+  // been added or removed since
+  void refreshEntityGrid() const;
+  // Fills visibleEntities_ with the entities in the frustum
+  void cullEntities();
   void renderEntityOverlay(ModelEntity *entity);
   void renderEntity(ModelEntity *entity);
   void renderUI();
@@ -150,8 +173,16 @@ class Renderer {
   glm::vec3 screenToNDC(const glm::vec2 &screenCoord) const;
   glm::vec2 worldToMinimap(const glm::vec3 &mapPos);
 
-  std::map<id_t, ModelEntity *> entities_;
-  std::atomic<id_t> nextEntityID_;
+  EntityMap entities_;
+  // Entities by where they are at gridTime_, for culling and picking
+  mutable SpatialGrid<ModelEntity *> entityGrid_;
+  mutable float gridTime_;
+  mutable bool gridDirty_;
+  // Lowest bottom and highest top of the entities in the grid
+  mutable float entityZMin_;
+  mutable float entityZMax_;
+  Frustum frustum_;
+  std::vector<ModelEntity *> visibleEntities_;
 
   EffectManager *effectManager_;
 
@@ -177,6 +208,7 @@ class Renderer {
   float timeMultiplier_;
   // 'game' time, affected by timeMultiplier
   float gameTime_;
+  float snapshotHorizon_;
   // For updating purely render aspects
   Clock::time_point lastRender_;
   Clock::time_point startTime_;
@@ -184,13 +216,21 @@ class Renderer {
   float averageFPS_;
 };
 
+template <class F>
+void Renderer::findEntitiesIn(
+    const glm::vec2 &min,
+    const glm::vec2 &max,
+    F f) const {
+  refreshEntityGrid();
+  entityGrid_.query(min, max, f);
+}
+
 template <class T>
 const ModelEntity * Renderer::findEntity(T scorer) const {
   float bestscore = HUGE_VAL;
   const ModelEntity *bestentity = nullptr;
 
-  for (const auto& it : entities_) {
-    const ModelEntity *e = it.second;
+  for (const ModelEntity *e : entities_) {
     float score = scorer(e);
     if (score < bestscore) {
       bestscore = score;
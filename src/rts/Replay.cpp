@@ -0,0 +1,121 @@
+#include "rts/Replay.h"
+#include "common/Exception.h"
+#include "common/Logger.h"
+#include "common/util.h"
+
+namespace rts {
+
+const int REPLAY_VERSION = 2;
+
+ReplayWriter::ReplayWriter(const std::string &filename)
+  : file_(filename.c_str(), std::ios::out | std::ios::trunc) {
+  if (!file_) {
+    throw file_exception("Unable to open replay file " + filename);
+  }
+}
+
+ReplayWriter::~ReplayWriter() {
+}
+
+void ReplayWriter::writeLine(const Json::Value &line) {
+  // FastWriter includes the trailing newline.  Flush every line so a crashed
+  // server still leaves a usable replay behind.
+  file_ << writer_.write(line);
+  file_.flush();
+}
+
+void ReplayWriter::writeHeader(
+    const Json::Value &game_def,
+    uint32_t seed,
+    float dt) {
+  Json::Value header;
+  header["version"] = REPLAY_VERSION;
+  header["game_def"] = game_def;
+  header["seed"] = seed;
+  header["dt"] = dt;
+  writeLine(header);
+}
+
+void ReplayWriter::writeTick(
+    size_t tick,
+    const std::vector<PlayerAction> &actions) {
+  if (actions.empty()) {
+    return;
+  }
+  Json::Value line;
+  line["tick"] = toJson((uint64_t)tick);
+  line["actions"] = Json::Value(Json::arrayValue);
+  for (const auto &action : actions) {
+    line["actions"].append(action);
+  }
+  writeLine(line);
+}
+
+void ReplayWriter::close(size_t tick_count) {
+  if (!file_.is_open()) {
+    return;
+  }
+  Json::Value footer;
+  footer["tick_count"] = toJson((uint64_t)tick_count);
+  writeLine(footer);
+  file_.close();
+}
+
+ReplayReader::ReplayReader(const std::string &filename)
+  : seed_(0),
+    dt_(0.f),
+    tickCount_(0),
+    complete_(false) {
+  std::ifstream file(filename.c_str());
+  if (!file) {
+    throw file_exception("Unable to open replay file " + filename);
+  }
+
+  Json::Reader reader;
+  std::string line;
+  bool read_header = false;
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    Json::Value v;
+    if (!reader.parse(line, v)) {
+      LOG(ERROR) << "Cannot parse replay line: "
+        << reader.getFormattedErrorMessages() << '\n';
+      throw file_exception("Corrupt replay file " + filename);
+    }
+
+    if (!read_header) {
+      invariant(
+          must_have_idx(v, "version").asInt() == REPLAY_VERSION,
+          "unsupported replay version");
+      gameDef_ = must_have_idx(v, "game_def");
+      seed_ = must_have_idx(v, "seed").asUInt();
+      dt_ = must_have_idx(v, "dt").asFloat();
+      read_header = true;
+    } else if (v.isMember("tick_count")) {
+      tickCount_ = v["tick_count"].asUInt64();
+      complete_ = true;
+    } else {
+      size_t tick = must_have_idx(v, "tick").asUInt64();
+      auto &actions = ticks_[tick];
+      for (const auto &action : must_have_idx(v, "actions")) {
+        actions.push_back(action);
+      }
+      tickCount_ = std::max(tickCount_, tick + 1);
+    }
+  }
+
+  if (!read_header) {
+    throw file_exception("Empty replay file " + filename);
+  }
+}
+
+const std::vector<PlayerAction>& ReplayReader::getActions(size_t tick) const {
+  auto it = ticks_.find(tick);
+  if (it == ticks_.end()) {
+    return empty_;
+  }
+  return it->second;
+}
+};  // rts
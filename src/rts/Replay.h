@@ -0,0 +1,70 @@
+#ifndef SRC_RTS_REPLAY_H_
+#define SRC_RTS_REPLAY_H_
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "rts/PlayerAction.h"
+
+namespace rts {
+
+// Replay files are newline delimited json.  The first line is a header
+// containing the game def, the random seed and the sim dt, followed by one line per tick that
+// had input, and finally a footer with the total number of ticks simulated.
+// Ticks without actions are not written, so idle games stay small.
+class ReplayWriter {
+ public:
+  explicit ReplayWriter(const std::string &filename);
+  ~ReplayWriter();
+
+  void writeHeader(const Json::Value &game_def, uint32_t seed, float dt);
+  // Records the batch of actions fed to the tick'th update.
+  void writeTick(size_t tick, const std::vector<PlayerAction> &actions);
+  void close(size_t tick_count);
+
+ private:
+  void writeLine(const Json::Value &line);
+
+  std::ofstream file_;
+  Json::FastWriter writer_;
+};
+
+class ReplayReader {
+ public:
+  // Reads and parses the entire file, throws file_exception on failure.
+  explicit ReplayReader(const std::string &filename);
+
+  const Json::Value& getGameDef() const {
+    return gameDef_;
+  }
+  uint32_t getSeed() const {
+    return seed_;
+  }
+  float getSimDT() const {
+    return dt_;
+  }
+  // Number of ticks recorded.  If the recording server died before writing
+  // the footer this is one past the last tick with input.
+  size_t getTickCount() const {
+    return tickCount_;
+  }
+  bool isComplete() const {
+    return complete_;
+  }
+
+  // Returns the actions fed to the given tick, possibly empty.
+  const std::vector<PlayerAction>& getActions(size_t tick) const;
+
+ private:
+  Json::Value gameDef_;
+  uint32_t seed_;
+  float dt_;
+  size_t tickCount_;
+  bool complete_;
+  std::map<size_t, std::vector<PlayerAction>> ticks_;
+  std::vector<PlayerAction> empty_;
+};
+
+};  // rts
+#endif  // SRC_RTS_REPLAY_H_
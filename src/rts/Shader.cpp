@@ -2,7 +2,17 @@
 #include <glm/gtc/type_ptr.hpp>
 
 Shader::Shader(GLuint program)
-  : program_(program) {
+  : program_(program),
+    lastFrame_(UINT32_MAX) {
+  locations_.modelViewMatrix = getUniformLocation("modelViewMatrix");
+  locations_.projectionMatrix = getUniformLocation("projectionMatrix");
+  locations_.normalMatrix = getUniformLocation("normalMatrix");
+  locations_.lightPos = getUniformLocation("lightPos");
+  locations_.ambientColor = getUniformLocation("ambientColor");
+  locations_.diffuseColor = getUniformLocation("diffuseColor");
+  locations_.specularColor = getUniformLocation("specularColor");
+  locations_.useTexture = getUniformLocation("useTexture");
+  locations_.texture = getUniformLocation("texture");
 }
 
 Shader::~Shader() {
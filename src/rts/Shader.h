@@ -1,9 +1,24 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
 class Shader {
  public:
+  // Uniforms the model draw path sets, located once when the shader is
+  // made.  -1 for those the program doesn't use.
+  struct Locations {
+    GLint modelViewMatrix;
+    GLint projectionMatrix;
+    GLint normalMatrix;
+    GLint lightPos;
+    GLint ambientColor;
+    GLint diffuseColor;
+    GLint specularColor;
+    GLint useTexture;
+    GLint texture;
+  };
+
   Shader(GLuint program);
   ~Shader();
 
@@ -22,7 +37,22 @@ class Shader {
   GLint getUniformLocation(const char *name) {
     return glGetUniformLocation(program_, name);
   }
+  const Locations& getLocations() const {
+    return locations_;
+  }
+
+  // Returns true only the first time it is called with each frame number,
+  // for setting uniforms that don't change within a frame
+  bool firstUseInFrame(uint32_t frame) {
+    if (frame == lastFrame_) {
+      return false;
+    }
+    lastFrame_ = frame;
+    return true;
+  }
 
  private:
   GLuint program_;
+  Locations locations_;
+  uint32_t lastFrame_;
 };
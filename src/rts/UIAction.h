@@ -1,5 +1,6 @@
 #pragma once
 #include <json/json.h>
+#include "common/StringTable.h"
 #include "common/Types.h"
 
 namespace rts {
@@ -21,11 +22,11 @@ struct UIAction {
     UNAVAILABLE = 3,
   };
 
-  std::string owner_id;
-  std::string name;
+  id_t owner_id;
+  InternedString name;
   char hotkey;
-  std::string icon;
-  std::string tooltip;
+  InternedString icon;
+  InternedString tooltip;
   TargetingType targeting;
   float range;
   // aoe radius
@@ -0,0 +1,35 @@
+#include "common/ClockSync.h"
+#include "gtest/gtest.h"
+
+TEST(ClockSyncTest, EstimatesOffsetAndRTT) {
+  ClockSync sync;
+  EXPECT_FALSE(sync.hasEstimate());
+
+  // Remote clock is 5s ahead, 20ms each way, the peer holds the ping 1ms
+  sync.addSample(1.0, 6.02, 6.021, 1.041);
+  ASSERT_TRUE(sync.hasEstimate());
+  EXPECT_NEAR(5.0, sync.getOffset(), 1e-9);
+  EXPECT_NEAR(0.04, sync.getRTT(), 1e-9);
+  EXPECT_NEAR(0.0, sync.getJitter(), 1e-9);
+
+  sync.reset();
+  EXPECT_FALSE(sync.hasEstimate());
+}
+
+TEST(ClockSyncTest, PrefersShortestRoundTrip) {
+  ClockSync sync;
+  // Clean exchange, remote 2s ahead with 10ms each way
+  sync.addSample(0.0, 2.01, 2.01, 0.02);
+  // The pong of this one was queued for 100ms, skewing its offset
+  sync.addSample(1.0, 3.01, 3.01, 1.12);
+  EXPECT_NEAR(2.0, sync.getOffset(), 1e-9);
+  EXPECT_NEAR(0.02, sync.getRTT(), 1e-9);
+  EXPECT_NEAR(0.05, sync.getJitter(), 1e-9);
+
+  // The clean sample eventually leaves the window
+  for (int i = 0; i < 8; i++) {
+    sync.addSample(2.0 + i, 4.01 + i, 4.01 + i, 2.04 + i);
+  }
+  EXPECT_NEAR(0.04, sync.getRTT(), 1e-9);
+  EXPECT_NEAR(1.99, sync.getOffset(), 1e-9);
+}
@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 #include "common/Clock.h"
 #include "common/Collision.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 // Tests pointInBox function with various points
 TEST(CollisionTest, PointInBox) {
@@ -149,9 +150,10 @@ TEST(CollisionTest, BoxBoxCollision) {
 TEST(CollisionTest, pointInPolygon) {
   // make a simple box
   std::vector<glm::vec3> polygon;
-  for (int i = 0; i < 4; i++) {
-    polygon.push_back(glm::vec3(1 * (i % 2), 1 * (i / 2), 0));
-  }
+  polygon.push_back(glm::vec3(0, 0, 0));
+  polygon.push_back(glm::vec3(1, 0, 0));
+  polygon.push_back(glm::vec3(1, 1, 0));
+  polygon.push_back(glm::vec3(0, 1, 0));
   // a point that should be in the box
   glm::vec3 p1(0.5, 0.5, 0.0);
   // a point that will be outside the box
@@ -164,7 +166,7 @@ TEST(CollisionTest, pointInPolygon) {
   ASSERT_FALSE(pointInPolygon(p3, polygon));
 }
 
-TEST(CollisionTest, pointInPolygon) {
+TEST(CollisionTest, pointInOffsetPolygon) {
   // make a simple box
   std::vector<glm::vec3> polygon;
   polygon.push_back(glm::vec3(-20, -20, 0));
@@ -176,3 +178,41 @@ TEST(CollisionTest, pointInPolygon) {
 
   ASSERT_TRUE(pointInPolygon(p1, polygon));
 }
+
+// A camera 10 up looking straight down, seeing 10 out to each side at the
+// ground
+static Frustum make_down_frustum() {
+  auto proj = glm::perspective(90.f, 1.f, 1.f, 100.f);
+  auto view = glm::lookAt(
+      glm::vec3(0.f, 0.f, 10.f),
+      glm::vec3(0.f),
+      glm::vec3(0.f, 1.f, 0.f));
+  return Frustum(proj * view);
+}
+
+TEST(CollisionTest, FrustumCulling) {
+  Frustum frustum = make_down_frustum();
+  const glm::vec3 size(1.f);
+  EXPECT_TRUE(frustum.intersectsAABB(glm::vec3(0.f), size));
+  EXPECT_TRUE(frustum.intersectsAABB(glm::vec3(10.4f, 0.f, 0.f), size));
+  EXPECT_FALSE(frustum.intersectsAABB(glm::vec3(12.f, 0.f, 0.f), size));
+  // Behind the camera
+  EXPECT_FALSE(frustum.intersectsAABB(glm::vec3(0.f, 0.f, 20.f), size));
+  EXPECT_TRUE(frustum.intersectsSphere(glm::vec3(0.f, -10.5f, 0.f), 1.f));
+  EXPECT_FALSE(frustum.intersectsSphere(glm::vec3(0.f, -12.f, 0.f), 1.f));
+
+  EXPECT_TRUE(Frustum().intersectsAABB(glm::vec3(1e6f), size));
+}
+
+TEST(CollisionTest, FrustumGroundBounds) {
+  Frustum frustum = make_down_frustum();
+  glm::vec2 min, max;
+  ASSERT_TRUE(frustum.groundBounds(0.f, 2.f, min, max));
+  EXPECT_NEAR(-10.f, min.x, 1e-3f);
+  EXPECT_NEAR(-10.f, min.y, 1e-3f);
+  EXPECT_NEAR(10.f, max.x, 1e-3f);
+  EXPECT_NEAR(10.f, max.y, 1e-3f);
+
+  // Above the camera
+  EXPECT_FALSE(frustum.groundBounds(20.f, 30.f, min, max));
+}
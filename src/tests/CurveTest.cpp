@@ -0,0 +1,79 @@
+#include "rts/Curves.h"
+#include "gtest/gtest.h"
+
+using rts::FloatCurve;
+
+TEST(CurveTest, Samples) {
+  FloatCurve curve(0.f);
+  curve.addKeyframe(1.f, 10.f);
+  curve.addKeyframe(2.f, 20.f);
+  EXPECT_FLOAT_EQ(5.f, curve.linearSample(0.5f));
+  EXPECT_FLOAT_EQ(15.f, curve.linearSample(1.5f));
+  EXPECT_FLOAT_EQ(20.f, curve.linearSample(3.f));
+  EXPECT_FLOAT_EQ(0.f, curve.stepSample(0.5f));
+  EXPECT_FLOAT_EQ(10.f, curve.stepSample(1.f));
+  EXPECT_FLOAT_EQ(20.f, curve.stepSample(2.5f));
+
+  // Later samples are replaced
+  curve.addKeyframe(1.5f, 0.f);
+  EXPECT_EQ(3, curve.size());
+  EXPECT_FLOAT_EQ(0.f, curve.linearSample(2.f));
+}
+
+TEST(CurveTest, ForgetsOldSamples) {
+  FloatCurve curve(0.f, 1.f, 8);
+  for (int i = 1; i <= 20; i++) {
+    curve.addKeyframe(i * 0.25f, i);
+  }
+  // One sample at or before 5 - 1 is kept to interpolate from
+  EXPECT_EQ(5, curve.size());
+  EXPECT_FLOAT_EQ(16.f, curve.linearSample(1.f));
+  EXPECT_FLOAT_EQ(18.5f, curve.linearSample(4.625f));
+
+  // The cap applies however close together samples are
+  for (int i = 0; i < 20; i++) {
+    curve.addKeyframe(5.f + i * 0.001f, i);
+  }
+  EXPECT_EQ(8, curve.size());
+}
+
+// A 40 minute match, with positions at 20 Hz and predicted samples every
+// 60 Hz frame.  Memory must not grow with the length of the match.
+TEST(CurveTest, SoakStaysBounded) {
+  rts::Vec3Curve snapshots(glm::vec3(0.f));
+  rts::Vec3Curve frames(glm::vec3(0.f));
+  const int kFrames = 40 * 60 * 60;
+  size_t snapshot_capacity = 0;
+  size_t frame_capacity = 0;
+  for (int i = 1; i <= kFrames; i++) {
+    const float t = i / 60.f;
+    if (i % 3 == 0) {
+      snapshots.addKeyframe(t, glm::vec3(t, 0.f, 0.f));
+    }
+    frames.addKeyframe(t, glm::vec3(t, 0.f, 0.f));
+    const float render_t = t - static_cast<float>(MAX_RENDER_DELAY);
+    if (render_t > 0.f) {
+      ASSERT_NEAR(render_t, snapshots.linearSample(render_t).x, 1e-2);
+      ASSERT_NEAR(render_t, frames.linearSample(render_t).x, 1e-2);
+    }
+    if (i == kFrames / 10) {
+      snapshot_capacity = snapshots.capacity();
+      frame_capacity = frames.capacity();
+    }
+  }
+  EXPECT_EQ(snapshot_capacity, snapshots.capacity());
+  EXPECT_EQ(frame_capacity, frames.capacity());
+  EXPECT_LE(frames.capacity(), rts::CURVE_MAX_SAMPLES);
+}
+
+TEST(CurveTest, ResetKeepsMemory) {
+  FloatCurve curve(0.f);
+  for (int i = 1; i <= 100; i++) {
+    curve.addKeyframe(i * 0.01f, i);
+  }
+  const size_t capacity = curve.capacity();
+  curve.reset(5.f);
+  EXPECT_EQ(1, curve.size());
+  EXPECT_EQ(capacity, curve.capacity());
+  EXPECT_FLOAT_EQ(5.f, curve.linearSample(1.f));
+}
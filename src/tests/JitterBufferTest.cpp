@@ -0,0 +1,51 @@
+#include <string>
+#include "common/JitterBuffer.h"
+#include "gtest/gtest.h"
+
+TEST(JitterBufferTest, PlaysOutInOrderWhenDue) {
+  JitterBuffer<std::string> buffer;
+  // Arrive out of order, 50ms late on the server's clock
+  buffer.push(0.3, 0.1, 0.35, "c");
+  buffer.push(0.1, 0.1, 0.15, "a");
+  buffer.push(0.2, 0.1, 0.25, "b");
+  EXPECT_EQ(3, buffer.size());
+  EXPECT_NEAR(0.0, buffer.getNextDueTime(), 1e-9);
+
+  std::string value;
+  ASSERT_TRUE(buffer.pop(0.0, value));
+  EXPECT_EQ("a", value);
+  // b is the interpolation target once render time passes a
+  EXPECT_FALSE(buffer.pop(0.09, value));
+  ASSERT_TRUE(buffer.pop(0.25, value));
+  EXPECT_EQ("b", value);
+  ASSERT_TRUE(buffer.pop(0.25, value));
+  EXPECT_EQ("c", value);
+  EXPECT_FALSE(buffer.pop(1.0, value));
+  EXPECT_NEAR(0.3, buffer.getLastPlayed(), 1e-9);
+}
+
+TEST(JitterBufferTest, DropsLateAndDuplicateSnapshots) {
+  JitterBuffer<std::string> buffer;
+  buffer.push(0.2, 0.1, 0.25, "b");
+  std::string value;
+  ASSERT_TRUE(buffer.pop(0.1, value));
+
+  // Older than what was played
+  buffer.push(0.1, 0.1, 0.4, "a");
+  buffer.push(0.3, 0.1, 0.35, "c");
+  buffer.push(0.3, 0.1, 0.36, "c");
+  EXPECT_EQ(2, buffer.getDropped());
+  EXPECT_EQ(1, buffer.size());
+}
+
+TEST(JitterBufferTest, DelayFollowsArrivalJitter) {
+  JitterBuffer<int> steady, jittery;
+  for (int i = 0; i < 100; i++) {
+    double t = 0.1 * i;
+    steady.push(t, 0.1, t + 0.05, i);
+    // Same average lateness, but +-40ms
+    jittery.push(t, 0.1, t + 0.05 + (i % 2 ? 0.04 : -0.04), i);
+  }
+  EXPECT_NEAR(0.15, steady.getClock().getDelay(), 0.005);
+  EXPECT_GT(jittery.getClock().getDelay(), 0.2);
+}
@@ -0,0 +1,86 @@
+#include "common/JsonCursor.h"
+#include "common/Exception.h"
+#include "gtest/gtest.h"
+
+TEST(JsonCursorTest, WalksStructure) {
+  const std::string text =
+    "{\"pos\": [[0.5, [1, -2.25]]], \"alive\": [[1e-1, true]],"
+    " \"name\": \"a\\\"b\\u00e9\", \"skipped\": {\"x\": [null, {}]}}";
+  JsonCursor cursor(text);
+  cursor.beginObject();
+  std::string key;
+
+  ASSERT_TRUE(cursor.nextKey(key));
+  EXPECT_EQ("pos", key);
+  cursor.beginArray();
+  ASSERT_TRUE(cursor.nextElement());
+  cursor.beginArray();
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_FLOAT_EQ(0.5f, cursor.readFloat());
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_EQ(JsonCursor::ARRAY, cursor.peek());
+  cursor.beginArray();
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_EQ(1, cursor.readUInt64());
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_FLOAT_EQ(-2.25f, cursor.readFloat());
+  EXPECT_FALSE(cursor.nextElement());
+  EXPECT_FALSE(cursor.nextElement());
+  EXPECT_FALSE(cursor.nextElement());
+
+  ASSERT_TRUE(cursor.nextKey(key));
+  EXPECT_EQ("alive", key);
+  cursor.beginArray();
+  ASSERT_TRUE(cursor.nextElement());
+  cursor.beginArray();
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_FLOAT_EQ(0.1f, cursor.readFloat());
+  ASSERT_TRUE(cursor.nextElement());
+  EXPECT_TRUE(cursor.readBool());
+  EXPECT_FALSE(cursor.nextElement());
+  EXPECT_FALSE(cursor.nextElement());
+
+  ASSERT_TRUE(cursor.nextKey(key));
+  EXPECT_EQ("name", key);
+  EXPECT_EQ("a\"b\xc3\xa9", cursor.readString());
+
+  ASSERT_TRUE(cursor.nextKey(key));
+  EXPECT_EQ("skipped", key);
+  cursor.skipValue();
+  EXPECT_FALSE(cursor.nextKey(key));
+  EXPECT_TRUE(cursor.atEnd());
+}
+
+TEST(JsonCursorTest, ReadsValuesLikeJsoncpp) {
+  const std::string text =
+    "[{\"type\":\"chat\",\"chats\":[{\"pid\":100,\"msg\":\"hi\\n\"}]},"
+    " -1, 4294967296, 1.5, false, null, \"\\ud83d\\ude00\"]";
+  Json::Value expected;
+  ASSERT_TRUE(Json::Reader().parse(text, expected));
+
+  JsonCursor cursor(text);
+  Json::Value value;
+  cursor.readValue(value);
+  EXPECT_EQ(expected, value);
+  EXPECT_EQ(Json::FastWriter().write(expected),
+      Json::FastWriter().write(value));
+
+  // Seeking back reads the same again
+  cursor.seek(1);
+  cursor.readValue(value);
+  EXPECT_EQ(expected[0], value);
+}
+
+TEST(JsonCursorTest, RejectsMalformed) {
+  const std::string unterminated_text = "[1, 2";
+  JsonCursor unterminated(unterminated_text);
+  EXPECT_THROW(unterminated.skipValue(), network_exception);
+
+  const std::string bad_literal_text = "[nul]";
+  JsonCursor bad_literal(bad_literal_text);
+  EXPECT_THROW(bad_literal.skipValue(), network_exception);
+
+  const std::string wrong_type_text = "\"pos\"";
+  JsonCursor wrong_type(wrong_type_text);
+  EXPECT_THROW(wrong_type.beginArray(), network_exception);
+}
@@ -0,0 +1,173 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include "common/LinkSimulator.h"
+#include "gtest/gtest.h"
+
+// Pushes count datagrams at t = 0 and returns when each arrives, to within
+// a tenth of a millisecond.
+static std::vector<double> arrival_times(LinkSimulator &link, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    link.push(std::to_string(i), 0.0);
+  }
+  std::vector<double> ret;
+  std::string packet;
+  for (double t = 0.0; t < 10.0 && ret.size() < count; t += 1e-4) {
+    while (link.pop(packet, t)) {
+      ret.push_back(t);
+    }
+  }
+  return ret;
+}
+
+static double mean(const std::vector<double> &values) {
+  double sum = 0.0;
+  for (double v : values) {
+    sum += v;
+  }
+  return sum / values.size();
+}
+
+TEST(LinkSimulatorTest, DelayDistributions) {
+  link_conditions conditions;
+  conditions.latency = 0.1;
+  conditions.jitter = 0.02;
+
+  conditions.distribution = LINK_DELAY_UNIFORM;
+  LinkSimulator uniform(conditions, 1);
+  auto delays = arrival_times(uniform, 5000);
+  ASSERT_EQ(5000u, delays.size());
+  EXPECT_NEAR(0.1, mean(delays), 0.002);
+  for (double delay : delays) {
+    EXPECT_LE(0.08, delay);
+    EXPECT_GE(0.1201, delay);
+  }
+
+  conditions.distribution = LINK_DELAY_NORMAL;
+  LinkSimulator normal(conditions, 2);
+  delays = arrival_times(normal, 5000);
+  ASSERT_EQ(5000u, delays.size());
+  double m = mean(delays);
+  double variance = 0.0;
+  for (double delay : delays) {
+    variance += (delay - m) * (delay - m) / delays.size();
+  }
+  EXPECT_NEAR(0.1, m, 0.002);
+  EXPECT_NEAR(0.02, sqrt(variance), 0.002);
+
+  conditions.distribution = LINK_DELAY_PARETO;
+  LinkSimulator pareto(conditions, 3);
+  delays = arrival_times(pareto, 5000);
+  ASSERT_EQ(5000u, delays.size());
+  EXPECT_NEAR(0.12, mean(delays), 0.003);
+  for (double delay : delays) {
+    EXPECT_LE(0.1, delay);
+  }
+}
+
+TEST(LinkSimulatorTest, BandwidthCapQueuesAndOverflows) {
+  link_conditions conditions;
+  conditions.bandwidth = 10000;
+  conditions.queueLimit = 3000;
+  LinkSimulator link(conditions);
+
+  // Each datagram takes 0.1s to send, and only three fit in the queue
+  for (int i = 0; i < 10; i++) {
+    link.push(std::string(1000, 'a' + i), 0.0);
+  }
+  EXPECT_EQ(7u, link.getOverflowed());
+
+  std::string packet;
+  EXPECT_FALSE(link.pop(packet, 0.099));
+  EXPECT_TRUE(link.pop(packet, 0.1));
+  EXPECT_EQ(std::string(1000, 'a'), packet);
+  EXPECT_FALSE(link.pop(packet, 0.199));
+  EXPECT_TRUE(link.pop(packet, 0.2));
+  EXPECT_TRUE(link.pop(packet, 0.3001));
+  EXPECT_EQ(std::string(1000, 'c'), packet);
+  EXPECT_FALSE(link.pop(packet, 1.0));
+
+  // Once the queue drains, the link is free again
+  link.push("late", 1.0);
+  EXPECT_TRUE(link.pop(packet, 1.0004));
+}
+
+TEST(LinkSimulatorTest, BurstLossKeepsRate) {
+  link_conditions conditions;
+  conditions.loss = 0.1;
+  conditions.lossBurst = 5;
+  LinkSimulator link(conditions, 4);
+
+  const int kPackets = 200000;
+  size_t lost = 0, bursts = 0;
+  bool last_lost = false;
+  std::string packet;
+  for (int i = 0; i < kPackets; i++) {
+    link.push("x", i);
+    bool was_lost = !link.pop(packet, i);
+    lost += was_lost;
+    bursts += was_lost && !last_lost;
+    last_lost = was_lost;
+  }
+  EXPECT_EQ(lost, link.getDropped());
+  EXPECT_NEAR(0.1, static_cast<double>(lost) / kPackets, 0.01);
+  EXPECT_NEAR(5.0, static_cast<double>(lost) / bursts, 0.5);
+}
+
+TEST(LinkSimulatorTest, ReordersAndDuplicates) {
+  link_conditions conditions;
+  conditions.latency = 0.05;
+  conditions.reorder = 0.1;
+  conditions.duplicate = 0.1;
+  LinkSimulator link(conditions, 5);
+
+  const int kPackets = 10000;
+  std::vector<int> arrived;
+  std::string packet;
+  for (int i = 0; i < kPackets + 100; i++) {
+    double t = i * 0.001;
+    if (i < kPackets) {
+      link.push(std::to_string(i), t);
+    }
+    while (link.pop(packet, t)) {
+      arrived.push_back(std::stoi(packet));
+    }
+  }
+
+  EXPECT_NEAR(0.1 * kPackets, link.getReordered(), 100);
+  EXPECT_NEAR(0.1 * kPackets, link.getDuplicated(), 100);
+  EXPECT_EQ(kPackets + link.getDuplicated(), arrived.size());
+  int out_of_order = 0;
+  for (size_t i = 1; i < arrived.size(); i++) {
+    out_of_order += arrived[i] < arrived[i - 1];
+  }
+  EXPECT_LT(500, out_of_order);
+}
+
+TEST(LinkSimulatorTest, ScriptChangesConditions) {
+  Json::Value config;
+  config["enabled"] = 0;
+  config["script"][0]["latency"] = 0.01;
+  EXPECT_FALSE(make_link_simulator(config, 0));
+
+  config["enabled"] = 1;
+  config["script"][0]["at"] = 0.0;
+  config["script"][1]["at"] = 1.0;
+  config["script"][1]["loss"] = 1.0;
+  config["script"][1]["distribution"] = "pareto";
+  auto link = make_link_simulator(config, 0);
+  ASSERT_TRUE(link.get());
+
+  std::string packet;
+  link->push("before", 0.5);
+  EXPECT_FALSE(link->pop(packet, 0.509));
+  EXPECT_TRUE(link->pop(packet, 0.51));
+  EXPECT_EQ(0.0, link->getConditions().loss);
+
+  link->push("after", 1.0);
+  EXPECT_FALSE(link->pop(packet, 2.0));
+  EXPECT_EQ(1u, link->getDropped());
+  // Later steps keep what they don't change
+  EXPECT_EQ(0.01, link->getConditions().latency);
+  EXPECT_EQ(LINK_DELAY_PARETO, link->getConditions().distribution);
+}
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "common/Logger.h"
+#include "gtest/gtest.h"
+
+TEST(LoggerTest, ParseSeverity) {
+  LogSeverity severity;
+  EXPECT_TRUE(parse_log_severity("WARNING", severity));
+  EXPECT_EQ(LOG_SEVERITY_WARNING, severity);
+  EXPECT_STREQ("WARNING", log_severity_name(severity));
+  EXPECT_FALSE(parse_log_severity("LOUD", severity));
+}
+
+// The logger can only be started once per process
+static void init_logger_once() {
+  static bool initialized = false;
+  if (!initialized) {
+    Logger::initLogger();
+    initialized = true;
+  }
+}
+
+TEST(LoggerTest, WritesToFileSink) {
+  const std::string filename = "LoggerTest.log";
+  remove(filename.c_str());
+
+  init_logger_once();
+  Logger::get()->addFileSink(filename);
+  Logger::setMinSeverity(LOG_SEVERITY_INFO);
+
+  LOG(INFO) << "first " << 1 << '\n';
+  LOG(DEBUG) << "filtered\n";
+  std::thread other([]() {
+    LOG(WARNING) << "from another thread";
+  });
+  other.join();
+  LOG(ERROR) << "truncated "
+    << std::string(2 * log_record::kMaxMessageLength, 'x');
+  Logger::get()->flush();
+  Logger::setMinSeverity(LOG_SEVERITY_DEBUG);
+
+  std::ifstream file(filename.c_str());
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  ASSERT_EQ(3, lines.size());
+  EXPECT_NE(std::string::npos, lines[0].find("LoggerTest.cpp"));
+  EXPECT_NE(std::string::npos, lines[0].find(" INFO - first 1"));
+  EXPECT_NE(std::string::npos,
+      lines[1].find(" WARNING - from another thread"));
+  EXPECT_NE(std::string::npos, lines[2].find(" ERROR - truncated xxx"));
+  EXPECT_GT(log_record::kMaxMessageLength + 100, lines[2].size());
+
+  remove(filename.c_str());
+}
+
+TEST(LoggerTest, ReusesBuffersOfExitedThreads) {
+  init_logger_once();
+  auto log_from_new_thread = []() {
+    std::thread([]() {
+      LOG(INFO) << "short lived thread";
+    }).join();
+    Logger::get()->flush();
+  };
+
+  log_from_new_thread();
+  const size_t buffers = Logger::get()->getBufferCount();
+  for (int i = 0; i < 8; i++) {
+    log_from_new_thread();
+  }
+  EXPECT_EQ(buffers, Logger::get()->getBufferCount());
+}
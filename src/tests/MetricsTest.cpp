@@ -0,0 +1,110 @@
+#include <sstream>
+#include "common/Metrics.h"
+#include "gtest/gtest.h"
+
+TEST(MetricsTest, BucketBounds) {
+  // Every value lands in a bucket whose bound is at least the value and
+  // within the relative error of the sub bucket count.
+  for (uint64_t v = 0; v < 100000; v += 7) {
+    uint64_t bound = Histogram::bucketUpperBound(Histogram::bucketIndex(v));
+    EXPECT_LE(v, bound);
+    EXPECT_LE(bound - v, v / Histogram::kSubBuckets);
+  }
+  // Buckets are contiguous
+  for (size_t i = 1; i < 200; i++) {
+    EXPECT_EQ(i, Histogram::bucketIndex(Histogram::bucketUpperBound(i - 1) + 1));
+    EXPECT_EQ(i, Histogram::bucketIndex(Histogram::bucketUpperBound(i)));
+  }
+}
+
+TEST(MetricsTest, HistogramPercentiles) {
+  Histogram histogram(1e-6, 1000000);
+  for (int i = 1; i <= 1000; i++) {
+    histogram.record(i * 1e-4);
+  }
+  EXPECT_EQ(1000, histogram.getCount());
+  EXPECT_NEAR(50.05, histogram.getSum(), 1e-3);
+
+  const double tolerance = 1.0 + 1.0 / Histogram::kSubBuckets;
+  double p50 = histogram.getPercentile(50);
+  EXPECT_GE(p50, 0.05);
+  EXPECT_LE(p50, 0.05 * tolerance);
+  double p99 = histogram.getPercentile(99);
+  EXPECT_GE(p99, 0.099);
+  EXPECT_LE(p99, 0.099 * tolerance);
+
+  // Values past the max are clamped into the last bucket
+  histogram.record(100.0);
+  EXPECT_EQ(
+      histogram.getBucketBound(histogram.getBucketCount() - 1),
+      histogram.getPercentile(100));
+}
+
+TEST(MetricsTest, SkewedPercentiles) {
+  // Latency like: mostly small, with a long tail.  The i-th smallest of
+  // 10000 values is i^2 microseconds.
+  Histogram histogram(1e-6, 1000000000);
+  for (int i = 10000; i > 0; i--) {
+    histogram.record(1e-6 * i * i);
+  }
+  EXPECT_NEAR(25.0, histogram.getPercentile(50), 25.0 * 0.04);
+  EXPECT_NEAR(98.01, histogram.getPercentile(99), 98.01 * 0.04);
+  EXPECT_NEAR(99.8001, histogram.getPercentile(99.9), 99.8001 * 0.04);
+  EXPECT_NEAR(1e-6, histogram.getPercentile(0.01), 1e-9);
+}
+
+TEST(MetricsTest, ExportsCoarseBuckets) {
+  size_t exported = 0;
+  for (size_t i = 0; i < Histogram::bucketIndex(1 << 20); i++) {
+    exported += Histogram::isExportedBucket(i);
+  }
+  // One bucket for each of 0..3, then four per power of two
+  EXPECT_EQ(Histogram::kExportSubBuckets * (20 - 1), exported);
+}
+
+TEST(MetricsTest, RegistryReturnsSameMetric) {
+  auto registry = MetricsRegistry::get();
+  auto a = registry->counter("test_requests_total", "Requests",
+      {{"kind", "a"}});
+  auto b = registry->counter("test_requests_total", "Requests",
+      {{"kind", "b"}});
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a, registry->counter("test_requests_total", "Requests",
+        {{"kind", "a"}}));
+
+  a->inc();
+  a->inc(2);
+  EXPECT_EQ(3, a->get());
+
+  auto gauge = registry->gauge("test_players", "Players");
+  gauge->set(2);
+  gauge->add(0.5);
+  EXPECT_EQ(2.5, gauge->get());
+}
+
+TEST(MetricsTest, PrometheusFormat) {
+  auto registry = MetricsRegistry::get();
+  registry->counter("test_format_total", "A counter",
+      {{"name", "quote\"d"}})->inc(5);
+  auto histogram = registry->histogram("test_format_seconds", "A histogram",
+      1e-3, 10);
+  histogram->record(0.002);
+  histogram->record(0.009);
+
+  std::ostringstream os;
+  registry->writePrometheus(os);
+  std::string text = os.str();
+
+  EXPECT_NE(std::string::npos, text.find(
+        "# TYPE test_format_total counter\n"
+        "test_format_total{name=\"quote\\\"d\"} 5\n"));
+  EXPECT_NE(std::string::npos, text.find(
+        "# TYPE test_format_seconds histogram\n"));
+  EXPECT_NE(std::string::npos, text.find(
+        "test_format_seconds_bucket{le=\"0.001\"} 0\n"
+        "test_format_seconds_bucket{le=\"0.002\"} 1\n"));
+  EXPECT_NE(std::string::npos, text.find(
+        "test_format_seconds_bucket{le=\"+Inf\"} 2\n"
+        "test_format_seconds_sum 0.011\n"
+        "test_format_seconds_count 2\n"));
+}
@@ -0,0 +1,322 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/LinkSimulator.h"
+#include "common/NetChannel.h"
+#include "common/UDPConnection.h"
+#include "gtest/gtest.h"
+
+// Moves packets between two endpoints through simulated links.
+struct endpoint_pair {
+  endpoint_pair(double loss, double latency)
+    : aToB(loss, latency, 1),
+      bToA(loss, latency, 2) {
+  }
+
+  void step(double t) {
+    std::string packet;
+    while (a.nextPacket(packet, t)) {
+      aToB.push(packet, t);
+    }
+    while (b.nextPacket(packet, t)) {
+      bToA.push(packet, t);
+    }
+    while (aToB.pop(packet, t)) {
+      EXPECT_TRUE(b.receivePacket(packet, t));
+    }
+    while (bToA.pop(packet, t)) {
+      EXPECT_TRUE(a.receivePacket(packet, t));
+    }
+  }
+
+  ChannelEndpoint a, b;
+  LinkSimulator aToB, bToA;
+};
+
+static std::string make_payload(int id, size_t size) {
+  std::string ret = std::to_string(id) + ":";
+  ret.resize(size, 'a' + id % 26);
+  return ret;
+}
+
+TEST(NetChannelTest, ReliableInOrderUnderLoss) {
+  endpoint_pair pair(0.2, 0.03);
+  const int kMessages = 200;
+  std::vector<std::string> sent;
+  int next_sequenced = 0;
+  std::vector<std::string> received;
+  int last_sequenced = -1;
+
+  double t = 0;
+  for (int step = 0; step < 4000; step++, t += 0.005) {
+    if (step % 10 == 0 && sent.size() < kMessages) {
+      // Every fifth message needs several fragments
+      size_t size = sent.size() % 5 == 0 ? 5000 : 40;
+      sent.push_back(make_payload(sent.size(), size));
+      pair.a.send(NET_CHANNEL_RELIABLE, sent.back());
+      pair.a.send(NET_CHANNEL_SEQUENCED, std::to_string(next_sequenced++));
+    }
+    pair.step(t);
+
+    NetChannel channel;
+    std::string payload;
+    while (pair.b.receive(channel, payload)) {
+      if (channel == NET_CHANNEL_RELIABLE) {
+        received.push_back(payload);
+      } else {
+        int id = std::stoi(payload);
+        EXPECT_GT(id, last_sequenced);
+        last_sequenced = id;
+      }
+    }
+  }
+
+  EXPECT_EQ(sent, received);
+  EXPECT_GT(pair.aToB.getDropped(), 0);
+  EXPECT_GT(pair.a.getPacketsLost(), 0);
+  EXPECT_EQ(0, pair.a.getReliableBacklog());
+  // Most snapshots make it, the last one is never lost for long
+  EXPECT_GT(last_sequenced, kMessages / 2);
+  EXPECT_NEAR(0.06, pair.a.getRTT(), 0.03);
+}
+
+TEST(NetChannelTest, FragmentsLargeMessages) {
+  endpoint_pair pair(0.0, 0.01);
+  std::string big = make_payload(7, 50000);
+  pair.a.send(NET_CHANNEL_RELIABLE, big);
+  pair.a.send(NET_CHANNEL_SEQUENCED, big);
+
+  std::vector<std::pair<NetChannel, std::string>> received;
+  for (double t = 0; t < 1.0; t += 0.005) {
+    pair.step(t);
+    NetChannel channel;
+    std::string payload;
+    while (pair.b.receive(channel, payload)) {
+      received.push_back(std::make_pair(channel, payload));
+    }
+  }
+  ASSERT_EQ(2, received.size());
+  EXPECT_EQ(NET_CHANNEL_RELIABLE, received[0].first);
+  EXPECT_EQ(big, received[0].second);
+  EXPECT_EQ(NET_CHANNEL_SEQUENCED, received[1].first);
+  EXPECT_EQ(big, received[1].second);
+}
+
+TEST(NetChannelTest, NewerSnapshotsReplaceQueuedOnes) {
+  ChannelEndpoint a, b;
+  a.send(NET_CHANNEL_SEQUENCED, "old");
+  a.send(NET_CHANNEL_SEQUENCED, "new");
+  std::string packet;
+  ASSERT_TRUE(a.nextPacket(packet, 0.0));
+  EXPECT_LE(packet.size(), ChannelEndpoint::kMaxPacketSize);
+  ASSERT_TRUE(b.receivePacket(packet, 0.0));
+
+  NetChannel channel;
+  std::string payload;
+  ASSERT_TRUE(b.receive(channel, payload));
+  EXPECT_EQ("new", payload);
+  EXPECT_FALSE(b.receive(channel, payload));
+}
+
+TEST(NetChannelTest, UnreliableMessagesArriveOutOfOrder) {
+  ChannelEndpoint a, b;
+  std::string first, second;
+  a.send(NET_CHANNEL_UNRELIABLE, "ping 1");
+  ASSERT_TRUE(a.nextPacket(first, 0.0));
+  a.send(NET_CHANNEL_UNRELIABLE, "ping 2");
+  a.send(NET_CHANNEL_SEQUENCED, "snapshot");
+  ASSERT_TRUE(a.nextPacket(second, 0.0));
+
+  // Neither is replaced, and a late one is still delivered
+  ASSERT_TRUE(b.receivePacket(second, 0.0));
+  ASSERT_TRUE(b.receivePacket(first, 0.0));
+  NetChannel channel;
+  std::string payload;
+  ASSERT_TRUE(b.receive(channel, payload));
+  EXPECT_EQ(NET_CHANNEL_UNRELIABLE, channel);
+  EXPECT_EQ("ping 2", payload);
+  ASSERT_TRUE(b.receive(channel, payload));
+  EXPECT_EQ("snapshot", payload);
+  ASSERT_TRUE(b.receive(channel, payload));
+  EXPECT_EQ("ping 1", payload);
+  EXPECT_FALSE(b.receive(channel, payload));
+  // A duplicate is not
+  ASSERT_TRUE(b.receivePacket(first, 0.0));
+  EXPECT_FALSE(b.receive(channel, payload));
+}
+
+TEST(NetChannelTest, PacesAndAdaptsSendRate) {
+  // Without acks the token bucket runs dry
+  ChannelEndpoint a;
+  a.send(NET_CHANNEL_RELIABLE, std::string(1 << 20, 'x'));
+  std::string packet;
+  size_t burst = 0;
+  while (a.nextPacket(packet, 0.0)) {
+    burst += packet.size();
+  }
+  EXPECT_GT(burst, 0);
+  EXPECT_LT(burst, 64 * 1024);
+
+  // Loss halves the rate, clean delivery grows it back
+  endpoint_pair lossy(0.3, 0.02);
+  endpoint_pair clean(0.0, 0.02);
+  double initial_rate = lossy.a.getSendRate();
+  for (double t = 0; t < 2.0; t += 0.005) {
+    lossy.a.send(NET_CHANNEL_SEQUENCED, std::string(3000, 'x'));
+    clean.a.send(NET_CHANNEL_SEQUENCED, std::string(3000, 'x'));
+    lossy.step(t);
+    clean.step(t);
+  }
+  EXPECT_LT(lossy.a.getSendRate(), initial_rate);
+  EXPECT_GT(clean.a.getSendRate(), initial_rate);
+}
+
+TEST(NetChannelTest, RejectsMalformedPackets) {
+  ChannelEndpoint a, b;
+  a.send(NET_CHANNEL_RELIABLE, "hello");
+  std::string packet;
+  ASSERT_TRUE(a.nextPacket(packet, 0.0));
+
+  EXPECT_FALSE(b.receivePacket(std::string(), 0.0));
+  EXPECT_FALSE(b.receivePacket("garbage", 0.0));
+  EXPECT_FALSE(b.receivePacket(packet.substr(0, packet.size() - 1), 0.0));
+  EXPECT_EQ(-1.0, b.getLastReceiveTime());
+
+  EXPECT_TRUE(b.receivePacket(packet, 0.0));
+  // Duplicates are not delivered twice
+  EXPECT_TRUE(b.receivePacket(packet, 0.0));
+  NetChannel channel;
+  std::string payload;
+  EXPECT_TRUE(b.receive(channel, payload));
+  EXPECT_FALSE(b.receive(channel, payload));
+}
+
+// A packet with one fragment, as a peer could forge it
+static std::string make_packet(
+    uint16_t sequence,
+    uint16_t message_id,
+    uint16_t count,
+    const std::string &data) {
+  const uint8_t header[] = {
+    0x54, 0x52,
+    static_cast<uint8_t>(sequence), static_cast<uint8_t>(sequence >> 8),
+    0, 0,
+    0, 0, 0, 0,
+    NET_CHANNEL_RELIABLE,
+    static_cast<uint8_t>(message_id), static_cast<uint8_t>(message_id >> 8),
+    0, 0,
+    static_cast<uint8_t>(count), static_cast<uint8_t>(count >> 8),
+    static_cast<uint8_t>(data.size()), static_cast<uint8_t>(data.size() >> 8),
+  };
+  return std::string(header, header + sizeof(header)) + data;
+}
+
+TEST(NetChannelTest, RejectsOversizedMessages) {
+  ChannelEndpoint b;
+  const std::string too_long(ChannelEndpoint::kMaxFragmentSize + 1, 'x');
+  EXPECT_FALSE(b.receivePacket(make_packet(0, 0, 0xffff, "x"), 0.0));
+  EXPECT_FALSE(b.receivePacket(make_packet(0, 0, 2, too_long), 0.0));
+  EXPECT_EQ(-1.0, b.getLastReceiveTime());
+
+  EXPECT_TRUE(b.receivePacket(make_packet(0, 0, 1, "x"), 0.0));
+  NetChannel channel;
+  std::string payload;
+  ASSERT_TRUE(b.receive(channel, payload));
+  EXPECT_EQ("x", payload);
+}
+
+TEST(NetChannelTest, FailsWhenReliableMessagesPileUp) {
+  // Message 0 never arrives, so nothing after it can be delivered
+  ChannelEndpoint b;
+  const uint16_t count = ChannelEndpoint::kMaxMessageFragments;
+  uint16_t id = 1;
+  while (b.receivePacket(make_packet(id, id, count, "x"), 0.0)) {
+    ASSERT_LT(id++, 100);
+  }
+  EXPECT_TRUE(b.hasFailed());
+  EXPECT_GT(id, 2);
+  EXPECT_FALSE(b.receivePacket(make_packet(id + 1, 0, 1, "x"), 0.0));
+}
+
+TEST(NetChannelTest, SequenceWraparound) {
+  EXPECT_TRUE(sequence_greater(1, 0));
+  EXPECT_TRUE(sequence_greater(0, 65535));
+  EXPECT_FALSE(sequence_greater(65535, 0));
+  EXPECT_FALSE(sequence_greater(5, 5));
+}
+
+TEST(NetChannelTest, UDPConnectionOverLoopback) {
+  auto server_sock = kissnet::udp_socket::create();
+  server_sock->bind("0");
+  auto client_sock = kissnet::udp_socket::create();
+  client_sock->bind("0");
+  client_sock->connect("127.0.0.1", server_sock->getLocalPort());
+
+  UDPConnection server(server_sock);
+  UDPConnection client(client_sock);
+  server.setLinkSimulator(
+      std::unique_ptr<LinkSimulator>(new LinkSimulator(0.1, 0.01, 3)));
+  client.setLinkSimulator(
+      std::unique_ptr<LinkSimulator>(new LinkSimulator(0.1, 0.01, 4)));
+
+  const int kMessages = 50;
+  for (int i = 0; i < kMessages; i++) {
+    Json::Value msg;
+    msg["i"] = i;
+    msg["pad"] = std::string(i * 100, 'x');
+    client.sendPacket(msg);
+  }
+  for (int i = 0; i < kMessages; i++) {
+    Json::Value msg = server.readNext(5000);
+    EXPECT_EQ(i, msg["i"].asInt());
+  }
+
+  // The server learned the client's address from its first packet
+  Json::Value reply;
+  reply["type"] = "render";
+  server.sendPacket(reply, NET_CHANNEL_SEQUENCED);
+  server.sendPacket(reply);
+  EXPECT_EQ("render", client.readNext(5000)["type"].asString());
+  EXPECT_GT(client.getBytesReceived(), 0);
+  EXPECT_TRUE(server.running());
+  EXPECT_TRUE(client.running());
+}
+
+TEST(NetChannelTest, UDPConnectionSyncsClocks) {
+  auto server_sock = kissnet::udp_socket::create();
+  server_sock->bind("0");
+  auto client_sock = kissnet::udp_socket::create();
+  client_sock->bind("0");
+  client_sock->connect("127.0.0.1", server_sock->getLocalPort());
+
+  UDPConnection server(server_sock);
+  UDPConnection client(client_sock);
+  auto link = std::unique_ptr<LinkSimulator>(new LinkSimulator(0.0, 0.02, 5));
+  client.setLinkSimulator(std::move(link));
+  // The server's clock is 100 seconds ahead
+  auto start = Clock::now();
+  server.setClock([=]() {
+    return 100.0 + std::chrono::duration<double>(Clock::now() - start).count();
+  });
+  client.setPingInterval(0.01);
+
+  Json::Value hello;
+  hello["type"] = "hello";
+  client.sendPacket(hello);
+  EXPECT_EQ("hello", server.readNext(5000)["type"].asString());
+
+  double remote = 0.0;
+  for (int i = 0; i < 500 && !client.getRemoteTime(remote); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_TRUE(client.getRemoteTime(remote));
+  double now = 100.0 + std::chrono::duration<double>(Clock::now() - start).count();
+  // Only one direction is delayed, which shifts the estimate by half of it
+  EXPECT_NEAR(now, remote, 0.02);
+  ClockSync sync = client.getClockSync();
+  EXPECT_NEAR(0.02, sync.getRTT(), 0.01);
+  // Pings and pongs never reach the queue
+  EXPECT_TRUE(server.drainQueue().empty());
+  EXPECT_TRUE(client.drainQueue().empty());
+}
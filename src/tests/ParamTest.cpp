@@ -0,0 +1,31 @@
+#include "common/ParamReader.h"
+#include "gtest/gtest.h"
+
+TEST(ParamTest, HandleSeesUpdates) {
+  setParam("test.param.size", glm::vec2(2.f));
+  Param<glm::vec2> size("test.param.size");
+  EXPECT_EQ(glm::vec2(2.f), size.get());
+  EXPECT_EQ(glm::vec2(2.f), vec2Param("test.param.size"));
+
+  setParam("test.param.size", glm::vec2(3.f));
+  EXPECT_EQ(glm::vec2(3.f), size.get());
+}
+
+TEST(ParamTest, UnchangedValueKeepsVersion) {
+  setParam("test.param.color", glm::vec3(1.f, 0.f, 0.f));
+  auto slot = ParamReader::get()->getSlot("test.param.color");
+  uint32_t version = slot->version;
+
+  setParam("test.param.color", glm::vec3(1.f, 0.f, 0.f));
+  EXPECT_EQ(version, slot->version);
+  setParam("test.param.color", glm::vec3(0.f, 1.f, 0.f));
+  EXPECT_NE(version, slot->version);
+
+  Param<glm::vec3> color("test.param.color");
+  EXPECT_EQ(glm::vec3(0.f, 1.f, 0.f), color.get());
+}
+
+TEST(ParamTest, MissingParamThrows) {
+  Param<int> missing("test.param.missing");
+  EXPECT_THROW(missing.get(), param_exception);
+}
@@ -0,0 +1,53 @@
+#include <thread>
+#include "common/Profiler.h"
+#include "gtest/gtest.h"
+
+static void profiled_frame(int nchildren) {
+  record_section("frame");
+  for (int i = 0; i < nchildren; i++) {
+    record_section("child");
+    record_section("grandchild");
+  }
+}
+
+TEST(ProfilerTest, BuildsFrameTrees) {
+  auto profiler = Profiler::get();
+  profiler->start();
+  profiler->reset();
+
+  profiled_frame(3);
+  profiled_frame(2);
+  std::thread other([]() {
+    profiled_frame(4);
+  });
+  other.join();
+
+  profiler->flush();
+  auto trees = profiler->getTrees();
+  profiler->stop();
+
+  ASSERT_EQ(2, trees.size());
+  uint64_t frames = 0, children = 0, grandchildren = 0;
+  for (auto &thread_pair : trees) {
+    ASSERT_EQ(1, thread_pair.second.count("frame"));
+    const auto &frame = thread_pair.second["frame"];
+    frames += frame.calls;
+    ASSERT_EQ(1, frame.children.size());
+    const auto &child = frame.children.find("child")->second;
+    children += child.calls;
+    EXPECT_LE(child.seconds, frame.seconds);
+    ASSERT_EQ(1, child.children.size());
+    grandchildren += child.children.find("grandchild")->second.calls;
+  }
+  EXPECT_EQ(3, frames);
+  EXPECT_EQ(9, children);
+  EXPECT_EQ(9, grandchildren);
+}
+
+TEST(ProfilerTest, DisabledRecordsNothing) {
+  auto profiler = Profiler::get();
+  profiler->reset();
+  profiled_frame(1);
+  profiler->flush();
+  EXPECT_TRUE(profiler->getTrees().empty());
+}
@@ -0,0 +1,41 @@
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include "rts/PropertyIDs.h"
+#include "gtest/gtest.h"
+
+// Reads the name: id pairs of EntityProperties in scripts/constants.js
+static std::map<std::string, uint32_t> read_script_property_ids() {
+  std::map<std::string, uint32_t> ret;
+  std::ifstream file("scripts/constants.js");
+  std::string line;
+  bool in_properties = false;
+  while (std::getline(file, line)) {
+    if (line.find("exports.EntityProperties = {") != std::string::npos) {
+      in_properties = true;
+    } else if (in_properties && line.find('}') != std::string::npos) {
+      break;
+    } else if (in_properties) {
+      std::istringstream fields(line);
+      std::string name, id;
+      std::getline(fields >> std::ws, name, ':');
+      std::getline(fields >> std::ws, id, ',');
+      ret[name] = strtoul(id.c_str(), nullptr, 10);
+    }
+  }
+  return ret;
+}
+
+// Run from the root of the repository, like the game
+TEST(PropertyIDsTest, MatchScripts) {
+  auto script_ids = read_script_property_ids();
+  ASSERT_FALSE(script_ids.empty());
+
+  std::map<std::string, uint32_t> native_ids;
+  for (const auto &property : rts::SCRIPT_PROPERTY_IDS) {
+    native_ids[property.name] = property.id;
+  }
+  EXPECT_EQ(script_ids, native_ids);
+}
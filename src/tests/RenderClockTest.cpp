@@ -0,0 +1,47 @@
+#include "common/RenderClock.h"
+#include "gtest/gtest.h"
+
+TEST(RenderClockTest, DelayCoversLatencyAndJitter) {
+  RenderClock clock;
+  // Snapshots every 100ms arriving 50ms late
+  for (int i = 0; i < 50; i++) {
+    clock.addSnapshot(0.1 * i, 0.1, 0.1 * i + 0.05);
+  }
+  EXPECT_NEAR(0.05, clock.getLateness(), 1e-6);
+  EXPECT_NEAR(0.15, clock.getDelay(), 1e-6);
+
+  // Alternating 30ms either way grows the margin quickly
+  for (int i = 50; i < 60; i++) {
+    clock.addSnapshot(0.1 * i, 0.1, 0.1 * i + 0.05 + (i % 2 ? 0.03 : -0.03));
+  }
+  EXPECT_GT(clock.getDelay(), 0.19);
+  const double jittery_delay = clock.getDelay();
+
+  // And shrinks slowly once the link is steady again
+  for (int i = 60; i < 70; i++) {
+    clock.addSnapshot(0.1 * i, 0.1, 0.1 * i + 0.05);
+  }
+  EXPECT_LT(clock.getDelay(), jittery_delay);
+  EXPECT_GT(clock.getDelay(), 0.17);
+}
+
+TEST(RenderClockTest, SlewsOrSnaps) {
+  RenderClock clock;
+  clock.addSnapshot(10.0, 0.1, 10.0);
+  EXPECT_NEAR(9.9, clock.getTarget(10.0), 1e-6);
+
+  // Close enough to slew, faster when behind, slower when ahead
+  float render_t = 9.85f;
+  EXPECT_NEAR(1.05f, clock.correct(render_t, 10.0), 1e-4);
+  EXPECT_EQ(9.85f, render_t);
+  render_t = 9.93f;
+  EXPECT_NEAR(0.97f, clock.correct(render_t, 10.0), 1e-4);
+  // Never by more than 10%
+  render_t = 9.7f;
+  EXPECT_NEAR(1.1f, clock.correct(render_t, 10.0), 1e-6);
+
+  // Too far, jump
+  render_t = 2.f;
+  EXPECT_EQ(1.f, clock.correct(render_t, 10.0));
+  EXPECT_NEAR(9.9f, render_t, 1e-4);
+}
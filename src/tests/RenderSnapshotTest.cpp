@@ -0,0 +1,163 @@
+#include "rts/RenderSnapshot.h"
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "common/Exception.h"
+#include "common/JsonCursor.h"
+#include "common/StringTable.h"
+#include "rts/PropertyIDs.h"
+#include "gtest/gtest.h"
+
+using namespace rts;
+
+// A batch as the server sends it: a render that defines its strings after
+// the entities that use them, and a chat.  Entity 10 sorts before 9 as a
+// key, so the decoders see the entities in different orders.
+static const char *BATCH =
+  "[{\"type\": \"render\", \"tick\": 42, \"t\": 4.2, \"dt\": 0.1,"
+  "  \"entities\": {"
+  "    \"9\": {"
+  "      \"alive\": [[4.1, true], [4.2, false]],"
+  "      \"model\": [[4.1, \"melee_unit\"]],"
+  "      \"properties\": [[4.1, [118468328, 1122719651, 7]]],"
+  "      \"pid\": [[4.1, 2]],"
+  "      \"tid\": [[4.1, 1]],"
+  "      \"pos\": [[4.1, [1.5, -2]], [4.2, [1.75, -2]]],"
+  "      \"size\": [[4.1, [1, 1, 0.5]]],"
+  "      \"angle\": [[4.1, 0.25]],"
+  "      \"sight\": [[4.1, 8]],"
+  "      \"speed\": [[4.1, 3]],"
+  "      \"visible\": [[4.1, [1, 2]]],"
+  "      \"actions\": [[4.1, [{\"name\": 0, \"icon\": 1, \"hotkey\": \"q\","
+  "        \"tooltip\": 2, \"targeting\": 1, \"range\": 5, \"radius\": 0,"
+  "        \"state\": 2, \"cooldown\": 1.5}]]],"
+  "      \"ui_info\": [[4.1, {\"minimap_icon\": 1, \"mana\": [10, 20],"
+  "        \"retreat\": true, \"capture\": [1, 2], \"capture_pid\": 2,"
+  "        \"path\": [[1, 2], [3, 4]], \"hotkey\": \"b\","
+  "        \"extra\": {\"note\": [1, \"x\"]},"
+  "        \"parts\": [{\"upgrades\": [{\"name\": 2}], \"name\": 0,"
+  "          \"health\": [50, 100], \"tooltip\": 2}]}]]"
+  "    },"
+  "    \"10\": {\"alive\": [[4.2, true]], \"pos\": [[4.2, [0, 0]]]}"
+  "  },"
+  "  \"events\": [{\"name\": \"Explosion\", \"params\": {\"pos\": [1, 2]}}],"
+  "  \"players\": [{\"pid\": 2, \"req\": 150.5, \"power\": 10}],"
+  "  \"teams\": [{\"tid\": 1, \"vps\": 3}],"
+  "  \"chats\": [],"
+  "  \"strings\": {\"first\": 0, \"values\": [\"Attack\", \"icon\", \"tip\"]}"
+  "}, {\"type\": \"chat\", \"chats\": [{\"pid\": 2, \"msg\": \"hi\"}]}]";
+
+// Decodes the renders of batch by parsing it into a Json::Value first
+static std::vector<render_snapshot> decode_dom(
+    const std::string &batch,
+    StringTable &strings) {
+  Json::Value messages;
+  Json::Reader().parse(batch, messages);
+  std::vector<render_snapshot> ret;
+  for (const auto &message : messages) {
+    if (message["type"] == "render") {
+      ret.emplace_back();
+      decode_render(message, strings, ret.back());
+    }
+  }
+  return ret;
+}
+
+static std::vector<server_message> decode_streaming(
+    const std::string &batch,
+    StringTable &strings) {
+  JsonCursor cursor(batch);
+  std::vector<server_message> ret;
+  cursor.beginArray();
+  while (cursor.nextElement()) {
+    ret.emplace_back();
+    decode_message(cursor, strings, ret.back());
+  }
+  return ret;
+}
+
+TEST(RenderSnapshotTest, DecodersAgree) {
+  StringTable dom_strings;
+  StringTable strings;
+  const auto dom = decode_dom(BATCH, dom_strings);
+  const auto streaming = decode_streaming(BATCH, strings);
+  ASSERT_EQ(1u, dom.size());
+  ASSERT_EQ(2u, streaming.size());
+  EXPECT_EQ("render", streaming[0].type);
+  EXPECT_EQ(42, streaming[0].tick.asInt());
+  EXPECT_EQ("", diff_render(dom[0], streaming[0].render));
+
+  // Check the decoders didn't agree on getting it wrong
+  const render_snapshot &render = streaming[0].render;
+  ASSERT_EQ(2u, render.entities.size());
+  const entity_snapshot &e = render.entities[0];
+  EXPECT_EQ(9u, e.game_id);
+  ASSERT_EQ(2u, e.alive.size());
+  EXPECT_FALSE(e.alive[1].second);
+  EXPECT_EQ(GameEntity::P_UNIT | GameEntity::P_MOBILE, e.properties);
+  ASSERT_EQ(1u, e.actions.size());
+  ASSERT_EQ(1u, e.actions[0].second.size());
+  const UIAction &action = e.actions[0].second[0];
+  EXPECT_EQ(9u, action.owner_id);
+  EXPECT_EQ("Attack", action.name.str());
+  EXPECT_EQ('q', action.hotkey);
+  EXPECT_EQ(UIAction::COOLDOWN, action.state);
+  ASSERT_EQ(1u, e.ui_info.size());
+  const GameEntity::UIInfo &info = e.ui_info[0].second;
+  EXPECT_EQ("icon", info.minimap_icon.str());
+  ASSERT_EQ(1u, info.parts.size());
+  ASSERT_EQ(1u, info.parts[0].upgrades.size());
+  EXPECT_EQ("Attack", info.parts[0].upgrades[0].part.str());
+  EXPECT_EQ("tip", info.parts[0].upgrades[0].name.str());
+  EXPECT_EQ(2u, info.path.size());
+  EXPECT_EQ("x", info.extra["note"][1].asString());
+  EXPECT_EQ(10u, render.entities[1].game_id);
+  EXPECT_EQ(1u, render.events.size());
+  ASSERT_EQ(1u, render.players.size());
+  EXPECT_FLOAT_EQ(150.5f, render.players[0].requisition);
+  EXPECT_EQ("hi", streaming[1].render.chats[0]["msg"].asString());
+}
+
+TEST(RenderSnapshotTest, DiffFindsChanges) {
+  StringTable strings;
+  const auto messages = decode_streaming(BATCH, strings);
+  render_snapshot changed = messages[0].render;
+  EXPECT_EQ("", diff_render(messages[0].render, changed));
+  changed.entities[0].ui_info[0].second.parts[0].health.x = 49;
+  EXPECT_EQ("entity 9 ui_info", diff_render(messages[0].render, changed));
+  changed = messages[0].render;
+  changed.entities[1].game_id = 11;
+  EXPECT_EQ("entity 11", diff_render(changed, messages[0].render));
+}
+
+TEST(RenderSnapshotTest, DropsUndefinedStrings) {
+  // Uses string 3, which no message defines
+  const std::string batch =
+    "[{\"type\": \"render\", \"t\": 1, \"dt\": 0.1, \"entities\": {"
+    "  \"9\": {\"ui_info\": [[1, {\"minimap_icon\": 3}]]}},"
+    "  \"events\": [], \"players\": [], \"teams\": [], \"chats\": [],"
+    "  \"strings\": {\"first\": 0, \"values\": [\"a\", \"b\", \"c\"]}}]";
+  StringTable strings;
+  EXPECT_THROW(decode_streaming(batch, strings), network_exception);
+  // The next batch still decodes
+  EXPECT_EQ(2u, decode_streaming(BATCH, strings).size());
+}
+
+TEST(RenderSnapshotTest, DropsReorderedDefinitions) {
+  // Defines strings from 3 on, before 0-2 arrived
+  const std::string batch =
+    "[{\"type\": \"render\", \"t\": 1, \"dt\": 0.1, \"entities\": {},"
+    "  \"events\": [], \"players\": [], \"teams\": [], \"chats\": [],"
+    "  \"strings\": {\"first\": 3, \"values\": [\"d\"]}}]";
+  StringTable strings;
+  EXPECT_THROW(decode_streaming(batch, strings), network_exception);
+  EXPECT_EQ(0u, strings.size());
+}
+
+TEST(RenderSnapshotTest, PropertyFromID) {
+  EXPECT_EQ(property_mask(GameEntity::P_UNIT), property_from_id(P_UNIT_ID));
+  EXPECT_EQ(
+      property_mask(ModelEntity::P_COLLIDABLE),
+      property_from_id(P_COLLIDABLE_ID));
+  EXPECT_EQ(0u, property_from_id(7));
+}
@@ -0,0 +1,41 @@
+#include "common/RingBuffer.h"
+#include "gtest/gtest.h"
+
+TEST(RingBufferTest, PushesAndPops) {
+  RingBuffer<int> buf(8);
+  EXPECT_TRUE(buf.empty());
+  for (int i = 0; i < 5; i++) {
+    buf.push_back(i);
+  }
+  buf.pop_front();
+  buf.pop_front();
+  ASSERT_EQ(3, buf.size());
+  EXPECT_EQ(2, buf.front());
+  EXPECT_EQ(4, buf.back());
+
+  // Wraps around the end of the block, then grows in order
+  for (int i = 5; i < 12; i++) {
+    buf.push_back(i);
+  }
+  ASSERT_EQ(8, buf.size());
+  for (size_t i = 0; i < buf.size(); i++) {
+    EXPECT_EQ(i + 4, buf[i]);
+  }
+}
+
+TEST(RingBufferTest, DropsOldestWhenFull) {
+  RingBuffer<int> buf(4);
+  for (int i = 0; i < 100; i++) {
+    buf.push_back(i);
+  }
+  ASSERT_EQ(4, buf.size());
+  EXPECT_EQ(4, buf.capacity());
+  EXPECT_EQ(96, buf.front());
+  EXPECT_EQ(99, buf.back());
+
+  buf.truncate(1);
+  buf.push_back(100);
+  ASSERT_EQ(2, buf.size());
+  EXPECT_EQ(96, buf[0]);
+  EXPECT_EQ(100, buf[1]);
+}
@@ -0,0 +1,47 @@
+#include <memory>
+#include <thread>
+#include "common/SPSCQueue.h"
+#include "gtest/gtest.h"
+
+TEST(SPSCQueueTest, FillsAndDrains) {
+  SPSCQueue<std::unique_ptr<int>> queue(2);
+  std::unique_ptr<int> value(new int(1));
+  EXPECT_TRUE(queue.push(value));
+  EXPECT_EQ(nullptr, value);
+  value.reset(new int(2));
+  EXPECT_TRUE(queue.push(value));
+  value.reset(new int(3));
+  EXPECT_FALSE(queue.push(value));
+  EXPECT_EQ(3, *value);
+
+  for (int i = 1; i <= 2; i++) {
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(SPSCQueueTest, KeepsOrderAcrossThreads) {
+  const int kCount = 100000;
+  SPSCQueue<int> queue(16);
+  std::thread producer([&]() {
+    for (int i = 0; i < kCount; i++) {
+      int value = i;
+      while (!queue.push(value)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  while (expected < kCount) {
+    int value;
+    if (queue.pop(value)) {
+      ASSERT_EQ(expected, value);
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+}
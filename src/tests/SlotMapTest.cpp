@@ -0,0 +1,45 @@
+#include "common/SlotMap.h"
+#include "gtest/gtest.h"
+
+TEST(SlotMapTest, FindsByHandle) {
+  SlotMap<int> map;
+  auto a = map.insert(1);
+  auto b = map.insert(2);
+  auto c = map.insert(3);
+  EXPECT_NE(0, a);
+  EXPECT_EQ(3, map.size());
+
+  // Erasing moves the last value, handles still find theirs
+  EXPECT_TRUE(map.erase(a));
+  EXPECT_FALSE(map.erase(a));
+  ASSERT_EQ(2, map.size());
+  EXPECT_EQ(nullptr, map.find(a));
+  EXPECT_EQ(2, *map.find(b));
+  EXPECT_EQ(3, *map.find(c));
+
+  int sum = 0;
+  for (int v : map) {
+    sum += v;
+  }
+  EXPECT_EQ(5, sum);
+  for (size_t i = 0; i < map.size(); i++) {
+    EXPECT_EQ(*map.find(map.handleAt(i)), *(map.begin() + i));
+  }
+}
+
+TEST(SlotMapTest, ReusedSlotsGetNewHandles) {
+  SlotMap<int> map;
+  auto a = map.insert(1);
+  map.erase(a);
+  auto b = map.insert(2);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(nullptr, map.find(a));
+  EXPECT_EQ(2, *map.find(b));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(nullptr, map.find(b));
+  auto c = map.insert(3);
+  EXPECT_NE(b, c);
+  EXPECT_EQ(3, *map.find(c));
+}
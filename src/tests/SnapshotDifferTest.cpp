@@ -0,0 +1,193 @@
+#include "common/SnapshotDiffer.h"
+#include "gtest/gtest.h"
+
+static Json::Value parse(const std::string &str) {
+  Json::Value ret;
+  Json::Reader().parse(str, ret);
+  return ret;
+}
+
+TEST(SnapshotDifferTest, SendsOnlyChangedFields) {
+  SnapshotDiffer differ;
+  auto first = differ.diff(
+      0.f, parse("{\"1\": {\"pos\": [1, 2], \"props\": [3, 4]}}"));
+  EXPECT_TRUE(json_values_close(
+        parse("{\"1\": {\"pos\": [[0, [1, 2]]], \"props\": [[0, [3, 4]]]}}"),
+        first,
+        1e-6));
+
+  // Equal arrays are new objects in the script, but aren't resent
+  auto idle = differ.diff(
+      0.1f, parse("{\"1\": {\"pos\": [1, 2], \"props\": [3, 4]}}"));
+  EXPECT_TRUE(idle.empty());
+
+  // After being skipped, the old value is held until the previous tick
+  auto moved = differ.diff(
+      0.2f, parse("{\"1\": {\"pos\": [1, 3], \"props\": [3, 4]}}"));
+  ASSERT_TRUE(moved.isMember("1"));
+  EXPECT_FALSE(moved["1"].isMember("props"));
+  const Json::Value &samples = moved["1"]["pos"];
+  ASSERT_EQ(2, samples.size());
+  EXPECT_FLOAT_EQ(0.1f, samples[0][0].asFloat());
+  EXPECT_EQ(parse("[1, 2]"), samples[0][1]);
+  EXPECT_FLOAT_EQ(0.2f, samples[1][0].asFloat());
+  EXPECT_EQ(parse("[1, 3]"), samples[1][1]);
+
+  // Changing every tick needs no hold
+  auto moving = differ.diff(
+      0.3f, parse("{\"1\": {\"pos\": [1, 4], \"props\": [3, 4]}}"));
+  EXPECT_EQ(1, moving["1"]["pos"].size());
+}
+
+TEST(SnapshotDifferTest, QuantizedFields) {
+  SnapshotDiffer differ;
+  differ.setQuantum("pos", 0.25);
+  differ.diff(0.f, parse("{\"1\": {\"pos\": [1, 2]}}"));
+
+  EXPECT_TRUE(differ.diff(0.1f, parse("{\"1\": {\"pos\": [1.1, 2]}}")).empty());
+  // Drift is measured from the last sent value
+  EXPECT_TRUE(differ.diff(0.2f, parse("{\"1\": {\"pos\": [1.2, 2]}}")).empty());
+  auto drifted = differ.diff(0.3f, parse("{\"1\": {\"pos\": [1.3, 2]}}"));
+  ASSERT_TRUE(drifted.isMember("1"));
+  EXPECT_DOUBLE_EQ(1.3, drifted["1"]["pos"][1][1][0].asDouble());
+}
+
+TEST(SnapshotDifferTest, ForgetsRemovedObjects) {
+  SnapshotDiffer differ;
+  differ.diff(0.f, parse("{\"1\": {\"alive\": true}}"));
+  differ.diff(0.1f, parse("{\"1\": {\"alive\": false}}"));
+  differ.diff(0.2f, parse("{}"));
+  auto respawned = differ.diff(0.3f, parse("{\"1\": {\"alive\": true}}"));
+  EXPECT_TRUE(json_values_close(
+        parse("{\"1\": {\"alive\": [[0.3, true]]}}"),
+        respawned,
+        1e-6));
+
+  differ.reset();
+  EXPECT_TRUE(
+      differ.diff(0.4f, parse("{\"1\": {\"alive\": true}}")).isMember("1"));
+}
+
+TEST(SnapshotDifferTest, JsonValuesClose) {
+  EXPECT_TRUE(json_values_close(parse("{\"a\": [1, {\"b\": 2}]}"),
+        parse("{\"a\": [1, {\"b\": 2.01}]}"), 0.1));
+  EXPECT_FALSE(json_values_close(parse("{\"a\": [1, {\"b\": 2}]}"),
+        parse("{\"a\": [1, {\"c\": 2}]}"), 0.1));
+  EXPECT_FALSE(json_values_close(parse("[1, 2]"), parse("[1, 2, 3]"), 0.1));
+  EXPECT_FALSE(json_values_close(parse("[true]"), parse("[false]"), 2.0));
+}
+
+TEST(DeltaEncoderTest, FullBaselineUntilAcked) {
+  SnapshotDiffer differ;
+  DeltaEncoder encoder(differ);
+  const Json::Value objects = parse("{\"1\": {\"pos\": [1, 2]}}");
+  int64_t baseline;
+
+  EXPECT_TRUE(encoder.encode(1, 0.1f, objects, baseline).isMember("1"));
+  EXPECT_EQ(-1, baseline);
+  // Not acked yet, the client might not have it
+  EXPECT_TRUE(encoder.encode(2, 0.2f, objects, baseline).isMember("1"));
+  EXPECT_EQ(-1, baseline);
+
+  encoder.ack(2);
+  EXPECT_TRUE(encoder.encode(3, 0.3f, objects, baseline).empty());
+  EXPECT_EQ(2, baseline);
+
+  encoder.reset();
+  EXPECT_TRUE(encoder.encode(4, 0.4f, objects, baseline).isMember("1"));
+  EXPECT_EQ(-1, baseline);
+}
+
+TEST(DeltaEncoderTest, DiffsFromAckedTick) {
+  SnapshotDiffer differ;
+  DeltaEncoder encoder(differ);
+  int64_t baseline;
+  encoder.encode(1, 0.1f, parse("{\"1\": {\"pos\": [0, 0]}}"), baseline);
+  encoder.ack(1);
+  encoder.encode(2, 0.2f, parse("{\"1\": {\"pos\": [1, 0]}}"), baseline);
+
+  // Tick 2 may have been lost, so the move is resent.  There is no hold,
+  // the client may already have the newer position.
+  auto resent = encoder.encode(
+      3, 0.3f, parse("{\"1\": {\"pos\": [1, 0]}}"), baseline);
+  EXPECT_EQ(1, baseline);
+  EXPECT_TRUE(json_values_close(
+        parse("{\"1\": {\"pos\": [[0.3, [1, 0]]]}}"),
+        resent,
+        1e-6));
+
+  // Stale and unknown acks are ignored
+  encoder.ack(3);
+  encoder.ack(2);
+  encoder.ack(10);
+  EXPECT_EQ(3, encoder.getAckedTick());
+  EXPECT_TRUE(encoder.encode(
+        4, 0.4f, parse("{\"1\": {\"pos\": [1, 0]}}"), baseline).empty());
+  EXPECT_EQ(3, baseline);
+}
+
+TEST(DeltaEncoderTest, SendsChangesBackToBaseline) {
+  SnapshotDiffer differ;
+  differ.setRemovedValue("alive", false);
+  DeltaEncoder encoder(differ);
+  int64_t baseline;
+  encoder.encode(1, 0.1f, parse("{\"1\": {\"v\": 0}}"), baseline);
+  encoder.ack(1);
+  encoder.encode(2, 0.2f, parse("{\"1\": {\"v\": 1}}"), baseline);
+
+  // Matches the baseline, but the client may have applied tick 2
+  auto back = encoder.encode(
+      3, 0.3f, parse("{\"1\": {\"v\": 0}}"), baseline);
+  EXPECT_EQ(1, baseline);
+  EXPECT_TRUE(json_values_close(
+        parse("{\"1\": {\"v\": [[0.3, 0]]}}"),
+        back,
+        1e-6));
+  // Tick 3 may have been lost while tick 2 was not
+  EXPECT_TRUE(encoder.encode(
+        4, 0.4f, parse("{\"1\": {\"v\": 0}}"), baseline).isMember("1"));
+  encoder.ack(3);
+  EXPECT_TRUE(encoder.encode(
+        5, 0.5f, parse("{\"1\": {\"v\": 0}}"), baseline).empty());
+
+  // An object that came and went before an ack is removed too
+  encoder.encode(6, 0.6f, parse("{\"2\": {\"v\": 0}}"), baseline);
+  auto removed = encoder.encode(7, 0.7f, parse("{}"), baseline);
+  EXPECT_TRUE(removed.isMember("1"));
+  EXPECT_TRUE(removed.isMember("2"));
+}
+
+TEST(DeltaEncoderTest, SendsRemovedObjects) {
+  SnapshotDiffer differ;
+  differ.setRemovedValue("alive", false);
+  DeltaEncoder encoder(differ);
+  int64_t baseline;
+  encoder.encode(1, 0.1f, parse("{\"1\": {\"alive\": true}}"), baseline);
+  encoder.ack(1);
+
+  auto removed = encoder.encode(2, 0.2f, parse("{}"), baseline);
+  EXPECT_TRUE(json_values_close(
+        parse("{\"1\": {\"alive\": [[0.2, false]]}}"),
+        removed,
+        1e-6));
+  // Resent until the removal is acked
+  EXPECT_TRUE(encoder.encode(3, 0.3f, parse("{}"), baseline).isMember("1"));
+  encoder.ack(3);
+  EXPECT_TRUE(encoder.encode(4, 0.4f, parse("{}"), baseline).empty());
+}
+
+TEST(DeltaEncoderTest, FallsBackWhenAckIsTooOld) {
+  SnapshotDiffer differ;
+  DeltaEncoder encoder(differ, 4);
+  const Json::Value objects = parse("{\"1\": {\"pos\": [1, 2]}}");
+  int64_t baseline;
+  encoder.encode(1, 0.1f, objects, baseline);
+  encoder.ack(1);
+  for (uint64_t tick = 2; tick < 5; tick++) {
+    EXPECT_TRUE(encoder.encode(tick, 0.1f * tick, objects, baseline).empty());
+    EXPECT_EQ(1, baseline);
+  }
+  encoder.encode(5, 0.5f, objects, baseline);
+  EXPECT_TRUE(encoder.encode(6, 0.6f, objects, baseline).isMember("1"));
+  EXPECT_EQ(-1, baseline);
+}
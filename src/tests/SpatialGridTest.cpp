@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "common/SpatialGrid.h"
+#include "gtest/gtest.h"
+
+static std::vector<int> query(
+    const SpatialGrid<int> &grid,
+    const glm::vec2 &min,
+    const glm::vec2 &max) {
+  std::vector<int> ret;
+  grid.query(min, max, [&](int value) {
+    ret.push_back(value);
+  });
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+TEST(SpatialGridTest, FindsOverlapping) {
+  SpatialGrid<int> grid;
+  grid.reset(glm::vec2(-10.f), glm::vec2(10.f), 2.f);
+  grid.insert(1, glm::vec2(-5.f, -5.f), glm::vec2(0.5f));
+  grid.insert(2, glm::vec2(5.f, 5.f), glm::vec2(0.5f));
+  // Reaches well out of its cell
+  grid.insert(3, glm::vec2(0.f, 0.f), glm::vec2(4.f, 0.5f));
+  // Outside the covered area
+  grid.insert(4, glm::vec2(30.f, 0.f), glm::vec2(0.5f));
+  grid.build();
+  EXPECT_EQ(4, grid.size());
+
+  EXPECT_EQ(std::vector<int>({1}),
+      query(grid, glm::vec2(-6.f), glm::vec2(-4.f)));
+  EXPECT_EQ(std::vector<int>({3}),
+      query(grid, glm::vec2(3.f, -0.1f), glm::vec2(3.5f, 0.1f)));
+  EXPECT_EQ(std::vector<int>({2, 3}),
+      query(grid, glm::vec2(3.f, 0.f), glm::vec2(5.f, 5.f)));
+  EXPECT_EQ(std::vector<int>({4}),
+      query(grid, glm::vec2(29.f, -1.f), glm::vec2(31.f, 1.f)));
+  EXPECT_EQ(std::vector<int>({}),
+      query(grid, glm::vec2(-9.f, 5.f), glm::vec2(-8.f, 6.f)));
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}),
+      query(grid, glm::vec2(-HUGE_VAL), glm::vec2(HUGE_VAL)));
+}
+
+TEST(SpatialGridTest, Rebuilds) {
+  SpatialGrid<int> grid;
+  grid.reset(glm::vec2(0.f), glm::vec2(8.f), 1.f);
+  grid.insert(1, glm::vec2(1.f), glm::vec2(0.25f));
+  grid.build();
+  EXPECT_EQ(std::vector<int>({1}),
+      query(grid, glm::vec2(0.5f), glm::vec2(1.5f)));
+
+  grid.reset(glm::vec2(0.f), glm::vec2(8.f), 1.f);
+  grid.insert(1, glm::vec2(7.f), glm::vec2(0.25f));
+  grid.insert(2, glm::vec2(7.f), glm::vec2(0.25f));
+  grid.build();
+  EXPECT_EQ(std::vector<int>({}),
+      query(grid, glm::vec2(0.5f), glm::vec2(1.5f)));
+  EXPECT_EQ(std::vector<int>({1, 2}),
+      query(grid, glm::vec2(6.5f), glm::vec2(7.5f)));
+}
@@ -0,0 +1,46 @@
+#include "common/StringTable.h"
+#include "gtest/gtest.h"
+
+TEST(StringTableTest, InternsOnce) {
+  StringTable strings;
+  EXPECT_EQ(0, strings.intern("melee_icon"));
+  EXPECT_EQ(1, strings.intern("heal_icon"));
+  EXPECT_EQ(0, strings.intern("melee_icon"));
+  EXPECT_EQ(2, strings.size());
+  EXPECT_EQ("heal_icon", strings.get(1).str());
+  EXPECT_EQ(strings.get(0), strings.get(Json::Value(0)));
+}
+
+TEST(StringTableTest, DefinesPrefixes) {
+  StringTable server;
+  server.intern("a");
+  server.intern("b");
+
+  StringTable client;
+  client.define(0, server.getDefinitions(0));
+  EXPECT_EQ(2, client.size());
+
+  // Definitions the client already has are skipped
+  server.intern("c");
+  client.define(1, server.getDefinitions(1));
+  client.define(0, server.getDefinitions(0));
+  EXPECT_EQ(3, client.size());
+  for (uint32_t id = 0; id < server.size(); id++) {
+    EXPECT_EQ(server.get(id).str(), client.get(id).str());
+  }
+}
+
+TEST(StringTableTest, HandlesOutliveGrowth) {
+  StringTable strings;
+  InternedString first = strings.get(strings.intern("first"));
+  for (int i = 0; i < 10000; i++) {
+    strings.intern(std::to_string(i));
+  }
+  EXPECT_EQ("first", first.str());
+
+  InternedString empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(std::string(), empty.str());
+  first.clear();
+  EXPECT_EQ(empty, first);
+}